@@ -0,0 +1,60 @@
+#pragma once
+
+#include "MaskExport.hpp"
+#include "MaskRasterizer.hpp"
+#include "TerrainOutline.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Rasterizes a terrain of any size a horizontal band at a time. Every
+// polygon's row range is worked out once up front; a band only walks the
+// polygons reaching into it, in their original order, so caves still land on
+// top of blobs and the cells match rasterizeTerrain exactly.
+class BandRasterizer {
+public:
+    // `outlines` must outlive the rasterizer
+    BandRasterizer(const TerrainOutlines& outlines, unsigned int width, unsigned int height);
+
+    // Paints rows [y0, y0 + rows) into `cells`, `rows` rows of width cells each
+    void rasterize(unsigned int y0, unsigned int rows, uint8_t* cells);
+
+    unsigned int width() const { return m_width; }
+    unsigned int height() const { return m_height; }
+
+private:
+    const TerrainOutlines& m_outlines;
+    unsigned int m_width;
+    unsigned int m_height;
+    std::vector<int> m_rowBegin;  // Rows polygon i can touch, [begin, end)
+    std::vector<int> m_rowEnd;
+    ScanlineRasterizer m_rasterizer;
+};
+
+struct BandedExportOptions {
+    std::string pngFile;              // Indexed PNG in `colors`, skipped when empty
+    std::string maskFile;             // Raw "TMSK" mask as terrain-batch writes it, skipped when empty
+    MaskColors colors;
+    size_t memoryBudget{64u << 20};   // Bytes for the band buffer, at least one row
+};
+
+struct BandedExportStats {
+    unsigned int bands{0};
+    unsigned int bandRows{0};
+    size_t bandBytes{0};
+    uint64_t solidPixels{0};
+    uint64_t bytesWritten{0};
+    double milliseconds{0.0};
+};
+
+// Generates a width x height terrain straight to disk, band by band. Memory
+// use is the band buffer plus a few rows of encoder state whatever the output
+// size, so it works far past texture and sf::Image limits. `rowsDone` and
+// `cancel` behave as in writeMaskPng; a cancel removes the partial files.
+bool exportTerrainBanded(const TerrainOutlines& outlines, unsigned int width, unsigned int height,
+                         const BandedExportOptions& options, BandedExportStats* stats = nullptr,
+                         std::atomic<unsigned int>* rowsDone = nullptr,
+                         const std::atomic<bool>* cancel = nullptr,
+                         std::string* error = nullptr);
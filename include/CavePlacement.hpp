@@ -0,0 +1,99 @@
+#pragma once
+
+#include "CaveStore.hpp"
+#include "TerrainParams.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Uniform grid over points for "what is near here" queries across thousands
+// of caves. Every cell heads a singly linked list of the points inside it,
+// so a cell holds any number of points and inserting never touches the
+// grid layout. Points outside the bounds land in the nearest edge cell.
+class CaveSpatialHash {
+public:
+    // Empties the grid. Queries are cheapest with cells about as large as the
+    // query range; the cell size is raised if the grid would get too many cells.
+    void reset(float minX, float minY, float maxX, float maxY, float cellSize, size_t expectedPoints = 0);
+    // Index of the new point, counting up from 0
+    uint32_t insert(float x, float y);
+
+    size_t size() const { return m_xs.size(); }
+    float x(uint32_t index) const { return m_xs[index]; }
+    float y(uint32_t index) const { return m_ys[index]; }
+    float cellSize() const { return m_cellSize; }
+
+    // Calls fn(index, distanceSquared) for every point within `range` of
+    // (x, y) until fn returns false; returns false if it stopped early
+    template <typename Fn>
+    bool forEachInRange(float x, float y, float range, Fn&& fn) const;
+
+private:
+    // Clamped in float first, far-off coordinates must not overflow the int
+    int column(float x) const {
+        float c = (x - m_minX) * m_inverseCell;
+        return c <= 0.0f ? 0 : (c >= m_columns - 1 ? m_columns - 1 : static_cast<int>(c));
+    }
+    int row(float y) const {
+        float r = (y - m_minY) * m_inverseCell;
+        return r <= 0.0f ? 0 : (r >= m_rows - 1 ? m_rows - 1 : static_cast<int>(r));
+    }
+
+    float m_minX{0.0f};
+    float m_minY{0.0f};
+    float m_cellSize{1.0f};
+    float m_inverseCell{1.0f};
+    int m_columns{0};
+    int m_rows{0};
+    std::vector<int32_t> m_heads;  // First point per cell, -1 when empty
+    std::vector<int32_t> m_next;   // Next point in the same cell
+    std::vector<float> m_xs;
+    std::vector<float> m_ys;
+};
+
+// Bridson's Poisson-disc sampling with a radius per cave: cave i and j keep
+// their centers at least (r_i + r_j) * caveSpacing apart, r being
+// baseRadius * caveScale * scaleVariant. Centers stay in the same central
+// box as uniform placement, or anywhere the whole cave fits inside the
+// surface blobs with cavesInsideBlobs. Growth stops at caveCount caves or
+// once no more fit, so params.caves may come out shorter than caveCount.
+// Deterministic per seed, and a larger caveCount only appends caves.
+void placeCavesPoissonDisc(TerrainParams& params, uint32_t seed);
+
+// Grid over the cave centers of `params` with cells no smaller than the
+// largest caveBoundingRadius(), which is what hitTestCave() relies on
+void buildCaveHash(const TerrainParams& params, CaveSpatialHash& hash);
+// Same over the caves of `caves` instead of params.caves
+void buildCaveHash(const TerrainParams& params, const CaveStore& caves, CaveSpatialHash& hash);
+// Cave whose outline may cover (x, y), the one whose center is closest
+// relative to its size when several do; -1 for none
+int hitTestCave(const TerrainParams& params, const CaveSpatialHash& hash, float x, float y);
+// Same for a hash built from `caves`; the index is a dense CaveStore index
+int hitTestCave(const TerrainParams& params, const CaveStore& caves, const CaveSpatialHash& hash, float x, float y);
+// Radius every point of the cave outline stays within
+float caveBoundingRadius(const TerrainParams& params, const CaveDesc& cave);
+
+template <typename Fn>
+bool CaveSpatialHash::forEachInRange(float x, float y, float range, Fn&& fn) const {
+    if (m_xs.empty()) {
+        return true;
+    }
+    float rangeSquared = range * range;
+    int firstColumn = column(x - range);
+    int lastColumn = column(x + range);
+    int firstRow = row(y - range);
+    int lastRow = row(y + range);
+    for (int r = firstRow; r <= lastRow; r++) {
+        for (int c = firstColumn; c <= lastColumn; c++) {
+            for (int32_t i = m_heads[static_cast<size_t>(r) * m_columns + c]; i >= 0; i = m_next[i]) {
+                float dx = m_xs[i] - x;
+                float dy = m_ys[i] - y;
+                float distanceSquared = dx * dx + dy * dy;
+                if (distanceSquared <= rangeSquared && !fn(static_cast<uint32_t>(i), distanceSquared)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
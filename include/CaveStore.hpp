@@ -0,0 +1,73 @@
+#pragma once
+
+#include "TerrainParams.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Refers to one cave in a CaveStore. Stays valid while other caves are
+// added, removed or moved around, and never resolves again once its own
+// cave is gone, even after the slot is reused.
+struct CaveHandle {
+    uint32_t slot{0xFFFFFFFFu};
+    uint32_t generation{0};
+
+    bool operator==(const CaveHandle& other) const { return slot == other.slot && generation == other.generation; }
+    bool operator!=(const CaveHandle& other) const { return !(*this == other); }
+};
+
+// Caves stored structure-of-arrays: one contiguous array per CaveDesc field,
+// so passes that only need positions never pull rotations and scales into
+// cache. Caves sit at dense indices 0 .. size() - 1, which removal reorders;
+// CaveHandle is the stable way to hold on to one.
+class CaveStore {
+public:
+    size_t size() const { return m_xs.size(); }
+    bool empty() const { return m_xs.empty(); }
+    void reserve(size_t count);
+
+    // Removes every cave; all handles go stale
+    void clear();
+    CaveHandle add(const CaveDesc& cave);
+    // Swap-remove in O(1): the last cave moves into the gap and keeps its
+    // handle. False for a stale handle.
+    bool remove(CaveHandle handle);
+    // Keeps the first `count` caves
+    void truncate(size_t count);
+    // Overwrites the caves in order: the first min(size(), caves.size())
+    // keep their handles, the rest are added or removed at the end
+    void assign(const std::vector<CaveDesc>& caves);
+
+    // Dense index of a live handle, -1 for a stale or null one
+    int index(CaveHandle handle) const;
+    bool contains(CaveHandle handle) const { return index(handle) >= 0; }
+    CaveHandle handle(size_t index) const;
+
+    CaveDesc get(size_t index) const;
+    void set(size_t index, const CaveDesc& cave);
+
+    const std::vector<float>& xs() const { return m_xs; }
+    const std::vector<float>& ys() const { return m_ys; }
+    const std::vector<float>& rotations() const { return m_rotations; }
+    const std::vector<float>& scaleVariants() const { return m_scaleVariants; }
+    const std::vector<float>& noiseOffsets() const { return m_noiseOffsets; }
+
+    // Appends every cave in dense order, e.g. into TerrainParams::caves
+    void copyTo(std::vector<CaveDesc>& out) const;
+
+private:
+    static constexpr uint32_t NoSlot = 0xFFFFFFFFu;
+
+    void popBack();
+
+    std::vector<float> m_xs;
+    std::vector<float> m_ys;
+    std::vector<float> m_rotations;
+    std::vector<float> m_scaleVariants;
+    std::vector<float> m_noiseOffsets;
+    std::vector<uint32_t> m_slots;         // Slot of each dense index
+    std::vector<uint32_t> m_slotIndices;   // Dense index of a live slot, next free slot of a free one
+    std::vector<uint32_t> m_generations;   // Per slot, bumped when its cave is removed
+    std::vector<bool> m_live;              // Per slot
+    uint32_t m_freeSlot{NoSlot};           // Head of the free list threaded through m_slotIndices
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "MaskRasterizer.hpp"
+#include "TerrainParams.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Integer chunk coordinates; chunk (x, y) covers world pixels
+// [x * chunkSize, (x + 1) * chunkSize) x [y * chunkSize, (y + 1) * chunkSize)
+struct ChunkCoord {
+    int32_t x{0};
+    int32_t y{0};
+
+    bool operator==(const ChunkCoord& other) const { return x == other.x && y == other.y; }
+    bool operator!=(const ChunkCoord& other) const { return !(*this == other); }
+};
+
+// Unbounded world made of noisy blobs. The world is split into square
+// cells; every cell may hold one blob with its own caves, all derived from
+// a hash of the seed and the cell coordinates. A chunk therefore only
+// depends on (settings, chunk coordinates) and can be generated in any order.
+constexpr int MaxWorldCavesPerBlob = 16;
+
+struct WorldSettings {
+    TerrainParams shape;              // Blob and cave outline shape; canvas size, blob and cave counts and caves are ignored
+    uint32_t seed{1};
+    unsigned int chunkSize{512};      // Pixels per chunk side
+    float blobChance{0.6f};           // Probability that a cell holds a blob
+    int cavesPerBlob{2};              // Caves in every blob while shape.cavesEnabled, up to MaxWorldCavesPerBlob
+};
+
+// Whether the two give the same chunks, i.e. agree on every field of
+// WorldSettings::shape that generateChunk() reads
+bool sameWorldShape(const TerrainParams& a, const TerrainParams& b);
+
+struct TerrainChunk {
+    ChunkCoord coord;
+    uint64_t settingsVersion{0};      // ChunkedWorld::settingsVersion() it was generated with
+    TerrainMask mask;
+};
+
+// Pure and thread-safe: same inputs, same chunk
+void generateChunk(const WorldSettings& settings, ChunkCoord coord, TerrainMask& mask);
+
+// On-demand chunk store. Generated chunks live in an LRU cache holding at
+// most `maxChunks`; background threads fill it from a request queue that
+// prefetch() replaces with whatever surrounds the current viewport, so
+// memory stays flat however far the viewport travels. Chunks are handed out
+// as shared_ptr, so eviction never pulls one from under a reader.
+class ChunkedWorld {
+public:
+    explicit ChunkedWorld(const WorldSettings& settings, size_t maxChunks = 64, unsigned int threads = 2);
+    ~ChunkedWorld();
+
+    ChunkedWorld(const ChunkedWorld&) = delete;
+    ChunkedWorld& operator=(const ChunkedWorld&) = delete;
+
+    // Drops every cached chunk; chunks in flight are discarded when they land
+    void setSettings(const WorldSettings& settings);
+    WorldSettings settings() const;
+    uint64_t settingsVersion() const;
+
+    ChunkCoord chunkAt(double worldX, double worldY) const;
+
+    // Cached chunk or null; a miss queues the chunk at the front of the requests
+    std::shared_ptr<const TerrainChunk> tryGetChunk(ChunkCoord coord);
+    // Cached chunk, generated on the calling thread when missing
+    std::shared_ptr<const TerrainChunk> getChunk(ChunkCoord coord);
+
+    // Replaces the request queue with the chunks overlapping the world rect
+    // grown by `margin` chunks, closest to the rect center first
+    void prefetch(double minX, double minY, double maxX, double maxY, int margin = 1);
+
+    size_t cachedCount() const;
+    size_t pendingCount() const;
+    size_t maxChunks() const { return m_maxChunks; }
+    size_t memoryBytes() const;
+
+private:
+    struct CacheEntry {
+        std::shared_ptr<const TerrainChunk> chunk;
+        std::list<uint64_t>::iterator order;
+    };
+
+    static uint64_t key(ChunkCoord coord) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(coord.x)) << 32) | static_cast<uint32_t>(coord.y);
+    }
+    // Caller holds m_mutex
+    std::shared_ptr<const TerrainChunk> lookup(uint64_t chunkKey);
+    void insert(std::shared_ptr<const TerrainChunk> chunk);
+    bool isInFlight(uint64_t chunkKey) const;
+    void workerLoop();
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    WorldSettings m_settings;
+    uint64_t m_settingsVersion{1};
+    size_t m_maxChunks;
+
+    std::unordered_map<uint64_t, CacheEntry> m_cache;
+    std::list<uint64_t> m_lru;                 // Most recently used first
+    std::list<ChunkCoord> m_requests;          // Next chunk to generate first
+    std::vector<uint64_t> m_inFlight;          // Keys being generated right now
+    std::vector<std::thread> m_workers;
+    bool m_stopping{false};
+};
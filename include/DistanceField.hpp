@@ -0,0 +1,38 @@
+#pragma once
+
+#include "TerrainBitmap.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// Signed Euclidean distance, in pixels, from every pixel center to the
+// terrain boundary: positive in the air, negative inside terrain. The
+// boundary lies on pixel edges, so neighbors across it read +0.5 / -0.5.
+struct DistanceField {
+    unsigned int width{0};
+    unsigned int height{0};
+    std::vector<float> distances;
+
+    float at(unsigned int x, unsigned int y) const { return distances[static_cast<size_t>(y) * width + x]; }
+};
+
+enum class DistanceFieldFormat {
+    Float32,  // Raw little-endian floats behind a small header
+    Gray8,    // PNG, quantized to [-range, range]
+    Gray16    // PNG, quantized to [-range, range]
+};
+
+// Exact EDT (Felzenszwalb & Huttenlocher): one column pass, then a
+// lower-envelope pass per row, each split across the pool (the shared pool
+// when null). Linear in the pixel count.
+void computeDistanceField(const TerrainBitmap& solid, DistanceField& field, ThreadPool* pool = nullptr);
+
+// Maps [-range, range] linearly onto [0, max], 0.5 (the boundary) in the middle
+std::vector<uint8_t> quantizeDistanceField8(const DistanceField& field, float range);
+std::vector<uint16_t> quantizeDistanceField16(const DistanceField& field, float range);
+
+// Float32 files start with "TSDF", width and height as uint32
+bool writeDistanceField(const std::string& filename, const DistanceField& field,
+                        DistanceFieldFormat format, float range);
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include "VariantGallery.hpp"
+#include <vector>
+
+// Shows a VariantGallery through one atlas texture: thumbnails are copied
+// into their grid cell as they finish, so the whole grid is a single
+// texture however many variants it holds.
+class GalleryView {
+public:
+    explicit GalleryView(unsigned int columns = 8);
+
+    VariantGallery& gallery() { return m_gallery; }
+    unsigned int columns() const { return m_columns; }
+
+    // Starts a sweep around `base` and clears the atlas
+    void generate(const TerrainParams& base, const GallerySettings& settings);
+    // Uploads the thumbnails finished since the last call
+    void update();
+
+    bool isReady(size_t index) const { return index < m_ready.size() && m_ready[index]; }
+    // Cell of variant `index` in the atlas
+    sf::Sprite sprite(size_t index) const;
+    sf::Vector2u cellSize() const { return m_cellSize; }
+    const sf::Texture& atlas() const { return m_atlas; }
+
+private:
+    VariantGallery m_gallery;
+    unsigned int m_columns;
+    sf::Vector2u m_cellSize;
+    sf::Texture m_atlas;
+    std::vector<bool> m_ready;
+    std::vector<GalleryThumbnail> m_finished;  // Reused between updates
+};
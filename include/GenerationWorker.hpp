@@ -0,0 +1,89 @@
+#pragma once
+
+#include "MaskRasterizer.hpp"
+#include "TerrainCache.hpp"
+#include "TerrainOutline.hpp"
+#include "TerrainParams.hpp"
+#include "TripleBuffer.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Finished terrain for one parameter generation
+struct GenerationResult {
+    uint64_t generation{0};
+    unsigned int stage{0};      // Passed through from request(), e.g. a preview level
+    uint64_t key{0};            // terrainParamsHash() of the parameters
+    bool fromCache{false};
+    TerrainOutlines outlines;
+    TerrainMask mask;
+    double milliseconds{0.0};   // Outlines plus rasterization, or the cache lookup
+    size_t tessellatedCaves{0}; // Cave outlines built rather than reused
+};
+
+// Outlines and mask for `params` into `result`, taken from `cache` when it
+// has them and, with `keep`, stored there when not. Previews pass false so
+// they never evict full-quality entries from the memory LRU. Null `cache`
+// always generates. With `caveOutlines`, only caves that changed
+// since the last build through it are tessellated again.
+void buildGeneration(const TerrainParams& params, TerrainCache* cache, bool keep, GenerationResult& result,
+                     CaveOutlineCache* caveOutlines = nullptr);
+
+// Builds outlines and rasterizes masks on a thread of its own. Parameters go
+// in and finished masks come out through triple buffers, so request() and
+// takeResult() never wait for a generation in progress: the worker always
+// picks the newest request, slider values it did not get to are skipped, and
+// the caller always gets the newest finished mask. One thread requests and
+// takes results, usually the UI thread. With a cache, repeats of earlier
+// parameters are served from it instead of being generated again.
+class GenerationWorker {
+public:
+    explicit GenerationWorker(std::shared_ptr<TerrainCache> cache = nullptr);
+    ~GenerationWorker();
+
+    GenerationWorker(const GenerationWorker&) = delete;
+    GenerationWorker& operator=(const GenerationWorker&) = delete;
+
+    // Replaces the pending request, if the worker has not picked it up yet
+    // `keep` lets the cache store the result, off for previews
+    void request(uint64_t generation, const TerrainParams& params, unsigned int stage = 0, bool keep = true);
+
+    // Swaps the newest finished result into `result` and returns true, or
+    // returns false when nothing finished since the last call. The buffers
+    // handed in go back to the worker for reuse.
+    bool takeResult(GenerationResult& result);
+
+    bool isBusy() const { return m_busy.load(std::memory_order_relaxed); }
+    // Requests made, and how many of them were skipped for a newer one
+    uint64_t requestCount() const { return m_requestCount; }
+    uint64_t skippedCount() const { return m_skippedCount; }
+
+private:
+    struct Request {
+        uint64_t generation{0};
+        unsigned int stage{0};
+        bool keep{true};
+        TerrainParams params;
+    };
+
+    void workerLoop();
+
+    std::shared_ptr<TerrainCache> m_cache;
+    TripleBuffer<Request> m_requests;
+    TripleBuffer<GenerationResult> m_results;
+    // Worker thread only; one per stage, previews and full quality never share caves
+    std::vector<CaveOutlineCache> m_caveOutlines;
+    uint64_t m_requestCount{0};
+    uint64_t m_skippedCount{0};
+    std::atomic<bool> m_busy{false};
+
+    // Only for the worker to sleep on while there is nothing to do
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    std::atomic<bool> m_stopping{false};
+    std::thread m_thread;
+};
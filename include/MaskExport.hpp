@@ -0,0 +1,104 @@
+#pragma once
+
+#include "MaskRasterizer.hpp"
+#include "PngWriter.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Output color of each mask cell value
+struct MaskColors {
+    PngWriter::PaletteEntry empty{255, 255, 255, 255};
+    PngWriter::PaletteEntry solid{0, 0, 0, 255};
+    PngWriter::PaletteEntry cave{255, 255, 255, 255};
+};
+
+// Expands `count` mask cells into RGBA8 pixels, branch-free
+void recolorMaskRow(const uint8_t* cells, uint8_t* rgba, unsigned int count, const MaskColors& colors);
+
+// Recolors and encodes the mask as an RGBA PNG one row at a time. `rowsDone`
+// is bumped after every row; a set `cancel` stops the export and removes the file.
+bool writeMaskPng(const std::string& filename, const TerrainMask& mask, const MaskColors& colors,
+                  std::atomic<unsigned int>* rowsDone = nullptr,
+                  const std::atomic<bool>* cancel = nullptr,
+                  std::string* error = nullptr);
+
+// Background PNG export jobs. Every job owns a snapshot of the mask (or of
+// the outlines, for banded jobs), so the caller can keep editing the terrain
+// while it encodes. Up to `parallelJobs` exports run at once, the rest wait
+// in FIFO order.
+class ExportQueue {
+public:
+    using JobId = uint64_t;
+
+    enum class JobState {
+        Queued,
+        Running,
+        Done,
+        Failed,
+        Cancelled
+    };
+
+    struct JobStatus {
+        JobId id{0};
+        std::string filename;
+        JobState state{JobState::Queued};
+        float progress{0.0f};       // 0..1
+        double milliseconds{0.0};   // Encode time once finished
+        std::string error;
+    };
+
+    explicit ExportQueue(unsigned int parallelJobs = 2);
+    // Finishes every queued job before returning
+    ~ExportQueue();
+
+    ExportQueue(const ExportQueue&) = delete;
+    ExportQueue& operator=(const ExportQueue&) = delete;
+
+    JobId enqueue(const std::string& filename, TerrainMask mask, const MaskColors& colors);
+    // Rasterizes the outlines band by band while encoding, for sizes no mask could hold
+    JobId enqueueBanded(const std::string& filename, TerrainOutlines outlines, unsigned int width,
+                        unsigned int height, const MaskColors& colors, size_t memoryBudget = 64u << 20);
+    // Queued jobs are dropped, running ones stop after the current row
+    void cancel(JobId id);
+    // Snapshot of every job still on the list, oldest first
+    std::vector<JobStatus> jobs() const;
+    // Forgets Done, Failed and Cancelled jobs
+    void clearFinished();
+    size_t activeCount() const;
+
+private:
+    struct Job {
+        JobId id{0};
+        std::string filename;
+        TerrainMask mask;
+        MaskColors colors;
+        unsigned int height{0};         // Rows to encode, for progress
+        bool banded{false};
+        TerrainOutlines outlines;       // Banded jobs only
+        unsigned int width{0};
+        size_t memoryBudget{0};
+        std::atomic<JobState> state{JobState::Queued};
+        std::atomic<unsigned int> rowsDone{0};
+        std::atomic<bool> cancel{false};
+        double milliseconds{0.0};
+        std::string error;
+    };
+
+    JobId push(std::shared_ptr<Job> job);
+    void workerLoop();
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<std::shared_ptr<Job>> m_pending;
+    std::vector<std::shared_ptr<Job>> m_jobs;  // Everything not cleared yet, for jobs()
+    std::vector<std::thread> m_workers;
+    JobId m_nextId{1};
+    bool m_stopping{false};
+};
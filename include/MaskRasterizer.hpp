@@ -0,0 +1,126 @@
+#pragma once
+
+#include "TerrainOutline.hpp"
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// One byte per pixel terrain mask, the CPU counterpart of the rendered texture
+struct TerrainMask {
+    static constexpr uint8_t Empty = 0;  // Background / air
+    static constexpr uint8_t Solid = 1;  // Terrain
+    static constexpr uint8_t Cave = 2;   // Carved out by a cave
+
+    unsigned int width{0};
+    unsigned int height{0};
+    std::vector<uint8_t> cells;
+
+    void resize(unsigned int w, unsigned int h) {
+        width = w;
+        height = h;
+        cells.assign(static_cast<size_t>(w) * h, Empty);
+    }
+    uint8_t at(unsigned int x, unsigned int y) const { return cells[static_cast<size_t>(y) * width + x]; }
+    uint8_t* row(unsigned int y) { return cells.data() + static_cast<size_t>(y) * width; }
+    const uint8_t* row(unsigned int y) const { return cells.data() + static_cast<size_t>(y) * width; }
+};
+
+// Even-odd scanline polygon filler. A pixel is covered when its center lies
+// inside the polygon. Covered pixels are reported as horizontal runs
+// [x0, x1) clipped to the target size, so callers can write them into
+// whatever storage they like. Edge storage is reused between polygons.
+class ScanlineRasterizer {
+public:
+    template <typename SpanFn>
+    void fill(const float* xs, const float* ys, size_t count, int width, int height, SpanFn&& emit) {
+        fillRows(xs, ys, count, width, 0, height, emit);
+    }
+
+    // Same spans as fill, limited to rows [clipBegin, clipEnd); rows keep their canvas y
+    template <typename SpanFn>
+    void fillRows(const float* xs, const float* ys, size_t count, int width, int clipBegin, int clipEnd,
+                  SpanFn&& emit);
+
+private:
+    struct Edge {
+        float yTop;
+        float yBottom;
+        float xAtTop;
+        float slope;  // dx/dy
+    };
+
+    // Returns the clipped row range [rowBegin, rowEnd) the polygon touches
+    bool buildEdges(const float* xs, const float* ys, size_t count, int clipBegin, int clipEnd,
+                    int& rowBegin, int& rowEnd);
+
+    std::vector<Edge> m_edges;
+    std::vector<Edge> m_active;
+    std::vector<float> m_crossings;
+};
+
+// Fills one polygon into an 8-bit mask
+void fillPolygon(ScanlineRasterizer& rasterizer, TerrainMask& mask,
+                 const float* xs, const float* ys, size_t count, uint8_t value);
+
+// Fills one polygon into a 1-bit mask, 64 pixels per word, `wordsPerRow` words per row
+void fillPolygonBits(ScanlineRasterizer& rasterizer, uint64_t* words, size_t wordsPerRow,
+                     int width, int height, const float* xs, const float* ys, size_t count);
+
+// Resets the mask to width x height and paints blobs, then caves on top
+void rasterizeTerrain(const TerrainOutlines& outlines, unsigned int width, unsigned int height,
+                      TerrainMask& mask);
+
+template <typename SpanFn>
+void ScanlineRasterizer::fillRows(const float* xs, const float* ys, size_t count, int width, int clipBegin, int clipEnd,
+                                  SpanFn&& emit) {
+    int rowBegin = 0;
+    int rowEnd = 0;
+    if (!buildEdges(xs, ys, count, clipBegin, clipEnd, rowBegin, rowEnd)) {
+        return;
+    }
+
+    m_active.clear();
+    size_t nextEdge = 0;
+    for (int y = rowBegin; y < rowEnd; y++) {
+        float sampleY = y + 0.5f;
+
+        // Edges are sorted by top, so new ones only ever come from the front
+        while (nextEdge < m_edges.size() && m_edges[nextEdge].yTop <= sampleY) {
+            m_active.push_back(m_edges[nextEdge++]);
+        }
+
+        m_crossings.clear();
+        for (size_t i = 0; i < m_active.size();) {
+            const Edge& edge = m_active[i];
+            if (edge.yBottom <= sampleY) {
+                m_active[i] = m_active.back();
+                m_active.pop_back();
+                continue;
+            }
+            m_crossings.push_back(edge.xAtTop + (sampleY - edge.yTop) * edge.slope);
+            i++;
+        }
+
+        // Crossing lists are short, insertion sort beats std::sort here
+        for (size_t i = 1; i < m_crossings.size(); i++) {
+            float value = m_crossings[i];
+            size_t j = i;
+            while (j > 0 && m_crossings[j - 1] > value) {
+                m_crossings[j] = m_crossings[j - 1];
+                j--;
+            }
+            m_crossings[j] = value;
+        }
+
+        for (size_t i = 0; i + 1 < m_crossings.size(); i += 2) {
+            // Pixel x is inside when x + 0.5 lies in [left, right)
+            float left = std::ceil(m_crossings[i] - 0.5f);
+            float right = std::ceil(m_crossings[i + 1] - 0.5f);
+            int x0 = left < 0.0f ? 0 : (left > width ? width : static_cast<int>(left));
+            int x1 = right < 0.0f ? 0 : (right > width ? width : static_cast<int>(right));
+            if (x0 < x1) {
+                emit(y, x0, x1);
+            }
+        }
+    }
+}
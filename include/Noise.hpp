@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+
+// 2D Perlin noise using Ken Perlin's reference permutation and the classic
+// 12-direction gradient set. Output is roughly in [-1, 1].
+float perlinNoise2D(float x, float y);
+
+// Evaluates perlinNoise2D for `count` (x, y) pairs. Uses the widest SIMD
+// kernel the CPU supports; every kernel is bit-identical to the scalar call.
+void perlinNoise2DBatch(const float* xs, const float* ys, float* out, size_t count);
+
+// Batch kernels, ordered from narrowest to widest
+enum class NoiseKernel {
+    Scalar,
+    Sse41,
+    Avx2
+};
+
+// Widest kernel this CPU and build can run
+NoiseKernel supportedNoiseKernel();
+NoiseKernel activeNoiseKernel();
+// Forces a narrower kernel (for benchmarks and comparisons), clamped to what is supported
+void setNoiseKernel(NoiseKernel kernel);
+const char* noiseKernelName(NoiseKernel kernel);
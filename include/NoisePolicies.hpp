@@ -0,0 +1,229 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+// Noise as types: every policy has a static sample(x, y) returning roughly
+// [-1, 1], so a loop templated on the policy inlines the whole evaluation,
+// octaves included. Permutation tables are built at compile time from a
+// seed; seed 0 is Ken Perlin's reference table, which makes
+// PerlinNoise<0> bit-identical to perlinNoise2D().
+
+// Ken Perlin's reference permutation
+inline constexpr unsigned char PerlinReferencePermutation[256] = {
+    151,160,137,91,90,15,131,13,201,95,96,53,194,233,7,225,
+    140,36,103,30,69,142,8,99,37,240,21,10,23,190,6,148,
+    247,120,234,75,0,26,197,62,94,252,219,203,117,35,11,32,
+    57,177,33,88,237,149,56,87,174,20,125,136,171,168,68,175,
+    74,165,71,134,139,48,27,166,77,146,158,231,83,111,229,122,
+    60,211,133,230,220,105,92,41,55,46,245,40,244,102,143,54,
+    65,25,63,161,1,216,80,73,209,76,132,187,208,89,18,169,
+    200,196,135,130,116,188,159,86,164,100,109,198,173,186,3,64,
+    52,217,226,250,124,123,5,202,38,147,118,126,255,82,85,212,
+    207,206,59,227,47,16,58,17,182,189,28,42,223,183,170,213,
+    119,248,152,2,44,154,163,70,221,153,101,155,167,43,172,9,
+    129,22,39,253,19,98,108,110,79,113,224,232,178,185,112,104,
+    218,246,97,228,251,34,242,193,238,210,144,12,191,179,162,241,
+    81,51,145,235,249,14,239,107,49,192,214,31,181,199,106,157,
+    184,84,204,176,115,121,50,45,127,4,150,254,138,236,205,93,
+    222,114,67,29,24,72,243,141,128,195,78,66,215,61,156,180
+};
+
+// A permutation of 0..255 repeated to 512 entries, so lookups like
+// p[p[X] + Y + 1] never need a second wrap. int32 for SIMD gathers.
+struct NoisePermutation {
+    int32_t p[512];
+};
+
+// Perlin's table for seed 0, otherwise a Fisher-Yates shuffle driven by SplitMix64
+constexpr NoisePermutation makeNoisePermutation(uint32_t seed) {
+    NoisePermutation table{};
+    if (seed == 0) {
+        for (int i = 0; i < 256; i++) {
+            table.p[i] = PerlinReferencePermutation[i];
+        }
+    } else {
+        for (int i = 0; i < 256; i++) {
+            table.p[i] = i;
+        }
+        uint64_t state = seed;
+        for (int i = 255; i > 0; i--) {
+            uint64_t value = (state += 0x9E3779B97F4A7C15ull);
+            value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+            value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+            value ^= value >> 31;
+            int j = static_cast<int>(value % static_cast<uint64_t>(i + 1));
+            int32_t swapped = table.p[i];
+            table.p[i] = table.p[j];
+            table.p[j] = swapped;
+        }
+    }
+    for (int i = 0; i < 256; i++) {
+        table.p[256 + i] = table.p[i];
+    }
+    return table;
+}
+
+// One table per seed, evaluated by the compiler
+template <uint32_t Seed>
+struct NoiseTable {
+    static constexpr NoisePermutation value = makeNoisePermutation(Seed);
+};
+
+// Shared by the policies; the operation order matches NoiseKernels.hpp,
+// which PerlinNoise's bit-identity depends on
+inline float noiseFade(float t) {
+    return t * t * t * (t * (t * 6 - 15) + 10);
+}
+
+inline float noiseLerp(float t, float a, float b) {
+    return a + t * (b - a);
+}
+
+// Low 4 bits of the hash pick one of 12 gradient directions
+inline float noiseGrad(int hash, float x, float y) {
+    int h = hash & 15;
+    float u = h < 8 ? x : y;
+    float v = h < 4 ? y : h == 12 || h == 14 ? x : 0;
+    return ((h & 1) == 0 ? u : -u) + ((h & 2) == 0 ? v : -v);
+}
+
+// Classic gradient noise on a square lattice
+template <uint32_t Seed = 0>
+struct PerlinNoise {
+    static float sample(float x, float y) {
+        const int32_t* p = NoiseTable<Seed>::value.p;
+        float fx = std::floor(x);
+        float fy = std::floor(y);
+        int X = static_cast<int>(fx) & 255;
+        int Y = static_cast<int>(fy) & 255;
+        x -= fx;
+        y -= fy;
+
+        float u = noiseFade(x);
+        float v = noiseFade(y);
+
+        int A = p[X] + Y;
+        int B = p[X + 1] + Y;
+
+        return noiseLerp(v,
+            noiseLerp(u, noiseGrad(p[A], x, y),
+                         noiseGrad(p[B], x - 1, y)),
+            noiseLerp(u, noiseGrad(p[A + 1], x, y - 1),
+                         noiseGrad(p[B + 1], x - 1, y - 1)));
+    }
+};
+
+// Gradient noise on a triangular lattice (Gustavson's formulation): three
+// corners per sample instead of four and no axis-aligned artifacts
+template <uint32_t Seed = 0>
+struct SimplexNoise {
+    static float sample(float x, float y) {
+        constexpr float F2 = 0.36602540378f;  // (sqrt(3) - 1) / 2
+        constexpr float G2 = 0.21132486540f;  // (3 - sqrt(3)) / 6
+        const int32_t* p = NoiseTable<Seed>::value.p;
+
+        // Skew into the cell, then find which of its two triangles holds the point
+        float s = (x + y) * F2;
+        float fi = std::floor(x + s);
+        float fj = std::floor(y + s);
+        float t = (fi + fj) * G2;
+        float x0 = x - (fi - t);
+        float y0 = y - (fj - t);
+        int i1 = x0 > y0 ? 1 : 0;
+        int j1 = 1 - i1;
+        float x1 = x0 - i1 + G2;
+        float y1 = y0 - j1 + G2;
+        float x2 = x0 - 1.0f + 2.0f * G2;
+        float y2 = y0 - 1.0f + 2.0f * G2;
+
+        int i = static_cast<int>(fi) & 255;
+        int j = static_cast<int>(fj) & 255;
+        return 70.0f * (corner(p[i + p[j]], x0, y0) +
+                        corner(p[i + i1 + p[j + j1]], x1, y1) +
+                        corner(p[i + 1 + p[j + 1]], x2, y2));
+    }
+
+private:
+    static float corner(int hash, float x, float y) {
+        float t = 0.5f - x * x - y * y;
+        if (t < 0.0f) {
+            return 0.0f;
+        }
+        t *= t;
+        return t * t * noiseGrad(hash, x, y);
+    }
+};
+
+// Random values at the lattice points, blended with the Perlin fade.
+// Blockier than gradient noise and cheaper per sample.
+template <uint32_t Seed = 0>
+struct ValueNoise {
+    static float sample(float x, float y) {
+        const int32_t* p = NoiseTable<Seed>::value.p;
+        float fx = std::floor(x);
+        float fy = std::floor(y);
+        int X = static_cast<int>(fx) & 255;
+        int Y = static_cast<int>(fy) & 255;
+        float u = noiseFade(x - fx);
+        float v = noiseFade(y - fy);
+
+        int A = p[X] + Y;
+        int B = p[X + 1] + Y;
+        return noiseLerp(v,
+            noiseLerp(u, lattice(p[A]), lattice(p[B])),
+            noiseLerp(u, lattice(p[A + 1]), lattice(p[B + 1])));
+    }
+
+private:
+    static float lattice(int hash) {
+        return hash * (2.0f / 255.0f) - 1.0f;
+    }
+};
+
+// Fractal Brownian motion: Octaves copies of Base, each at twice the
+// frequency and half the amplitude of the last, scaled back into [-1, 1].
+// One octave is Base itself, bit for bit.
+template <typename Base, int Octaves>
+struct FbmNoise {
+    static_assert(Octaves >= 1, "at least one octave");
+
+    static float sample(float x, float y) {
+        float sum = 0.0f;
+        float amplitude = 1.0f;
+        for (int octave = 0; octave < Octaves; octave++) {
+            sum += amplitude * Base::sample(x, y);
+            x *= 2.0f;
+            y *= 2.0f;
+            amplitude *= 0.5f;
+        }
+        return sum * Normalize;
+    }
+
+private:
+    // 1 / (1 + 1/2 + ... + 1/2^(Octaves - 1))
+    static constexpr float Normalize = 1.0f / (2.0f - 1.0f / static_cast<float>(1u << (Octaves - 1)));
+};
+
+// Ridged multifractal: octaves of (1 - |Base|)^2, which turns the zero
+// crossings of Base into sharp crests. Mapped from [0, 1] to [-1, 1].
+template <typename Base, int Octaves>
+struct RidgedNoise {
+    static_assert(Octaves >= 1, "at least one octave");
+
+    static float sample(float x, float y) {
+        float sum = 0.0f;
+        float amplitude = 1.0f;
+        for (int octave = 0; octave < Octaves; octave++) {
+            float ridge = 1.0f - std::fabs(Base::sample(x, y));
+            sum += amplitude * ridge * ridge;
+            x *= 2.0f;
+            y *= 2.0f;
+            amplitude *= 0.5f;
+        }
+        return sum * Normalize - 1.0f;
+    }
+
+private:
+    static constexpr float Normalize = 2.0f / (2.0f - 1.0f / static_cast<float>(1u << (Octaves - 1)));
+};
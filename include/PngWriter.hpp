@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Streaming PNG encoder with no external dependencies. Rows go straight
+// through the filter and deflate stages into fixed-size IDAT chunks, so the
+// memory used is independent of the image height. The deflate stage only
+// emits run-length matches with fixed Huffman codes, which suits terrain
+// masks and flat-colored exports (large uniform runs) very well.
+class PngWriter {
+public:
+    enum class Format {
+        Gray8,     // 1 byte per pixel
+        Gray16,    // 1 uint16_t per pixel, native byte order
+        Rgba8,     // 4 bytes per pixel
+        Indexed8   // 1 palette index per pixel
+    };
+
+    struct PaletteEntry {
+        uint8_t r{0};
+        uint8_t g{0};
+        uint8_t b{0};
+        uint8_t a{255};
+    };
+
+    PngWriter() = default;
+    ~PngWriter();
+
+    PngWriter(const PngWriter&) = delete;
+    PngWriter& operator=(const PngWriter&) = delete;
+
+    bool open(const std::string& filename, unsigned int width, unsigned int height, Format format,
+              const std::vector<PaletteEntry>& palette = {});
+    // `row` holds width pixels in the layout described by Format
+    bool writeRow(const void* row);
+    // Finishes the stream; fails if not all rows were written or on I/O errors
+    bool close();
+
+    unsigned int rowsWritten() const { return m_rowsWritten; }
+    uint64_t bytesWritten() const { return m_bytesWritten; }
+
+private:
+    void writeChunk(const char type[4], const uint8_t* data, size_t size);
+    void putBits(uint32_t bits, int count);
+    void putHuffman(uint32_t code, int length);
+    void putLiteral(uint8_t value);
+    void putMatch(int length, int distance);
+    void deflateBytes(const uint8_t* data, size_t size);
+    void flushIdat(bool force);
+
+    std::ofstream m_file;
+    unsigned int m_width{0};
+    unsigned int m_height{0};
+    unsigned int m_rowsWritten{0};
+    int m_bytesPerPixel{1};
+    uint64_t m_bytesWritten{0};
+    bool m_ok{false};
+
+    std::vector<uint8_t> m_previousRow;  // Unfiltered, for the Up filter
+    std::vector<uint8_t> m_currentRow;
+    std::vector<uint8_t> m_filtered;     // History bytes + filter byte + filtered row
+
+    std::vector<uint8_t> m_idat;         // Compressed bytes waiting for a chunk
+    uint32_t m_bitBuffer{0};
+    int m_bitCount{0};
+    size_t m_streamBytes{0};             // Uncompressed bytes fed to deflate so far
+    uint32_t m_adlerA{1};
+    uint32_t m_adlerB{0};
+};
+
+// One-shot helper: `pixels` holds height rows of width pixels in `format`
+bool writePng(const std::string& filename, unsigned int width, unsigned int height,
+              PngWriter::Format format, const void* pixels,
+              const std::vector<PngWriter::PaletteEntry>& palette = {});
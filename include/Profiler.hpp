@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// In-process frame profiler. Scoped zones record into a ring buffer owned by
+// the calling thread, so threads never contend with each other while
+// recording. While profiling is switched off a zone costs one relaxed atomic
+// load; building with TERRAIN_NO_PROFILING removes the zones entirely.
+class Profiler {
+public:
+    // Times are steady clock nanoseconds
+    struct Event {
+        const char* name;
+        uint64_t start;
+        uint64_t end;
+    };
+
+    // Inclusive time of every zone with the same name
+    struct ZoneSummary {
+        std::string name;
+        double totalMs{0.0};
+        double maxMs{0.0};
+        uint32_t calls{0};
+    };
+
+    struct Summary {
+        uint32_t frames{0};                 // Frames that ended inside the window
+        std::vector<ZoneSummary> zones;     // Most expensive first
+    };
+
+    // Events each thread keeps before the oldest are overwritten. A thread's
+    // ring grows up to this as it records, so threads that record little
+    // stay small.
+    static constexpr size_t EventsPerThread = 1 << 16;
+    static constexpr size_t FrameHistory = 240;
+
+    static Profiler& instance();
+
+    static bool enabled() { return s_enabled.load(std::memory_order_relaxed); }
+    static void setEnabled(bool enabled) { s_enabled.store(enabled, std::memory_order_relaxed); }
+
+    static uint64_t now() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // Labels the calling thread in traces, otherwise it shows up as "thread N".
+    // Names and zone names must be string literals or otherwise outlive the profiler.
+    void setThreadName(const char* name);
+    void record(const char* name, uint64_t start, uint64_t end);
+
+    // Ends the current frame, called once per frame from the main loop.
+    // Frame times are kept even while zones are switched off.
+    void frameMark();
+
+    // Frame durations in milliseconds, oldest first
+    std::vector<float> frameTimes() const;
+
+    // Zones that ended within the last `seconds`
+    Summary summarize(double seconds) const;
+
+    // Writes the last `seconds` as Chrome trace event JSON (chrome://tracing, Perfetto)
+    bool writeChromeTrace(const std::string& filename, double seconds, std::string* error = nullptr) const;
+
+    void clear();
+
+private:
+    struct ThreadBuffer {
+        std::mutex mutex;
+        std::vector<Event> events;  // Grows to EventsPerThread, then wraps
+        size_t head{0};
+        size_t count{0};
+        uint32_t id{0};
+        std::string name;
+        std::atomic<bool> owned{true};
+    };
+
+    Profiler() : m_frameTimes(FrameHistory, 0.0f), m_frameEnds(FrameHistory, 0) {}
+
+    ThreadBuffer& threadBuffer();
+    template <typename Fn> void forEachEvent(uint64_t since, Fn&& fn) const;
+
+    static std::atomic<bool> s_enabled;
+
+    mutable std::mutex m_mutex;  // Guards the buffer list and the frame history
+    std::vector<std::unique_ptr<ThreadBuffer>> m_threads;
+    std::vector<float> m_frameTimes;
+    std::vector<uint64_t> m_frameEnds;
+    size_t m_frameHead{0};
+    size_t m_frameCount{0};
+    uint64_t m_frameStart{0};
+};
+
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* name)
+        : m_name(Profiler::enabled() ? name : nullptr)
+        , m_start(m_name ? Profiler::now() : 0) {}
+
+    ~ProfileZone() {
+        if (m_name) {
+            Profiler::instance().record(m_name, m_start, Profiler::now());
+        }
+    }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char* m_name;
+    uint64_t m_start;
+};
+
+#define TERRAIN_PROFILE_CONCAT_INNER(a, b) a##b
+#define TERRAIN_PROFILE_CONCAT(a, b) TERRAIN_PROFILE_CONCAT_INNER(a, b)
+
+#ifdef TERRAIN_NO_PROFILING
+#define PROFILE_ZONE(name) ((void)0)
+#else
+#define PROFILE_ZONE(name) ProfileZone TERRAIN_PROFILE_CONCAT(profileZone, __LINE__)(name)
+#endif
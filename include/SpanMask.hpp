@@ -0,0 +1,87 @@
+#pragma once
+
+#include "MaskRasterizer.hpp"
+#include "TerrainBitmap.hpp"
+#include "TerrainOutline.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Run [x0, x1) of set pixels in one row
+struct Span {
+    int32_t x0;
+    int32_t x1;
+};
+
+// Span tagged with its row, for building masks from spans in any order
+struct RowSpan {
+    uint32_t y;
+    int32_t x0;
+    int32_t x1;
+};
+
+// Set pixels stored as runs: per row a sorted list of disjoint, non-touching
+// [x0, x1) spans, all rows packed into one array with a row offset table.
+// Terrain rows cross the boundary only a handful of times, so memory and the
+// cost of counting and boolean ops follow the boundary, not the pixel count.
+class SpanMask {
+public:
+    SpanMask() = default;
+    SpanMask(unsigned int width, unsigned int height) { resize(width, height); }
+
+    // Resizes and clears every row
+    void resize(unsigned int width, unsigned int height);
+    void clear();
+
+    unsigned int width() const { return m_width; }
+    unsigned int height() const { return m_height; }
+    size_t spanCount() const { return m_spans.size(); }
+    size_t memoryBytes() const { return m_spans.size() * sizeof(Span) + m_rowStart.size() * sizeof(uint32_t); }
+
+    const Span* rowBegin(unsigned int y) const { return m_spans.data() + m_rowStart[y]; }
+    const Span* rowEnd(unsigned int y) const { return m_spans.data() + m_rowStart[y + 1]; }
+    size_t rowSpanCount(unsigned int y) const { return m_rowStart[y + 1] - m_rowStart[y]; }
+
+    // Binary search in the row's spans
+    bool contains(int x, int y) const;
+
+    // Set pixels, O(spans)
+    uint64_t count() const;
+    uint64_t countRow(unsigned int y) const;
+    // Set pixels in [x0, x1) x [y0, y1), clamped to the mask
+    uint64_t countRect(int x0, int y0, int x1, int y1) const;
+
+    // Boolean ops against a mask of the same size, one merge pass per row
+    void unite(const SpanMask& other);
+    void subtract(const SpanMask& other);
+    void intersect(const SpanMask& other);
+
+    // Sets (solid) or clears every pixel inside the polygon, e.g. a carve
+    // brush; rows outside the polygon are copied through untouched
+    void paintPolygon(ScanlineRasterizer& rasterizer, const float* xs, const float* ys, size_t count, bool solid);
+
+    void toMask(TerrainMask& mask, uint8_t value = TerrainMask::Solid) const;
+    TerrainBitmap toBitmap() const;
+
+    static SpanMask fromMask(const TerrainMask& mask, uint8_t value = TerrainMask::Solid);
+    static SpanMask fromBitmap(const TerrainBitmap& bitmap);
+
+    // Spans in any order, overlapping or touching; sorted, then merged per row
+    static SpanMask fromRowSpans(unsigned int width, unsigned int height, std::vector<RowSpan> spans);
+
+private:
+    // Rows [rowBegin, rowEnd) become op(own spans, spans of other(y)), every
+    // other row is carried over as it is
+    template <typename OtherFn, typename RowOp>
+    void rewriteRows(unsigned int rowBegin, unsigned int rowEnd, OtherFn&& other, RowOp&& op);
+
+    unsigned int m_width{0};
+    unsigned int m_height{0};
+    std::vector<Span> m_spans;
+    std::vector<uint32_t> m_rowStart{0};  // height + 1 entries
+};
+
+// Blobs minus caves straight from the scanline rasterizer's spans, no pixel
+// storage at any point. Solid cells match rasterizeTerrain.
+void rasterizeTerrainSpans(const TerrainOutlines& outlines, unsigned int width, unsigned int height,
+                           SpanMask& spans);
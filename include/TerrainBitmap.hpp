@@ -0,0 +1,138 @@
+#pragma once
+
+#include "MaskRasterizer.hpp"
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+inline int popcount64(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(value);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    return static_cast<int>(__popcnt64(value));
+#else
+    value = value - ((value >> 1) & 0x5555555555555555ull);
+    value = (value & 0x3333333333333333ull) + ((value >> 2) & 0x3333333333333333ull);
+    value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return static_cast<int>((value * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+// Index of the lowest set bit; value must not be 0
+inline int countTrailingZeros64(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(value);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return static_cast<int>(index);
+#else
+    int index = 0;
+    while ((value & 1) == 0) {
+        value >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+// 1 bit per pixel terrain bitmap, 64 pixels per word. Every row starts on a
+// word boundary and the padding bits past the width are always zero, so
+// whole-word operations never need to mask the row tail.
+class TerrainBitmap {
+public:
+    TerrainBitmap() = default;
+    TerrainBitmap(unsigned int width, unsigned int height) { resize(width, height); }
+
+    // Resizes and clears every bit
+    void resize(unsigned int width, unsigned int height);
+    void clear();
+
+    unsigned int width() const { return m_width; }
+    unsigned int height() const { return m_height; }
+    size_t wordsPerRow() const { return m_wordsPerRow; }
+    size_t memoryBytes() const { return m_words.size() * sizeof(uint64_t); }
+
+    uint64_t* row(unsigned int y) { return m_words.data() + y * m_wordsPerRow; }
+    const uint64_t* row(unsigned int y) const { return m_words.data() + y * m_wordsPerRow; }
+    uint64_t* data() { return m_words.data(); }
+    const uint64_t* data() const { return m_words.data(); }
+
+    bool get(unsigned int x, unsigned int y) const { return (row(y)[x >> 6] >> (x & 63)) & 1; }
+    void set(unsigned int x, unsigned int y, bool value);
+    // Sets or clears the run [x0, x1) of row y
+    void fillSpan(unsigned int y, unsigned int x0, unsigned int x1, bool value);
+
+    // Set pixels, by popcount
+    uint64_t count() const;
+    uint64_t countRow(unsigned int y) const;
+    // Set pixels in [x0, x1) x [y0, y1), clamped to the bitmap
+    uint64_t countRect(int x0, int y0, int x1, int y1) const;
+
+    // Calls fn(x0, x1) for every run of set pixels [x0, x1) in row y, left to right
+    template <typename SpanFn>
+    void forEachSpan(unsigned int y, SpanFn&& fn) const;
+
+    // Boolean ops against a bitmap of the same size
+    void unite(const TerrainBitmap& other);
+    void subtract(const TerrainBitmap& other);
+    void intersect(const TerrainBitmap& other);
+
+    // Re-packs the words covering [x0, x1) x [y0, y1) from a mask of the same size
+    void updateFromMask(const TerrainMask& mask, uint8_t value, int x0, int y0, int x1, int y1);
+
+    // One byte per pixel, 1 where set
+    std::vector<uint8_t> toBytes() const;
+
+    // Pixels whose mask cell equals `value`
+    static TerrainBitmap fromMask(const TerrainMask& mask, uint8_t value = TerrainMask::Solid);
+    // Opaque black pixels of a tightly packed RGBA8 buffer, i.e. rendered terrain
+    static TerrainBitmap fromRgba(const uint8_t* rgba, unsigned int width, unsigned int height);
+
+private:
+    unsigned int m_width{0};
+    unsigned int m_height{0};
+    size_t m_wordsPerRow{0};
+    std::vector<uint64_t> m_words;
+};
+
+// Rasterizes blobs minus caves straight into a bitmap, no byte mask involved
+void rasterizeTerrainBits(const TerrainOutlines& outlines, unsigned int width, unsigned int height,
+                          TerrainBitmap& bitmap);
+
+template <typename SpanFn>
+void TerrainBitmap::forEachSpan(unsigned int y, SpanFn&& fn) const {
+    const uint64_t* words = row(y);
+    unsigned int x = 0;
+    bool inside = false;
+    unsigned int start = 0;
+
+    for (size_t w = 0; w < m_wordsPerRow; w++) {
+        // Flip the word while inside a run so we always look for the next set bit
+        uint64_t bits = inside ? ~words[w] : words[w];
+        unsigned int base = static_cast<unsigned int>(w * 64);
+        int consumed = 0;
+        while (consumed < 64) {
+            uint64_t remaining = consumed == 0 ? bits : bits & (~0ull << consumed);
+            if (remaining == 0) {
+                break;
+            }
+            int bit = countTrailingZeros64(remaining);
+            x = base + bit;
+            if (inside) {
+                fn(start, x);
+            } else {
+                start = x;
+            }
+            inside = !inside;
+            bits = ~bits;
+            consumed = bit;
+        }
+    }
+    if (inside) {
+        fn(start, m_width);
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "DistanceField.hpp"
+#include "MaskRasterizer.hpp"
+#include "TerrainOutline.hpp"
+#include "TerrainParams.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Generated terrain for one set of parameters, immutable once cached
+struct CachedTerrain {
+    TerrainParams params;
+    TerrainOutlines outlines;
+    TerrainMask mask;
+    std::shared_ptr<const DistanceField> distanceField;  // Null until someone computed it
+
+    size_t memoryBytes() const;
+};
+
+// Content-addressed store of generated terrains, keyed by terrainParamsHash().
+// Entries live in a memory LRU and, when a directory is given, as `.terrain`
+// files named after the key, so repeats are served across runs. Other
+// artifacts derived from the same key (exported PNGs, ...) can be kept next
+// to them as plain files. Both tiers evict least recently used entries past
+// their byte budget. Thread-safe; disk I/O happens outside the lock.
+class TerrainCache {
+public:
+    struct Stats {
+        uint64_t memoryHits{0};
+        uint64_t diskHits{0};
+        uint64_t misses{0};
+        uint64_t stores{0};
+        uint64_t evictions{0};       // Memory and disk together
+        size_t memoryEntries{0};
+        size_t memoryBytes{0};
+        uint64_t diskFiles{0};
+        uint64_t diskBytes{0};
+    };
+
+    // An empty directory keeps everything in memory
+    explicit TerrainCache(const std::string& directory = {}, size_t memoryBudget = 256u << 20,
+                          uint64_t diskBudget = 1ull << 30);
+
+    TerrainCache(const TerrainCache&) = delete;
+    TerrainCache& operator=(const TerrainCache&) = delete;
+
+    // Memory first, then disk; null on a miss
+    std::shared_ptr<const CachedTerrain> find(uint64_t key);
+    // Replaces any entry under the key. `persist` also writes it to disk,
+    // leave it off for throwaway results such as previews.
+    void store(uint64_t key, std::shared_ptr<const CachedTerrain> entry, bool persist = true);
+    // Adds a distance field to the entry under the key, if there is one
+    void attachDistanceField(uint64_t key, std::shared_ptr<const DistanceField> field);
+
+    // Plain files under the key: `path` receives where a cached copy is,
+    // storeFile() copies `source` in
+    bool findFile(uint64_t key, const std::string& extension, std::string& path);
+    bool storeFile(uint64_t key, const std::string& extension, const std::string& source);
+
+    // Key of an artifact derived from `key` plus some settings, e.g. export colors
+    static uint64_t deriveKey(uint64_t key, const void* data, size_t size);
+    // 16 hex digits, the file name stem on disk
+    static std::string keyString(uint64_t key);
+    // Per-user location for a disk cache named `name`: under $XDG_CACHE_HOME
+    // or ~/.cache, %LOCALAPPDATA% on Windows. Empty when none of those is set.
+    static std::string userDirectory(const std::string& name);
+
+    Stats stats() const;
+    const std::string& directory() const { return m_directory; }
+    // Drops the memory tier and, when `disk` is set, every cached file
+    void clear(bool disk);
+
+private:
+    struct MemoryEntry {
+        std::shared_ptr<const CachedTerrain> terrain;
+        size_t bytes{0};
+        std::list<uint64_t>::iterator order;
+    };
+
+    std::string pathFor(uint64_t key, const std::string& extension) const;
+    std::shared_ptr<const CachedTerrain> loadFromDisk(uint64_t key);
+    bool writeToDisk(uint64_t key, const CachedTerrain& terrain);
+    // Caller holds m_mutex
+    void insertMemory(uint64_t key, std::shared_ptr<const CachedTerrain> terrain);
+    void evictDisk();
+
+    std::string m_directory;
+    size_t m_memoryBudget;
+    uint64_t m_diskBudget;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<uint64_t, MemoryEntry> m_memory;
+    std::list<uint64_t> m_lru;                  // Most recently used first
+    size_t m_memoryBytes{0};
+    uint64_t m_diskBytes{0};
+    uint64_t m_diskFiles{0};
+    Stats m_stats;
+
+    std::mutex m_diskMutex;                     // One eviction scan at a time
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "TerrainBitmap.hpp"
+#include <cstddef>
+#include <vector>
+
+class ThreadPool;
+
+// Occupancy pyramid for collision queries. Level 0 is the terrain bitmap,
+// bit (x, y) of level k is set when any pixel of the 2^k x 2^k block at
+// (x << k, y << k) is solid. Queries skip empty blocks at the coarsest
+// level that allows it, so their cost follows the amount of terrain
+// boundary they touch instead of the area they cover.
+//
+// Pixel (x, y) covers [x, x + 1) x [y, y + 1). Everything outside the
+// bitmap counts as empty.
+class TerrainCollision {
+public:
+    struct Ray {
+        float originX{0.0f};
+        float originY{0.0f};
+        float directionX{1.0f};  // Need not be normalized
+        float directionY{0.0f};
+        float maxDistance{0.0f};
+    };
+
+    struct RayHit {
+        bool hit{false};
+        float x{0.0f};            // Point where the ray enters the solid pixel
+        float y{0.0f};
+        float distance{0.0f};
+        float normalX{0.0f};      // Unit surface normal, pointing out of the terrain
+        float normalY{0.0f};
+        int cellX{-1};            // Solid pixel that was hit
+        int cellY{-1};
+    };
+
+    struct NearestSolid {
+        bool found{false};
+        int cellX{-1};
+        int cellY{-1};
+        float distance{0.0f};     // To the pixel center
+    };
+
+    TerrainCollision() = default;
+    explicit TerrainCollision(const TerrainBitmap& solid) { build(solid); }
+
+    void build(const TerrainBitmap& solid);
+    // Refreshes the pyramid above [x0, x1) x [y0, y1) after `solid` changed there
+    void update(const TerrainBitmap& solid, int x0, int y0, int x1, int y1);
+
+    unsigned int width() const { return m_levels.empty() ? 0 : m_levels[0].width(); }
+    unsigned int height() const { return m_levels.empty() ? 0 : m_levels[0].height(); }
+    size_t levelCount() const { return m_levels.size(); }
+    size_t memoryBytes() const;
+
+    bool isSolid(int x, int y) const;
+    bool isSolid(float x, float y) const;
+    // Any solid pixel overlapping the box [minX, maxX) x [minY, maxY)
+    bool overlaps(float minX, float minY, float maxX, float maxY) const;
+    // First solid pixel along the ray. A ray starting inside terrain hits at distance 0.
+    RayHit raycast(const Ray& ray) const;
+    // Closest solid pixel center within maxDistance of (x, y)
+    NearestSolid nearestSolid(float x, float y, float maxDistance) const;
+
+    // Casts `count` rays split across the pool (the shared pool when null)
+    void raycastBatch(const Ray* rays, RayHit* hits, size_t count, ThreadPool* pool = nullptr) const;
+
+private:
+    bool occupied(size_t level, unsigned int x, unsigned int y) const {
+        const TerrainBitmap& bits = m_levels[level];
+        return x < bits.width() && y < bits.height() && bits.get(x, y);
+    }
+    bool anyInBlock(size_t level, unsigned int bx, unsigned int by, int x0, int y0, int x1, int y1) const;
+    void surfaceNormal(int x, int y, float dx, float dy, bool crossedX, RayHit& hit) const;
+
+    std::vector<TerrainBitmap> m_levels;
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "TerrainBitmap.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// Closed terrain boundary loops for physics engines, stored like
+// TerrainOutlines: loop i owns points [offsets[i], offsets[i + 1]) of xs/ys.
+// Outer loops run clockwise on screen (y down) around solid terrain, holes
+// (caves and other enclosed air) run counter-clockwise. Loops are implicitly
+// closed, the first point is not repeated.
+struct TerrainContours {
+    std::vector<float> xs;
+    std::vector<float> ys;
+    std::vector<uint32_t> offsets{0};
+    std::vector<uint8_t> holes;   // 1 for hole loops
+
+    size_t loopCount() const { return offsets.size() - 1; }
+    size_t pointCount() const { return xs.size(); }
+    size_t holeCount() const;
+    uint32_t begin(size_t loop) const { return offsets[loop]; }
+    uint32_t size(size_t loop) const { return offsets[loop + 1] - offsets[loop]; }
+    void clear();
+};
+
+struct ContourStats {
+    size_t rawPoints{0};          // Before simplification
+    size_t tiles{0};
+    size_t tracedTiles{0};        // Tiles traced this time, all of them unless updated
+    double milliseconds{0.0};
+};
+
+// Marching squares over the pixel centers of `solid`, everything outside
+// counts as air. The loops follow the bitmap topology exactly (diagonal
+// neighbors are not connected), vertices sit between pixel centers at the
+// 0.5 level of a 3x3 box-filtered occupancy. Bands of `tileRows` rows are
+// traced in parallel and stitched at their seams, then every loop is
+// simplified with Douglas-Peucker to `tolerance` pixels. Loops that collapse
+// below three points are dropped.
+ContourStats extractContours(const TerrainBitmap& solid, float tolerance, TerrainContours& out,
+                             unsigned int tileRows = 64, ThreadPool* pool = nullptr);
+
+// extractContours() that keeps its tiles around. After an edit, update()
+// traces again only the tiles next to the changed rows: loops closed inside
+// untouched tiles are reused as they are, loops crossing tile seams are
+// stitched and simplified again. The output is the same as a full pass.
+class ContourExtractor {
+public:
+    ContourStats extract(const TerrainBitmap& solid, float tolerance, TerrainContours& out,
+                         unsigned int tileRows = 64, ThreadPool* pool = nullptr);
+    // Pixel rows [y0, y1) of `solid` changed since the last extract() or
+    // update(). Falls back to extract() when the size changed.
+    ContourStats update(const TerrainBitmap& solid, int y0, int y1, TerrainContours& out,
+                        ThreadPool* pool = nullptr);
+
+private:
+    struct Tile {
+        std::vector<std::vector<uint64_t>> open;  // Edge chains ending on the tile seams
+        TerrainContours closed;                   // Finished loops closed inside the tile
+        size_t closedRawPoints{0};
+    };
+
+    ContourStats run(const TerrainBitmap& solid, const std::vector<uint8_t>& dirty, TerrainContours& out,
+                     ThreadPool* pool);
+
+    std::vector<Tile> m_tiles;
+    unsigned int m_width{0};
+    unsigned int m_height{0};
+    unsigned int m_tileRows{64};
+    float m_tolerance{1.0f};
+};
+
+// "TCNT", version, loop count, point count (uint32 each), then per loop a
+// uint32 point count with the hole flag in the top bit, followed by all
+// points as float32 x/y pairs in loop order
+bool writeContours(const std::string& filename, const TerrainContours& contours);
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "MaskRasterizer.hpp"
+#include "TerrainOutline.hpp"
+#include <cstdint>
+
+// Terrain coverage computed from outline geometry instead of rendered pixels
+struct CoverageResult {
+    uint64_t solidPixels{0};   // Pixels (or pixel-equivalent area) of visible terrain
+    float coverage{0.0f};      // Percentage of the canvas
+    bool exact{false};         // True for pixel-exact counts, false for area estimates
+    bool unresolved{false};    // Estimate only: no usable area, count with exactCoverage() instead
+    double milliseconds{0.0};  // Time taken to compute this result
+};
+
+// Exact pixel count of (union of blobs) minus (union of caves), clipped to the
+// canvas. Walks the scanline spans of every outline without writing a mask;
+// matches what rasterizeTerrain() produces, pixel for pixel.
+CoverageResult exactCoverage(const TerrainOutlines& outlines, unsigned int width, unsigned int height);
+
+// Area of the same region from the outline geometry: the boundary of
+// (union of blobs) minus (union of caves), clipped to the canvas, integrated
+// with Green's theorem. Overlapping blobs, overlapping caves and caves over
+// air or off the canvas are all handled; it differs from exactCoverage()
+// only by pixel sampling along the edges. Cost grows with edges times the
+// edges of overlapping neighbours, not with the canvas. Sets `unresolved`
+// instead of answering when that would cost more than exactCoverage()
+// (dozens of detailed caves over the blobs already do) or when coincident
+// edges, such as duplicate caves, leave the boundary ambiguous.
+CoverageResult estimateCoverage(const TerrainOutlines& outlines, unsigned int width, unsigned int height);
+
+// Rough cost of exactCoverage(): the number of polygon rows it has to walk
+uint64_t exactCoverageCost(const TerrainOutlines& outlines, unsigned int height);
+
+// Raster count over an existing mask
+uint64_t countCells(const TerrainMask& mask, uint8_t value);
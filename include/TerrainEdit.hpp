@@ -0,0 +1,45 @@
+#pragma once
+
+#include "MaskRasterizer.hpp"
+#include <algorithm>
+#include <cstdint>
+
+// Pixel rectangle [x0, x1) x [y0, y1) touched by edits
+struct DirtyRect {
+    int x0{0};
+    int y0{0};
+    int x1{0};
+    int y1{0};
+
+    bool empty() const { return x0 >= x1 || y0 >= y1; }
+    int width() const { return x1 - x0; }
+    int height() const { return y1 - y0; }
+    bool overlaps(const DirtyRect& other) const {
+        return x0 < other.x1 && other.x0 < x1 && y0 < other.y1 && other.y0 < y1;
+    }
+    void merge(const DirtyRect& other) {
+        if (other.empty()) return;
+        if (empty()) {
+            *this = other;
+            return;
+        }
+        x0 = std::min(x0, other.x0);
+        y0 = std::min(y0, other.y0);
+        x1 = std::max(x1, other.x1);
+        y1 = std::max(y1, other.y1);
+    }
+};
+
+struct MaskEdit {
+    DirtyRect rect;          // Cells covered by the polygon, clipped to the mask
+    int64_t solidDelta{0};   // Change in the number of Solid cells
+};
+
+// Noisy round outline for carving and filling: pointCount points into xs/ys.
+// roughness scales the Perlin variation of the radius, 0 gives a circle.
+void buildBrushOutline(float centerX, float centerY, float radius, float roughness, float noiseOffset,
+                       int pointCount, float* xs, float* ys);
+
+// Writes `value` into every cell inside the polygon and reports what changed
+MaskEdit paintPolygon(ScanlineRasterizer& rasterizer, TerrainMask& mask,
+                      const float* xs, const float* ys, size_t count, uint8_t value);
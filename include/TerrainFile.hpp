@@ -0,0 +1,120 @@
+#pragma once
+
+#include "DistanceField.hpp"
+#include "TerrainBitmap.hpp"
+#include "TerrainContours.hpp"
+#include "TerrainParams.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Native `.terrain` files, made to be memory-mapped and queried in place.
+// Little-endian throughout:
+//
+//   header      "TERRAIN\0", version, section count, width, height, seed, file size
+//   sections    type, offset, size per section
+//   ...         every section starts on a 4096-byte boundary
+//
+// Sections are the generation parameters, the cave list (CaveDesc records),
+// the solid mask bit-packed exactly like TerrainBitmap (64 pixels per word,
+// rows padded to whole words), and optionally the cave mask in the same
+// layout, a float32 distance field and physics contours. Readers skip
+// section types they do not know.
+enum class TerrainSection : uint32_t {
+    Params = 1,
+    Caves = 2,
+    SolidBits = 3,
+    CaveBits = 4,
+    DistanceField = 5,
+    Contours = 6
+};
+
+// What writeTerrainFile stores; only `solid` is required
+struct TerrainFileData {
+    const TerrainParams* params{nullptr};          // Includes the cave list
+    uint32_t seed{0};
+    const TerrainBitmap* solid{nullptr};
+    const TerrainBitmap* caves{nullptr};           // Same size as solid
+    const DistanceField* distanceField{nullptr};   // Same size as solid
+    const TerrainContours* contours{nullptr};
+};
+
+bool writeTerrainFile(const std::string& filename, const TerrainFileData& data, std::string* error = nullptr);
+
+// Read-only view of a mapped `.terrain` file. Opening validates the header,
+// the section table and the contour offsets, nothing is decoded or copied:
+// every accessor reads the mapping directly, so opening is O(1) in the
+// terrain size (O(loops) with contours) and pages load on first touch.
+class TerrainFile {
+public:
+    struct ContoursView {
+        uint32_t loopCount{0};
+        uint32_t pointCount{0};
+        const uint32_t* offsets{nullptr};  // loopCount + 1 entries
+        const uint8_t* holes{nullptr};     // loopCount entries
+        const float* xs{nullptr};
+        const float* ys{nullptr};
+    };
+
+    TerrainFile() = default;
+    ~TerrainFile();
+
+    TerrainFile(const TerrainFile&) = delete;
+    TerrainFile& operator=(const TerrainFile&) = delete;
+
+    bool open(const std::string& filename, std::string* error = nullptr);
+    void close();
+    bool isOpen() const { return m_data != nullptr; }
+
+    unsigned int width() const { return m_width; }
+    unsigned int height() const { return m_height; }
+    uint32_t seed() const { return m_seed; }
+    size_t fileSize() const { return m_size; }
+
+    bool hasParams() const { return m_params != nullptr; }
+    // Parameters with the cave list; default parameters for the size when absent
+    TerrainParams params() const;
+    size_t caveCount() const { return m_caveCount; }
+    const CaveDesc* caves() const { return m_caves; }
+
+    size_t wordsPerRow() const { return m_wordsPerRow; }
+    const uint64_t* solidRow(unsigned int y) const { return m_solid + y * m_wordsPerRow; }
+    bool isSolid(unsigned int x, unsigned int y) const { return (solidRow(y)[x >> 6] >> (x & 63)) & 1; }
+    uint64_t countSolid() const;
+
+    bool hasCaveMask() const { return m_caveBits != nullptr; }
+    // TerrainMask value of a pixel; Empty for caves when there is no cave mask
+    uint8_t cell(unsigned int x, unsigned int y) const;
+
+    // Null when the file has no distance field
+    const float* distanceField() const { return m_distances; }
+    bool hasContours() const { return m_contours.offsets != nullptr; }
+    const ContoursView& contours() const { return m_contours; }
+
+    // Copies for code that wants owning containers
+    TerrainBitmap solidBitmap() const;
+    TerrainMask mask() const;
+
+private:
+    bool fail(std::string* error, const std::string& message);
+
+    const uint8_t* m_data{nullptr};
+    size_t m_size{0};
+#if defined(_WIN32)
+    void* m_file{nullptr};
+    void* m_mapping{nullptr};
+#endif
+
+    unsigned int m_width{0};
+    unsigned int m_height{0};
+    uint32_t m_seed{0};
+    size_t m_wordsPerRow{0};
+    const uint8_t* m_params{nullptr};
+    size_t m_paramsSize{0};
+    const CaveDesc* m_caves{nullptr};
+    size_t m_caveCount{0};
+    const uint64_t* m_solid{nullptr};
+    const uint64_t* m_caveBits{nullptr};
+    const float* m_distances{nullptr};
+    ContoursView m_contours;
+};
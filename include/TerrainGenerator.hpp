@@ -2,10 +2,28 @@
 #define _USE_MATH_DEFINES
 
 #include <SFML/Graphics.hpp>
+#include "DistanceField.hpp"
+#include "GenerationWorker.hpp"
+#include "MaskExport.hpp"
+#include "MaskRasterizer.hpp"
+#include "TerrainBitmap.hpp"
+#include "CavePlacement.hpp"
+#include "CaveStore.hpp"
+#include "TerrainCache.hpp"
+#include "TerrainCollision.hpp"
+#include "TerrainContours.hpp"
+#include "TerrainEdit.hpp"
+#include "TerrainFile.hpp"
+#include "TerrainOutline.hpp"
+#include "TerrainParams.hpp"
+#include "SpanMask.hpp"
 #include <vector>
 #include <random>
+#include <chrono>
 #include <cmath>
+#include <cstdint>
 #include <functional>
+#include <memory>
 
 class TerrainGenerator {
 public:
@@ -19,9 +37,29 @@ public:
         float noiseOffset;   // Offset for noise sampling
     };
 
+    enum class StatsMode {
+        Exact,    // Pixel-exact, from outline spans or the cached mask when that is cheaper
+        Estimate  // Area from the outline geometry; falls back to Exact once that is the cheaper one
+    };
+
     struct TerrainStats {
         uint32_t visibleTerrainPixels{0};  // Black pixels not covered by caves
         float terrainCoverage{0.0f};       // Percentage of screen that is visible terrain
+        uint64_t generation{0};            // Parameter generation the stats were computed from
+        StatsMode mode{StatsMode::Exact};
+        bool exact{false};                 // Pixel-exact result
+        bool fromRaster{false};            // Exact mode counted the cached mask instead of spans
+        bool estimateFallback{false};      // Estimate mode: the estimate gave up, the exact count was used
+        uint32_t edits{0};                 // Carve/fill edits included, kept up to date incrementally
+        double milliseconds{0.0};          // Time the computation took (the estimate in Estimate mode)
+        double fallbackMilliseconds{0.0};  // Time of the exact count after a fallback
+    };
+
+    struct TerrainData {
+        uint64_t generation{0};        // Parameter generation the data was rendered from
+        unsigned int width{0};
+        unsigned int height{0};
+        std::vector<uint8_t> pixels;   // 1 for terrain, 0 for air
     };
 
     struct ExportSettings {
@@ -29,10 +67,66 @@ public:
         bool transparentCaves{false};
     };
 
+    // Geometry submitted by the last regeneration
+    struct RenderCounters {
+        uint64_t generation{0};
+        size_t polygons{0};       // Blobs plus caves
+        size_t outlinePoints{0};
+        size_t tessellatedCaves{0};  // Cave outlines built rather than reused from the last build
+        size_t vertices{0};       // GPU vertices submitted, 0 on the CPU backend
+        size_t drawCalls{0};      // GPU draw calls issued, 0 on the CPU backend
+    };
+
+    // CPU backend regenerations handed to the background worker
+    struct BackgroundStats {
+        bool enabled{false};
+        bool busy{false};           // A generation is being built right now
+        uint64_t requests{0};
+        uint64_t skipped{0};        // Superseded by a newer request before the worker got to them
+        double milliseconds{0.0};   // Build time of the last finished generation
+    };
+
+    // Progressive preview on the CPU backend. While parameters keep changing
+    // the terrain is generated at `previewScale` of the resolution and point
+    // counts and shown upscaled; once nothing changed for `idleSeconds` it
+    // is refined in stages, doubling the scale each time, up to full quality.
+    struct ProgressiveSettings {
+        bool enabled{true};
+        float idleSeconds{0.25f};
+        float previewScale{0.25f};
+    };
+
+    // Cost of the last build of one stage, to tune the settings above
+    struct StageStats {
+        float scale{1.0f};
+        uint64_t generation{0};           // 0 until the stage was built once
+        double buildMilliseconds{0.0};    // Outlines plus rasterization
+        double uploadMilliseconds{0.0};   // Recolor and texture upload on the UI thread
+        bool fromCache{false};            // Build time was a cache lookup
+    };
+
+    // Where the terrain gets rasterized. Cpu fills a mask with the scanline
+    // rasterizer from terrain_core and uploads it; Gpu draws into a RenderTexture.
+    enum class RenderBackend {
+        Cpu,
+        Gpu
+    };
+
     explicit TerrainGenerator(unsigned int width, unsigned int height);
 
-    // Main generation method
-    sf::RenderTexture& generateTerrain();
+    // Main generation method. Only re-renders when a parameter changed since
+    // the last call, otherwise the cached texture is returned as-is. With
+    // background generation on the CPU backend it never waits: a change is
+    // handed to the worker and the texture shows the newest finished
+    // generation until the current one lands, so isDirty() may stay true for
+    // a few frames.
+    const sf::Texture& generateTerrain();
+
+    // Parameter generation, bumped by every change that goes through notifyUpdate()
+    uint64_t getGeneration() const { return m_generation; }
+    // Generation the cached texture was last rendered from
+    uint64_t getRenderedGeneration() const { return m_renderedGeneration; }
+    bool isDirty() const { return m_generation != m_renderedGeneration; }
 
     // Register callback for terrain updates
     void onTerrainUpdated(UpdateCallback callback) { m_updateCallback = callback; }
@@ -43,6 +137,11 @@ public:
     void setHorizontalStretch(float stretch);
     void setNoiseFrequency(float freq);
     void setNoiseAmplitude(float amp);
+    // Noise type shared by blob and cave outlines; octaves are clamped to
+    // 1 .. MaxNoiseOctaves
+    void setNoiseBasis(NoiseBasis basis);
+    void setNoiseFractal(NoiseFractal fractal);
+    void setNoiseOctaves(int octaves);
     void setBlobCount(int count);
     void setBlobSpacing(float spacing);
     void setCavesEnabled(bool enabled);
@@ -51,7 +150,31 @@ public:
     void setCaveNoiseAmplitude(float amp);
     void setCaveCount(int count);
     void setCavePointCount(int count);
+    // Selection only marks a cave for the editing calls below; it does not
+    // count as a change, so it never regenerates or drops runtime edits
     void setSelectedCaveIndex(int index);
+    // Selection by handle, which follows the cave when others are removed
+    void setSelectedCave(CaveHandle cave);
+    // Switching placement or its settings lays the caves out anew. Poisson-disc
+    // layouts also follow cave size changes (and blob shape changes while
+    // caves stay inside the blobs), dropping individual cave tweaks.
+    void setCavePlacement(CavePlacement placement);
+    void setCaveSpacing(float spacing);
+    void setCavesInsideBlobs(bool inside);
+    // Terrain seed; it shifts the blob noise and the caves are derived from
+    // it one by one, so the same seed and parameters always give the same
+    // terrain. Starts out random.
+    void setSeed(uint32_t seed);
+    // Takes over every parameter and the cave list at once, e.g. a gallery
+    // variant; the canvas size stays as it is
+    void setParams(const TerrainParams& params);
+    void setRenderBackend(RenderBackend backend);
+    // On by default; the GPU backend always renders on the calling thread
+    void setBackgroundGeneration(bool enabled);
+    void setProgressiveSettings(const ProgressiveSettings& settings);
+    // Generated terrains and distance fields are looked up by terrainParamsHash()
+    // before anything is built; null turns caching off. CPU backend only.
+    void setCache(std::shared_ptr<TerrainCache> cache);
 
     // Getters
     int getPointCount() const { return m_pointCount; }
@@ -59,6 +182,9 @@ public:
     float getHorizontalStretch() const { return m_horizontalStretch; }
     float getNoiseFrequency() const { return m_noiseFrequency; }
     float getNoiseAmplitude() const { return m_noiseAmplitude; }
+    NoiseBasis getNoiseBasis() const { return m_noiseBasis; }
+    NoiseFractal getNoiseFractal() const { return m_noiseFractal; }
+    int getNoiseOctaves() const { return m_noiseOctaves; }
     int getBlobCount() const { return m_blobCount; }
     float getBlobSpacing() const { return m_blobSpacing; }
     bool getCavesEnabled() const { return m_cavesEnabled; }
@@ -67,33 +193,124 @@ public:
     float getCaveNoiseAmplitude() const { return m_caveNoiseAmplitude; }
     int getCaveCount() const { return m_caveCount; }
     int getCavePointCount() const { return m_cavePointCount; }
-    int getSelectedCaveIndex() const { return m_selectedCaveIndex; }
+    int getSelectedCaveIndex() const { return m_caves.index(m_selectedCave); }
+    CaveHandle getSelectedCave() const { return m_selectedCave; }
+    const CaveStore& getCaves() const { return m_caves; }
+    CavePlacement getCavePlacement() const { return m_cavePlacement; }
+    float getCaveSpacing() const { return m_caveSpacing; }
+    bool getCavesInsideBlobs() const { return m_cavesInsideBlobs; }
+    // Poisson-disc placement stops early when no more caves fit
+    size_t getPlacedCaveCount() const { return m_caves.size(); }
+    uint32_t getSeed() const { return m_seed; }
+    RenderBackend getRenderBackend() const { return m_backend; }
+    const RenderCounters& getRenderCounters() const { return m_counters; }
+    BackgroundStats getBackgroundStats() const;
+    const std::shared_ptr<TerrainCache>& getCache() const { return m_cache; }
+    // Content hash of the rendered generation's parameters
+    uint64_t getRenderedKey() const { return m_renderedKey; }
+    const ProgressiveSettings& getProgressiveSettings() const { return m_progressive; }
+    // Coarsest stage first, full quality last
+    const std::vector<StageStats>& getStageStats() const { return m_stageStats; }
+    // Terrain pixels per pixel of the texture generateTerrain() returns;
+    // above 1 while a preview stands in for the terrain, draw it scaled up
+    float getDisplayScale() const;
 
-    // Cave manipulation
+    // Current parameters as plain data, usable by the SFML-free terrain core.
+    // Copies every cave out of the store into params.caves, which is what a
+    // snapshot for another thread or a file needs; code on this thread pairs
+    // getShapeParams() with getCaves() instead.
+    TerrainParams getParams() const;
+    // Same without the cave list, which stays cheap with many caves
+    TerrainParams getShapeParams() const;
+    // Mask of the last rendered generation; read back from the GPU when needed.
+    // Previews are never rendered generations, queries keep the full-quality
+    // terrain until the refined one lands.
+    const TerrainMask& getMask() const;
+    // Solid pixels of the last rendered generation, 64 per word, cached per generation
+    const TerrainBitmap& getBitmap() const;
+    // Solid pixels as row runs, rasterized straight from the outlines and
+    // patched by edits; memory follows the boundary, not the canvas size
+    const SpanMask& getSpanMask() const;
+    // Point, box, ray and nearest-solid queries over getBitmap(), built once per generation
+    const TerrainCollision& getCollision() const;
+    // Signed distance to the terrain edge per pixel, cached per generation
+    const DistanceField& getDistanceField() const;
+    // Simplified boundary loops for physics, cached per generation and tolerance;
+    // edits re-trace only the tiles they touch
+    const TerrainContours& getContours(float tolerance = 1.0f) const;
+    const ContourStats& getContourStats() const { return m_contourStats; }
+
+    // Runtime edits for explosions and digging. They change the rendered
+    // terrain in place: the mask, the bitmap, the collision index and the
+    // stats are patched for the touched rect and only that part of the
+    // texture is re-uploaded on the next generateTerrain(). A parameter
+    // change regenerates the terrain and drops all edits.
+    // roughness 0 gives a circle, higher values a noisier outline.
+    void carve(sf::Vector2f center, float radius, float roughness = 0.5f);
+    void fill(sf::Vector2f center, float radius, float roughness = 0.5f);
+    uint32_t getEditCount() const { return m_editCount; }
+
+    // Cave manipulation. Only the edited cave's outline is rebuilt.
     void updateSelectedCave(float scale, float rotation, float noiseOffset);
+    // Swap-removes the selected cave: the last cave takes its index, handles
+    // stay valid. It counts as an edit, the cave count setting is unchanged.
+    void removeSelectedCave();
     Cave getSelectedCaveProperties() const;
+    // Cave under a terrain position, through a spatial hash built once per generation; -1 for none
+    int findCaveAt(sf::Vector2f position) const;
     void regenerateCavePositions();
     void regenerateSelectedCavePosition();
 
-    TerrainStats calculateStats() const;
+    // Computed from geometry, never reads back from the GPU. Cached per generation and mode.
+    TerrainStats calculateStats(StatsMode mode = StatsMode::Exact) const;
 
     // Save the terrain to a file
     bool saveToFile(const std::string& filename) const;
     bool saveToFile(const std::string& filename, bool transparentBg) const;
     bool saveToFile(const std::string& filename, const ExportSettings& settings) const;
+    // Writes getDistanceField(); `range` is the distance mapped to black/white in the PNG formats
+    bool saveDistanceField(const std::string& filename, DistanceFieldFormat format, float range = 32.0f) const;
+    // Binary loop format described at writeContours()
+    bool saveContours(const std::string& filename, float tolerance = 1.0f) const;
+    // Native memory-mappable format (see TerrainFile.hpp): parameters, caves and
+    // the edited mask, plus the distance field and contours when asked for
+    bool saveTerrainFile(const std::string& filename, bool withDistanceField = false,
+                         bool withContours = false, float contourTolerance = 1.0f) const;
+    // Snapshots the mask and encodes it as PNG on one of the queue's threads.
+    // Always writes PNG, whatever the extension.
+    ExportQueue::JobId saveToFileAsync(ExportQueue& queue, const std::string& filename,
+                                       const ExportSettings& settings) const;
+    // Regenerates the current parameters `scale` times larger straight into a
+    // PNG, band by band, so the size is not bound by texture or image limits.
+    // Runtime edits are not part of the parameters and are left out.
+    ExportQueue::JobId saveLargeToFileAsync(ExportQueue& queue, const std::string& filename, float scale,
+                                            const ExportSettings& settings) const;
     
-    // Optional: Get raw bitmap data for direct game engine usage
+    // Byte per pixel view of getBitmap(), kept for existing callers
     std::vector<uint8_t> getTerrainData() const;
+    // Same data tagged with the generation it was read back from, cached per generation
+    const TerrainData& getVersionedTerrainData() const;
 
 private:
     void drawBlob(sf::RenderTexture& target);
     void drawMultiBlob(sf::RenderTexture& target);
-    void subtractBlob(sf::RenderTexture& target, const sf::Vector2f& center);
-    float noise2D(float x, float y);
-    float fade(float t);
-    float lerp(float t, float a, float b);
-    float grad(int hash, float x, float y);
-    void notifyUpdate() { if (m_updateCallback) m_updateCallback(); }
+    void subtractBlob(sf::RenderTexture& target, const float* xs, const float* ys, size_t count);
+    void addBlob(sf::RenderTexture& target, const float* xs, const float* ys, size_t count);
+    void applyEdit(sf::Vector2f center, float radius, float roughness, uint8_t value);
+    void flushEdits();
+    void uploadMask();
+    unsigned int nextStage() const;
+    TerrainParams stageParams(unsigned int stage) const;
+    void adoptResult(GenerationResult& result);
+    void showPreview(const GenerationResult& result);
+    // Lays Poisson-disc caves out again after a change they depend on
+    void relayoutSpacedCaves(bool blobShapeChanged);
+    void notifyUpdate() {
+        ++m_generation;
+        m_previousChange = m_lastChange;
+        m_lastChange = std::chrono::steady_clock::now();
+        if (m_updateCallback) m_updateCallback();
+    }
 
     unsigned int m_width;
     unsigned int m_height;
@@ -102,6 +319,9 @@ private:
     float m_horizontalStretch{1.0f};
     float m_noiseFrequency{1.0f};
     float m_noiseAmplitude{1.0f};
+    NoiseBasis m_noiseBasis{NoiseBasis::Perlin};
+    NoiseFractal m_noiseFractal{NoiseFractal::Fbm};
+    int m_noiseOctaves{1};
     int m_blobCount{1};
     float m_blobSpacing{1.5f};
     bool m_cavesEnabled{true};
@@ -110,10 +330,67 @@ private:
     float m_caveNoiseAmplitude{1.0f};
     int m_caveCount{0};
     int m_cavePointCount{20};
-    std::vector<Cave> m_caves;
-    int m_selectedCaveIndex{-1};
+    CavePlacement m_cavePlacement{CavePlacement::Uniform};
+    float m_caveSpacing{1.0f};
+    bool m_cavesInsideBlobs{false};
+    CaveStore m_caves;
+    CaveHandle m_selectedCave;
     //std::optional<sf::RenderTexture> m_terrainTexture;
     sf::RenderTexture m_terrainTexture;
-    std::mt19937 m_rng{std::random_device{}()};
+    RenderBackend m_backend{RenderBackend::Cpu};
+    TerrainOutlines m_outlines;
+    CaveOutlineCache m_caveOutlines;  // For outlines built on this thread, the worker keeps its own
+    sf::VertexArray m_vertices{sf::PrimitiveType::Triangles};  // GPU backend geometry, reused
+    RenderCounters m_counters;
+    std::shared_ptr<TerrainCache> m_cache;
+    std::unique_ptr<GenerationWorker> m_worker;
+    GenerationResult m_workerResult;        // Buffers swapped with the worker's
+    uint64_t m_requestedGeneration{0};
+    unsigned int m_requestedStage{0};
+    ProgressiveSettings m_progressive;
+    std::vector<StageStats> m_stageStats;
+    std::chrono::steady_clock::time_point m_lastChange;
+    std::chrono::steady_clock::time_point m_previousChange;
+    sf::Texture m_previewTexture;
+    uint64_t m_previewGeneration{0};        // Shown in place of the terrain while newer than the rendered one
+    unsigned int m_previewStage{0};
+    mutable TerrainMask m_mask;
+    mutable uint64_t m_maskGeneration{0};
+    mutable TerrainBitmap m_bitmap;
+    mutable uint64_t m_bitmapGeneration{0};
+    mutable SpanMask m_spans;
+    mutable uint64_t m_spansGeneration{0};
+    mutable TerrainCollision m_collision;
+    mutable uint64_t m_collisionGeneration{0};
+    mutable DistanceField m_distanceField;
+    mutable uint64_t m_distanceFieldGeneration{0};
+    mutable ContourExtractor m_contourExtractor;
+    mutable TerrainContours m_contours;
+    mutable ContourStats m_contourStats;
+    mutable uint64_t m_contoursGeneration{0};
+    mutable float m_contoursTolerance{-1.0f};
+    mutable DirtyRect m_contoursDirty;  // Edited since the last extraction
+    mutable CaveSpatialHash m_caveHash;
+    mutable uint64_t m_caveHashGeneration{0};
+    sf::Texture m_maskTexture;
+    std::vector<uint8_t> m_pixels;  // RGBA staging buffer for m_maskTexture
+    uint32_t m_seed{0};
+    std::mt19937 m_rng;  // Seeded with m_seed, only for rerolling single caves
     UpdateCallback m_updateCallback;
+
+    // Change tracking: m_generation moves on every parameter change, the
+    // texture and everything derived from it remember which one they saw
+    uint64_t m_generation{1};
+    uint64_t m_renderedGeneration{0};
+    uint64_t m_renderedKey{0};
+    mutable TerrainStats m_cachedStats[2];  // Indexed by StatsMode
+
+    // Edits applied on top of the rendered generation
+    ScanlineRasterizer m_editRasterizer;
+    std::vector<float> m_editXs;
+    std::vector<float> m_editYs;
+    std::vector<DirtyRect> m_dirtyRects;    // Not uploaded yet
+    uint32_t m_editCount{0};
+    int64_t m_editedSolidPixels{0};
+    mutable TerrainData m_cachedData;
 };
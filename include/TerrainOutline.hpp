@@ -0,0 +1,109 @@
+#pragma once
+
+#include "CaveStore.hpp"
+#include "TerrainParams.hpp"
+#include <cstdint>
+#include <vector>
+
+struct Point2f {
+    float x{0.0f};
+    float y{0.0f};
+};
+
+// Closed polygons describing one terrain: solid surface blobs and the caves
+// carved out of them, caves painted after blobs. Stored structure-of-arrays:
+// polygon i owns points [offsets[i], offsets[i + 1]) of xs/ys, blobs first.
+// Rebuilding reuses the existing storage, so steady-state regeneration does
+// not allocate.
+struct TerrainOutlines {
+    std::vector<float> xs;
+    std::vector<float> ys;
+    std::vector<uint32_t> offsets{0};
+    uint32_t blobCount{0};
+
+    size_t polygonCount() const { return offsets.size() - 1; }
+    size_t caveCount() const { return polygonCount() - blobCount; }
+    size_t pointCount() const { return xs.size(); }
+    bool isCave(size_t polygon) const { return polygon >= blobCount; }
+    uint32_t begin(size_t polygon) const { return offsets[polygon]; }
+    uint32_t size(size_t polygon) const { return offsets[polygon + 1] - offsets[polygon]; }
+};
+
+// Outline angles for one point count, shared by every blob and cave using it
+struct AngleTable {
+    std::vector<double> angles;  // 2 * pi * j / pointCount
+    std::vector<float> cos;      // cos/sin of the angles rounded to float
+    std::vector<float> sin;
+};
+
+// Cached per point count; the returned reference stays valid for the whole run
+const AngleTable& angleTable(int pointCount);
+
+// Center of surface blob `index`; blobs are laid out on a horizontal line
+// through the middle of the canvas
+Point2f blobCenter(const TerrainParams& params, int index);
+
+// Noisy outline of surface blob `index`: params.pointCount points into xs/ys.
+// The noise is sampled at an offset taken from the blob index and
+// params.seed, so each seed gives its own blob shapes
+void buildBlobOutline(const TerrainParams& params, int index, float* xs, float* ys);
+// Same shape around any center, with the seed left out; buildBlobOutline
+// uses the blob index as noise offset
+void buildBlobOutlineAt(const TerrainParams& params, float centerX, float centerY, float noiseOffset,
+                        float* xs, float* ys);
+// Noisy outline of one cave: params.cavePointCount points into xs/ys
+void buildCaveOutline(const TerrainParams& params, const CaveDesc& cave, float* xs, float* ys);
+
+// Cave outlines kept from one build to the next. A cave is tessellated
+// again only when the cave at that position in the list or one of the
+// settings every cave outline depends on changed, so editing one cave among
+// thousands rebuilds that one and copies the rest. One per building thread.
+class CaveOutlineCache {
+public:
+    // Brings the outlines up to date with params.caves
+    void update(const TerrainParams& params);
+    // Same with the caves read from `caves`; params.caves is ignored
+    void update(const TerrainParams& params, const CaveStore& caves);
+    void clear();
+
+    size_t caveCount() const { return m_sources.size(); }
+    // Cave i owns points [i * pointsPerCave(), (i + 1) * pointsPerCave())
+    size_t pointsPerCave() const { return m_pointsPerCave; }
+    const std::vector<float>& xs() const { return m_xs; }
+    const std::vector<float>& ys() const { return m_ys; }
+    // Caves the last update() had to tessellate
+    size_t rebuiltCount() const { return m_rebuilt; }
+
+private:
+    // Everything besides the CaveDesc that buildCaveOutline() reads
+    struct Shape {
+        int baseRadius{0};
+        float caveScale{0.0f};
+        float caveNoiseFrequency{0.0f};
+        float caveNoiseAmplitude{0.0f};
+        int cavePointCount{-1};
+        NoiseBasis noiseBasis{NoiseBasis::Perlin};
+        NoiseFractal noiseFractal{NoiseFractal::Fbm};
+        int noiseOctaves{0};
+    };
+    static Shape shapeOf(const TerrainParams& params);
+    static bool sameShape(const Shape& a, const Shape& b);
+
+    template <typename CaveAt>
+    void update(const TerrainParams& params, size_t count, CaveAt caveAt);
+
+    Shape m_shape;
+    CaveStore m_sources;  // What each outline was built from
+    std::vector<float> m_xs;
+    std::vector<float> m_ys;
+    size_t m_pointsPerCave{0};
+    size_t m_rebuilt{0};
+};
+
+// All blob and cave outlines; reuses the storage already held by `out`.
+// With `caves` the cave outlines come from that cache, see CaveOutlineCache.
+void buildTerrainOutlines(const TerrainParams& params, TerrainOutlines& out, CaveOutlineCache* caves = nullptr);
+// Same with the caves read from `caves` rather than params.caves, for
+// callers holding a CaveStore; saves copying it out into a cave list
+void buildTerrainOutlines(const TerrainParams& params, const CaveStore& caves, TerrainOutlines& out,
+                          CaveOutlineCache& cache);
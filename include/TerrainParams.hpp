@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+class CaveStore;
+
+// Plain-data description of a terrain, shared by every front end (the
+// interactive SFML app, headless tools). Nothing in here depends on SFML.
+
+struct CaveDesc {
+    float x{0.0f};
+    float y{0.0f};
+    float rotation{0.0f};      // Base rotation of the cave
+    float scaleVariant{1.0f};  // Individual scale modifier
+    float noiseOffset{0.0f};   // Offset for noise sampling
+};
+
+// How placeCaves() lays out the caves
+enum class CavePlacement {
+    Uniform,      // Independent draws per cave, overlaps allowed
+    PoissonDisc   // Kept apart by their radii, see placeCavesPoissonDisc()
+};
+
+// Noise displacing the blob and cave outlines, see NoisePolicies.hpp
+enum class NoiseBasis {
+    Perlin,
+    Simplex,
+    Value
+};
+
+// How the octaves of the basis are stacked
+enum class NoiseFractal {
+    Fbm,     // Smooth sum, one octave is the plain basis
+    Ridged   // Sharp crests where the basis crosses zero
+};
+
+constexpr int MaxNoiseOctaves = 8;
+
+struct TerrainParams {
+    unsigned int width{0};
+    unsigned int height{0};
+    int pointCount{20};
+    int baseRadius{0};
+    float horizontalStretch{1.0f};
+    float noiseFrequency{1.0f};
+    float noiseAmplitude{1.0f};
+    NoiseBasis noiseBasis{NoiseBasis::Perlin};
+    NoiseFractal noiseFractal{NoiseFractal::Fbm};
+    int noiseOctaves{1};    // 1 .. MaxNoiseOctaves
+    int blobCount{1};
+    float blobSpacing{1.5f};
+    bool cavesEnabled{true};
+    float caveScale{0.3f};
+    float caveNoiseFrequency{2.0f};
+    float caveNoiseAmplitude{1.0f};
+    int caveCount{0};       // Number of caves placeCaves() generates
+    int cavePointCount{20};
+    uint32_t seed{0};       // Shifts the blob noise; placeCaves() derives the caves from it
+    CavePlacement cavePlacement{CavePlacement::Uniform};
+    float caveSpacing{1.0f};        // Poisson disc: center distance over the sum of the radii
+    bool cavesInsideBlobs{false};   // Poisson disc: whole caves inside the surface blobs
+    std::vector<CaveDesc> caves;
+};
+
+// Default parameters for a canvas, matching a freshly constructed TerrainGenerator
+TerrainParams defaultTerrainParams(unsigned int width, unsigned int height);
+
+// The same terrain on a canvas `factor` times larger: sizes and cave positions
+// scale, point counts and noise settings stay as they are
+TerrainParams scaleTerrainParams(const TerrainParams& params, float factor);
+
+// Cheap stand-in for previews: scaleTerrainParams() with the outline point
+// counts cut by the same factor. Outlines sample the same noise around the
+// circle, just more coarsely, so the shapes stay recognizable.
+TerrainParams previewTerrainParams(const TerrainParams& params, float factor);
+
+// SplitMix64 stream behind the seeded cave layouts. The conversions are
+// spelled out like ChunkedWorld's cell streams: <random> distributions
+// differ between standard libraries, and a seed must give the same caves
+// everywhere. Nothing to warm up, so one per cave costs nothing.
+class CaveRandom {
+public:
+    explicit CaveRandom(uint64_t seed) : m_state(seed) {}
+
+    uint64_t next() {
+        uint64_t value = (m_state += 0x9E3779B97F4A7C15ull);
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+        return value ^ (value >> 31);
+    }
+    // In [0, 1), from the top 24 bits
+    float unit() { return static_cast<float>(next() >> 40) / static_cast<float>(1u << 24); }
+    float range(float lo, float hi) { return lo + (hi - lo) * unit(); }
+    // In [lo, hi]
+    int range(int lo, int hi) {
+        uint64_t span = static_cast<uint64_t>(static_cast<int64_t>(hi) - lo) + 1;
+        return static_cast<int>(lo + static_cast<int64_t>(((next() >> 32) * span) >> 32));
+    }
+
+private:
+    uint64_t m_state;
+};
+
+// Random cave inside the central 60% x 40% of the canvas
+CaveDesc randomCave(std::mt19937& rng, unsigned int width, unsigned int height);
+// Cave `index` of the layout for `seed`; the same whatever the other caves are
+CaveDesc seededCave(uint32_t seed, int index, unsigned int width, unsigned int height);
+// Moves an existing cave to a new random position, keeping its shape
+void randomizeCavePosition(CaveDesc& cave, std::mt19937& rng, unsigned int width, unsigned int height);
+// Replaces params.caves with a layout for `seed` and records the seed:
+// seededCave() 0 .. caveCount - 1, or placeCavesPoissonDisc()
+void placeCaves(TerrainParams& params, uint32_t seed);
+
+// Canonical 64-bit hash of everything that affects the generated terrain:
+// every field in a fixed order and byte layout, floats by value (-0 and +0
+// agree), and the cave list only while caves are enabled. The placement
+// settings only act through the cave list and are left out. Equal hashes mean
+// equal masks, which makes it the key for TerrainCache. Changes to the
+// generation code that alter its output must bump the version it hashes in.
+uint64_t terrainParamsHash(const TerrainParams& params);
+// Same hash with the caves read from `caves` instead of params.caves
+uint64_t terrainParamsHash(const TerrainParams& params, const CaveStore& caves);
+
+// Parameter files are plain `key = value` lines using the field names above,
+// with `#` starting a comment. Missing keys keep their current value, an
+// unknown key or malformed value is an error. Caves are not stored,
+// placeCaves(params, params.seed) rebuilds the seeded layout.
+bool loadTerrainParams(const std::string& filename, TerrainParams& params, std::string& error);
+bool saveTerrainParams(const std::string& filename, const TerrainParams& params);
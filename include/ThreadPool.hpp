@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool. Every worker owns a deque: it pushes and pops
+// its own work at the back and steals from the front of the others when it
+// runs dry. Tasks submitted from outside the pool are spread round-robin.
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    // 0 threads means one per hardware thread
+    explicit ThreadPool(unsigned int threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(Task task);
+
+    // Blocks until every submitted task has finished. Must not be called from a worker.
+    void wait();
+
+    // Runs fn(begin, end) over subranges of [begin, end) no larger than `grain`
+    // and returns once all of them are done. Ranges are split recursively, so
+    // the queues stay O(log n) deep no matter how large the range is. The
+    // calling thread helps out, which makes nested calls from workers safe.
+    void parallelFor(size_t begin, size_t end, size_t grain,
+                     const std::function<void(size_t, size_t)>& fn);
+
+    unsigned int size() const { return static_cast<unsigned int>(m_workers.size()); }
+
+    // Index of the calling worker thread in this pool, or -1 for outside threads
+    int currentWorkerIndex() const;
+
+    // Process-wide pool for code that has no pool handed to it
+    static ThreadPool& shared();
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(unsigned int index);
+    bool tryRunOne(int self);
+    void finishTask();
+
+    std::vector<std::unique_ptr<WorkQueue>> m_queues;
+    std::vector<std::thread> m_workers;
+    std::atomic<size_t> m_nextQueue{0};
+
+    std::mutex m_sleepMutex;
+    std::condition_variable m_sleepCv;
+    size_t m_queued{0};      // Tasks sitting in a queue, guarded by m_sleepMutex
+    bool m_stopping{false};
+
+    std::mutex m_doneMutex;
+    std::condition_variable m_doneCv;
+    std::atomic<size_t> m_unfinished{0};
+};
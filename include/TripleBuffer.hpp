@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free handoff of the latest value from one producer thread to one
+// consumer thread. Three slots rotate between them: the producer fills its
+// back slot and publishes it by swapping it with the middle one, the consumer
+// swaps the middle one with its front slot when something new was published.
+// Neither side ever waits for the other, and values the consumer did not get
+// to in time are overwritten, so it always sees the newest one. Slots are
+// reused, so values holding buffers keep their capacity across handoffs.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() = default;
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Producer side: fill back(), then publish() it. Returns true when that
+    // replaced a value the consumer never took.
+    T& back() { return m_slots[m_back]; }
+    bool publish() {
+        uint8_t previous = m_middle.exchange(static_cast<uint8_t>(m_back | Fresh), std::memory_order_acq_rel);
+        m_back = previous & IndexMask;
+        return (previous & Fresh) != 0;
+    }
+
+    // Consumer side: true when update() would return a newer value
+    bool hasUpdate() const { return (m_middle.load(std::memory_order_acquire) & Fresh) != 0; }
+    // Moves the newest published value to front(); false when there is none
+    bool update() {
+        if (!hasUpdate()) {
+            return false;
+        }
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & IndexMask;
+        return true;
+    }
+    T& front() { return m_slots[m_front]; }
+
+private:
+    static constexpr uint8_t IndexMask = 0x3;
+    static constexpr uint8_t Fresh = 0x4;  // Middle slot was published and not taken yet
+
+    T m_slots[3];
+    uint8_t m_back{0};                     // Producer only
+    std::atomic<uint8_t> m_middle{1};
+    uint8_t m_front{2};                    // Consumer only
+};
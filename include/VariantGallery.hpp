@@ -0,0 +1,92 @@
+#pragma once
+
+#include "MaskExport.hpp"
+#include "TerrainParams.hpp"
+#include "ThreadPool.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// What varies from one gallery thumbnail to the next
+enum class GallerySweep {
+    Seed,               // Consecutive seeds from the base seed on
+    NoiseFrequency,
+    NoiseAmplitude,
+    BlobSpacing,
+    HorizontalStretch,
+    CaveScale,
+    CaveNoiseFrequency,
+    CaveNoiseAmplitude
+};
+
+struct GallerySettings {
+    GallerySweep sweep{GallerySweep::Seed};
+    float from{0.5f};            // Parameter range, ignored by seed sweeps
+    float to{2.0f};
+    unsigned int count{64};
+    unsigned int thumbnailWidth{160};  // Height follows the canvas aspect
+    MaskColors colors;
+};
+
+// Thumbnail pixels of one variant, RGBA8
+struct GalleryThumbnail {
+    size_t index{0};
+    unsigned int width{0};
+    unsigned int height{0};
+    std::vector<uint8_t> pixels;
+};
+
+// Grid of low-resolution variants of a terrain, for exploring parameters
+// side by side. generate() queues one task per variant on a thread pool;
+// each renders previewTerrainParams() of its variant at thumbnail size, and
+// the finished thumbnails are picked up with takeFinished() as they land.
+// Starting another sweep drops whatever the previous one had not finished.
+class VariantGallery {
+public:
+    // 0 threads means one per hardware thread
+    explicit VariantGallery(unsigned int threads = 0);
+    ~VariantGallery();
+
+    VariantGallery(const VariantGallery&) = delete;
+    VariantGallery& operator=(const VariantGallery&) = delete;
+
+    void generate(const TerrainParams& base, const GallerySettings& settings);
+
+    // Full-size parameters of variant `index`, what a thumbnail promotes to
+    const TerrainParams& variant(size_t index) const { return m_variants[index]; }
+    // Value of the swept parameter (or the seed) for variant `index`
+    float sweepValue(size_t index) const;
+    size_t size() const { return m_variants.size(); }
+    // Every thumbnail of the current sweep has this size
+    unsigned int thumbnailWidth() const { return m_thumbnailWidth; }
+    unsigned int thumbnailHeight() const { return m_thumbnailHeight; }
+    const GallerySettings& settings() const { return m_settings; }
+
+    // Moves out the thumbnails of the current sweep finished since the last call
+    void takeFinished(std::vector<GalleryThumbnail>& out);
+
+    size_t finishedCount() const { return m_finished.load(); }
+    bool isComplete() const { return m_finished.load() == m_variants.size(); }
+    // Time from generate() until the last thumbnail of the sweep was done
+    double fillMilliseconds() const;
+
+private:
+    void renderThumbnail(uint64_t sweep, size_t index, size_t count, const TerrainParams& params,
+                         const MaskColors& colors);
+
+    GallerySettings m_settings;
+    std::vector<TerrainParams> m_variants;
+    unsigned int m_thumbnailWidth{0};
+    unsigned int m_thumbnailHeight{0};
+    std::atomic<uint64_t> m_sweep{0};     // Bumped by every generate()
+    std::atomic<size_t> m_finished{0};
+    uint64_t m_startTime{0};
+    std::atomic<uint64_t> m_doneTime{0};
+
+    std::mutex m_mutex;
+    std::vector<GalleryThumbnail> m_ready;  // Guarded by m_mutex
+
+    ThreadPool m_pool;  // Last, so its workers stop before the rest goes away
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include "ChunkedWorld.hpp"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Draws a ChunkedWorld through a pannable camera. Chunk textures are only
+// kept for chunks that were on screen in the last frame, so GPU memory is
+// bounded by the window size just like the chunk cache bounds CPU memory.
+class WorldView {
+public:
+    explicit WorldView(const WorldSettings& settings, size_t maxChunks = 64);
+
+    ChunkedWorld& world() { return m_world; }
+    const ChunkedWorld& world() const { return m_world; }
+
+    // World position shown at the top-left corner of the target
+    double getCameraX() const { return m_cameraX; }
+    double getCameraY() const { return m_cameraY; }
+    void setCamera(double x, double y);
+    void pan(double dx, double dy) { setCamera(m_cameraX + dx, m_cameraY + dy); }
+
+    // Queues the chunks around the view, then draws every chunk that is ready
+    void draw(sf::RenderTarget& target);
+
+    size_t getTextureCount() const { return m_textures.size(); }
+    size_t getVisibleChunks() const { return m_visibleChunks; }
+    size_t getMissingChunks() const { return m_missingChunks; }
+
+private:
+    struct ChunkTexture {
+        uint64_t settingsVersion{0};
+        uint64_t lastFrame{0};
+        sf::Texture texture;
+    };
+
+    ChunkedWorld m_world;
+    double m_cameraX{0.0};
+    double m_cameraY{0.0};
+    uint64_t m_frame{0};
+    size_t m_visibleChunks{0};
+    size_t m_missingChunks{0};
+    std::unordered_map<uint64_t, ChunkTexture> m_textures;
+    std::vector<uint8_t> m_pixels;  // RGBA staging for chunk uploads
+};
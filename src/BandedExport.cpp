@@ -0,0 +1,144 @@
+#include "BandedExport.hpp"
+#include "PngWriter.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+BandRasterizer::BandRasterizer(const TerrainOutlines& outlines, unsigned int width, unsigned int height)
+    : m_outlines(outlines)
+    , m_width(width)
+    , m_height(height) {
+    size_t polygons = outlines.polygonCount();
+    m_rowBegin.resize(polygons);
+    m_rowEnd.resize(polygons);
+    for (size_t i = 0; i < polygons; i++) {
+        uint32_t begin = outlines.begin(i);
+        uint32_t count = outlines.size(i);
+        if (count < 3) {
+            m_rowBegin[i] = m_rowEnd[i] = 0;
+            continue;
+        }
+        auto [minY, maxY] = std::minmax_element(outlines.ys.data() + begin, outlines.ys.data() + begin + count);
+        // Same row range the scanline rasterizer derives from the polygon
+        m_rowBegin[i] = std::max(0, static_cast<int>(std::ceil(*minY - 0.5f)));
+        m_rowEnd[i] = std::min(static_cast<int>(height), static_cast<int>(std::ceil(*maxY - 0.5f)));
+    }
+}
+
+void BandRasterizer::rasterize(unsigned int y0, unsigned int rows, uint8_t* cells) {
+    std::memset(cells, TerrainMask::Empty, static_cast<size_t>(m_width) * rows);
+    int bandBegin = static_cast<int>(y0);
+    int bandEnd = static_cast<int>(std::min(m_height, y0 + rows));
+
+    for (size_t i = 0; i < m_rowBegin.size(); i++) {
+        if (m_rowBegin[i] >= bandEnd || m_rowEnd[i] <= bandBegin) {
+            continue;
+        }
+        uint32_t begin = m_outlines.begin(i);
+        uint8_t value = m_outlines.isCave(i) ? TerrainMask::Cave : TerrainMask::Solid;
+        m_rasterizer.fillRows(m_outlines.xs.data() + begin, m_outlines.ys.data() + begin, m_outlines.size(i),
+            static_cast<int>(m_width), bandBegin, bandEnd,
+            [this, cells, bandBegin, value](int y, int x0, int x1) {
+                std::memset(cells + static_cast<size_t>(y - bandBegin) * m_width + x0, value, x1 - x0);
+            });
+    }
+}
+
+bool exportTerrainBanded(const TerrainOutlines& outlines, unsigned int width, unsigned int height,
+                         const BandedExportOptions& options, BandedExportStats* stats,
+                         std::atomic<unsigned int>* rowsDone, const std::atomic<bool>* cancel,
+                         std::string* error) {
+    PROFILE_ZONE("exportTerrainBanded");
+    auto start = std::chrono::steady_clock::now();
+    auto fail = [&](const std::string& message) {
+        if (error) *error = message;
+        return false;
+    };
+    if (width == 0 || height == 0) {
+        return fail("empty terrain");
+    }
+
+    unsigned int bandRows = static_cast<unsigned int>(std::max<size_t>(1, std::min<size_t>(
+        options.memoryBudget / width, height)));
+    std::vector<uint8_t> band(static_cast<size_t>(width) * bandRows);
+
+    PngWriter png;
+    if (!options.pngFile.empty()) {
+        // Palette order matches the TerrainMask cell values
+        std::vector<PngWriter::PaletteEntry> palette = {options.colors.empty, options.colors.solid, options.colors.cave};
+        if (!png.open(options.pngFile, width, height, PngWriter::Format::Indexed8, palette)) {
+            return fail("cannot open " + options.pngFile);
+        }
+    }
+    std::ofstream mask;
+    if (!options.maskFile.empty()) {
+        mask.open(options.maskFile, std::ios::binary | std::ios::trunc);
+        if (!mask) {
+            png.close();
+            return fail("cannot open " + options.maskFile);
+        }
+        // "TMSK", width, height (little-endian uint32), then one byte per cell
+        uint32_t header[3] = {0x4B534D54u, width, height};
+        mask.write(reinterpret_cast<const char*>(header), sizeof(header));
+    }
+    auto removeOutputs = [&]() {
+        png.close();
+        mask.close();
+        if (!options.pngFile.empty()) std::remove(options.pngFile.c_str());
+        if (!options.maskFile.empty()) std::remove(options.maskFile.c_str());
+    };
+
+    BandRasterizer rasterizer(outlines, width, height);
+    BandedExportStats result;
+    result.bandRows = bandRows;
+    result.bandBytes = band.size();
+    for (unsigned int y0 = 0; y0 < height; y0 += bandRows) {
+        if (cancel && cancel->load(std::memory_order_relaxed)) {
+            removeOutputs();
+            return fail("cancelled");
+        }
+        unsigned int rows = std::min(bandRows, height - y0);
+        rasterizer.rasterize(y0, rows, band.data());
+        result.bands++;
+        result.solidPixels += static_cast<uint64_t>(
+            std::count(band.begin(), band.begin() + static_cast<size_t>(width) * rows, TerrainMask::Solid));
+
+        bool ok = true;
+        for (unsigned int y = 0; ok && !options.pngFile.empty() && y < rows; y++) {
+            ok = png.writeRow(band.data() + static_cast<size_t>(y) * width);
+        }
+        if (ok && mask.is_open()) {
+            ok = static_cast<bool>(mask.write(reinterpret_cast<const char*>(band.data()),
+                                              static_cast<std::streamsize>(static_cast<size_t>(width) * rows)));
+        }
+        if (!ok) {
+            removeOutputs();
+            return fail("write error");
+        }
+        if (rowsDone) rowsDone->fetch_add(rows, std::memory_order_relaxed);
+    }
+
+    if (!options.pngFile.empty()) {
+        if (!png.close()) {
+            removeOutputs();
+            return fail("write error on " + options.pngFile);
+        }
+        result.bytesWritten += png.bytesWritten();
+    }
+    if (mask.is_open()) {
+        mask.close();
+        if (!mask) {
+            removeOutputs();
+            return fail("write error on " + options.maskFile);
+        }
+        result.bytesWritten += sizeof(uint32_t) * 3 + static_cast<uint64_t>(width) * height;
+    }
+
+    result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (stats) *stats = result;
+    return true;
+}
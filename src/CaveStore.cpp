@@ -0,0 +1,124 @@
+#include "CaveStore.hpp"
+#include <algorithm>
+
+void CaveStore::reserve(size_t count) {
+    m_xs.reserve(count);
+    m_ys.reserve(count);
+    m_rotations.reserve(count);
+    m_scaleVariants.reserve(count);
+    m_noiseOffsets.reserve(count);
+    m_slots.reserve(count);
+}
+
+void CaveStore::clear() {
+    while (!empty()) {
+        popBack();
+    }
+}
+
+CaveHandle CaveStore::add(const CaveDesc& cave) {
+    uint32_t slot = m_freeSlot;
+    if (slot != NoSlot) {
+        m_freeSlot = m_slotIndices[slot];
+    } else {
+        slot = static_cast<uint32_t>(m_slotIndices.size());
+        m_slotIndices.push_back(0);
+        m_generations.push_back(0);
+        m_live.push_back(false);
+    }
+    m_slotIndices[slot] = static_cast<uint32_t>(size());
+    m_live[slot] = true;
+    m_slots.push_back(slot);
+    m_xs.push_back(cave.x);
+    m_ys.push_back(cave.y);
+    m_rotations.push_back(cave.rotation);
+    m_scaleVariants.push_back(cave.scaleVariant);
+    m_noiseOffsets.push_back(cave.noiseOffset);
+    return CaveHandle{slot, m_generations[slot]};
+}
+
+bool CaveStore::remove(CaveHandle handle) {
+    int removed = index(handle);
+    if (removed < 0) {
+        return false;
+    }
+    size_t last = size() - 1;
+    if (static_cast<size_t>(removed) != last) {
+        // The last cave takes the gap; swapping keeps popBack() the only place that frees slots
+        std::swap(m_xs[removed], m_xs[last]);
+        std::swap(m_ys[removed], m_ys[last]);
+        std::swap(m_rotations[removed], m_rotations[last]);
+        std::swap(m_scaleVariants[removed], m_scaleVariants[last]);
+        std::swap(m_noiseOffsets[removed], m_noiseOffsets[last]);
+        std::swap(m_slots[removed], m_slots[last]);
+        m_slotIndices[m_slots[removed]] = static_cast<uint32_t>(removed);
+    }
+    popBack();
+    return true;
+}
+
+void CaveStore::truncate(size_t count) {
+    while (size() > count) {
+        popBack();
+    }
+}
+
+void CaveStore::assign(const std::vector<CaveDesc>& caves) {
+    truncate(caves.size());
+    size_t kept = size();
+    for (size_t i = 0; i < kept; i++) {
+        set(i, caves[i]);
+    }
+    reserve(caves.size());
+    for (size_t i = kept; i < caves.size(); i++) {
+        add(caves[i]);
+    }
+}
+
+int CaveStore::index(CaveHandle handle) const {
+    if (handle.slot >= m_live.size() || !m_live[handle.slot] || m_generations[handle.slot] != handle.generation) {
+        return -1;
+    }
+    return static_cast<int>(m_slotIndices[handle.slot]);
+}
+
+CaveHandle CaveStore::handle(size_t index) const {
+    if (index >= size()) {
+        return CaveHandle{};
+    }
+    uint32_t slot = m_slots[index];
+    return CaveHandle{slot, m_generations[slot]};
+}
+
+CaveDesc CaveStore::get(size_t index) const {
+    return CaveDesc{m_xs[index], m_ys[index], m_rotations[index], m_scaleVariants[index], m_noiseOffsets[index]};
+}
+
+void CaveStore::set(size_t index, const CaveDesc& cave) {
+    m_xs[index] = cave.x;
+    m_ys[index] = cave.y;
+    m_rotations[index] = cave.rotation;
+    m_scaleVariants[index] = cave.scaleVariant;
+    m_noiseOffsets[index] = cave.noiseOffset;
+}
+
+void CaveStore::copyTo(std::vector<CaveDesc>& out) const {
+    out.reserve(out.size() + size());
+    for (size_t i = 0; i < size(); i++) {
+        out.push_back(get(i));
+    }
+}
+
+void CaveStore::popBack() {
+    uint32_t slot = m_slots.back();
+    m_generations[slot]++;
+    m_live[slot] = false;
+    m_slotIndices[slot] = m_freeSlot;
+    m_freeSlot = slot;
+    m_slots.pop_back();
+    m_xs.pop_back();
+    m_ys.pop_back();
+    m_rotations.pop_back();
+    m_scaleVariants.pop_back();
+    m_noiseOffsets.pop_back();
+}
@@ -0,0 +1,334 @@
+#include "ChunkedWorld.hpp"
+#include "Profiler.hpp"
+#include "TerrainOutline.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+uint64_t splitmix64(uint64_t value) {
+    value += 0x9E3779B97F4A7C15ull;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
+
+// Deterministic random stream for one world cell. The float conversion is
+// spelled out, <random> distributions differ between standard libraries.
+class CellRandom {
+public:
+    CellRandom(uint32_t seed, int64_t cellX, int64_t cellY)
+        : m_state(splitmix64(seed ^ splitmix64(static_cast<uint64_t>(cellX) ^ splitmix64(static_cast<uint64_t>(cellY))))) {}
+
+    float next() {
+        m_state = splitmix64(m_state);
+        return static_cast<float>(m_state >> 40) / static_cast<float>(1u << 24);
+    }
+    float range(float lo, float hi) { return lo + (hi - lo) * next(); }
+
+private:
+    uint64_t m_state;
+};
+
+float cellSize(const TerrainParams& shape) {
+    return std::max(16.0f, 2.0f * shape.baseRadius * shape.blobSpacing);
+}
+
+// Furthest a blob outline can reach from its center; outline noise stays within [-1, 1]
+float blobReach(const TerrainParams& shape) {
+    float radius = shape.baseRadius * (1.0f + 0.5f * std::fabs(shape.noiseAmplitude));
+    return radius * std::max(1.0f, shape.horizontalStretch) + 1.0f;
+}
+
+} // namespace
+
+bool sameWorldShape(const TerrainParams& a, const TerrainParams& b) {
+    return a.pointCount == b.pointCount && a.baseRadius == b.baseRadius &&
+           a.horizontalStretch == b.horizontalStretch && a.noiseFrequency == b.noiseFrequency &&
+           a.noiseAmplitude == b.noiseAmplitude && a.noiseBasis == b.noiseBasis &&
+           a.noiseFractal == b.noiseFractal && a.noiseOctaves == b.noiseOctaves &&
+           a.blobSpacing == b.blobSpacing && a.cavesEnabled == b.cavesEnabled && a.caveScale == b.caveScale &&
+           a.caveNoiseFrequency == b.caveNoiseFrequency && a.caveNoiseAmplitude == b.caveNoiseAmplitude &&
+           a.cavePointCount == b.cavePointCount;
+}
+
+void generateChunk(const WorldSettings& settings, ChunkCoord coord, TerrainMask& mask) {
+    PROFILE_ZONE("generateChunk");
+    const TerrainParams& shape = settings.shape;
+    const double size = settings.chunkSize;
+    const double originX = coord.x * size;
+    const double originY = coord.y * size;
+    const double cell = cellSize(shape);
+    const double reach = blobReach(shape);
+
+    // Every cell whose blob could reach into this chunk
+    int64_t cellX0 = static_cast<int64_t>(std::floor((originX - reach) / cell));
+    int64_t cellY0 = static_cast<int64_t>(std::floor((originY - reach) / cell));
+    int64_t cellX1 = static_cast<int64_t>(std::floor((originX + size + reach) / cell));
+    int64_t cellY1 = static_cast<int64_t>(std::floor((originY + size + reach) / cell));
+
+    TerrainParams local = shape;
+    local.width = settings.chunkSize;
+    local.height = settings.chunkSize;
+
+    struct Blob {
+        float x;
+        float y;
+        float noiseOffset;
+    };
+    std::vector<Blob> blobs;
+    std::vector<CaveDesc> caves;
+    for (int64_t cy = cellY0; cy <= cellY1; cy++) {
+        for (int64_t cx = cellX0; cx <= cellX1; cx++) {
+            CellRandom random(settings.seed, cx, cy);
+            if (random.next() >= settings.blobChance) {
+                continue;
+            }
+            // Positions relative to the chunk origin, so far-away chunks keep float precision
+            double worldX = (cx + random.range(0.25f, 0.75f)) * cell;
+            double worldY = (cy + random.range(0.25f, 0.75f)) * cell;
+            Blob blob{static_cast<float>(worldX - originX), static_cast<float>(worldY - originY),
+                      random.range(0.0f, 1000.0f)};
+            blobs.push_back(blob);
+
+            // Per blob and capped, every chunk costs the same however many caves the canvas has
+            int caveCount = shape.cavesEnabled ? std::clamp(settings.cavesPerBlob, 0, MaxWorldCavesPerBlob) : 0;
+            for (int i = 0; i < caveCount; i++) {
+                float angle = random.range(0.0f, 6.2831853f);
+                float distance = random.range(0.0f, 0.6f) * shape.baseRadius;
+                CaveDesc cave;
+                cave.x = blob.x + distance * std::cos(angle) * shape.horizontalStretch;
+                cave.y = blob.y + distance * std::sin(angle);
+                cave.rotation = random.range(0.0f, 6.2831853f);
+                cave.scaleVariant = random.range(0.8f, 1.2f);
+                cave.noiseOffset = random.range(0.0f, 10.0f);
+                caves.push_back(cave);
+            }
+        }
+    }
+
+    // Same polygon layout as a single terrain: blobs first, caves painted over them
+    TerrainOutlines outlines;
+    size_t blobPoints = static_cast<size_t>(std::max(0, shape.pointCount));
+    size_t cavePoints = static_cast<size_t>(std::max(0, shape.cavePointCount));
+    outlines.blobCount = static_cast<uint32_t>(blobs.size());
+    outlines.xs.resize(blobs.size() * blobPoints + caves.size() * cavePoints);
+    outlines.ys.resize(outlines.xs.size());
+    outlines.offsets.assign(1, 0);
+    uint32_t offset = 0;
+    for (const Blob& blob : blobs) {
+        buildBlobOutlineAt(local, blob.x, blob.y, blob.noiseOffset,
+                           outlines.xs.data() + offset, outlines.ys.data() + offset);
+        offset += static_cast<uint32_t>(blobPoints);
+        outlines.offsets.push_back(offset);
+    }
+    for (const CaveDesc& cave : caves) {
+        buildCaveOutline(local, cave, outlines.xs.data() + offset, outlines.ys.data() + offset);
+        offset += static_cast<uint32_t>(cavePoints);
+        outlines.offsets.push_back(offset);
+    }
+
+    rasterizeTerrain(outlines, settings.chunkSize, settings.chunkSize, mask);
+}
+
+ChunkedWorld::ChunkedWorld(const WorldSettings& settings, size_t maxChunks, unsigned int threads)
+    : m_settings(settings), m_maxChunks(std::max<size_t>(maxChunks, 1)) {
+    threads = std::max(threads, 1u);
+    for (unsigned int i = 0; i < threads; i++) {
+        m_workers.emplace_back([this] { workerLoop(); });
+    }
+}
+
+ChunkedWorld::~ChunkedWorld() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        m_requests.clear();
+    }
+    m_wake.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void ChunkedWorld::setSettings(const WorldSettings& settings) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_settings = settings;
+    m_settingsVersion++;
+    m_cache.clear();
+    m_lru.clear();
+    m_requests.clear();
+}
+
+WorldSettings ChunkedWorld::settings() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_settings;
+}
+
+uint64_t ChunkedWorld::settingsVersion() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_settingsVersion;
+}
+
+ChunkCoord ChunkedWorld::chunkAt(double worldX, double worldY) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    double size = m_settings.chunkSize;
+    return ChunkCoord{static_cast<int32_t>(std::floor(worldX / size)), static_cast<int32_t>(std::floor(worldY / size))};
+}
+
+std::shared_ptr<const TerrainChunk> ChunkedWorld::lookup(uint64_t chunkKey) {
+    auto it = m_cache.find(chunkKey);
+    if (it == m_cache.end()) {
+        return nullptr;
+    }
+    m_lru.splice(m_lru.begin(), m_lru, it->second.order);
+    return it->second.chunk;
+}
+
+void ChunkedWorld::insert(std::shared_ptr<const TerrainChunk> chunk) {
+    uint64_t chunkKey = key(chunk->coord);
+    if (m_cache.count(chunkKey)) {
+        return;
+    }
+    while (m_cache.size() >= m_maxChunks) {
+        m_cache.erase(m_lru.back());
+        m_lru.pop_back();
+    }
+    m_lru.push_front(chunkKey);
+    m_cache[chunkKey] = CacheEntry{std::move(chunk), m_lru.begin()};
+}
+
+bool ChunkedWorld::isInFlight(uint64_t chunkKey) const {
+    return std::find(m_inFlight.begin(), m_inFlight.end(), chunkKey) != m_inFlight.end();
+}
+
+std::shared_ptr<const TerrainChunk> ChunkedWorld::tryGetChunk(ChunkCoord coord) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (auto chunk = lookup(key(coord))) {
+            return chunk;
+        }
+        if (!isInFlight(key(coord))) {
+            m_requests.remove(coord);
+            m_requests.push_front(coord);
+        }
+    }
+    m_wake.notify_one();
+    return nullptr;
+}
+
+std::shared_ptr<const TerrainChunk> ChunkedWorld::getChunk(ChunkCoord coord) {
+    WorldSettings settings;
+    uint64_t version;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (auto chunk = lookup(key(coord))) {
+            return chunk;
+        }
+        settings = m_settings;
+        version = m_settingsVersion;
+    }
+
+    auto chunk = std::make_shared<TerrainChunk>();
+    chunk->coord = coord;
+    chunk->settingsVersion = version;
+    generateChunk(settings, coord, chunk->mask);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (version == m_settingsVersion) {
+        insert(chunk);
+    }
+    return chunk;
+}
+
+void ChunkedWorld::prefetch(double minX, double minY, double maxX, double maxY, int margin) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        double size = m_settings.chunkSize;
+        int32_t x0 = static_cast<int32_t>(std::floor(minX / size)) - margin;
+        int32_t y0 = static_cast<int32_t>(std::floor(minY / size)) - margin;
+        int32_t x1 = static_cast<int32_t>(std::floor(maxX / size)) + margin;
+        int32_t y1 = static_cast<int32_t>(std::floor(maxY / size)) + margin;
+        double centerX = (minX + maxX) / (2.0 * size) - 0.5;
+        double centerY = (minY + maxY) / (2.0 * size) - 0.5;
+
+        std::vector<ChunkCoord> wanted;
+        for (int32_t y = y0; y <= y1; y++) {
+            for (int32_t x = x0; x <= x1; x++) {
+                uint64_t chunkKey = key(ChunkCoord{x, y});
+                auto it = m_cache.find(chunkKey);
+                if (it != m_cache.end()) {
+                    // Still in view, keep it away from the eviction end
+                    m_lru.splice(m_lru.begin(), m_lru, it->second.order);
+                } else if (!isInFlight(chunkKey)) {
+                    wanted.push_back(ChunkCoord{x, y});
+                }
+            }
+        }
+        std::sort(wanted.begin(), wanted.end(), [centerX, centerY](const ChunkCoord& a, const ChunkCoord& b) {
+            double da = (a.x - centerX) * (a.x - centerX) + (a.y - centerY) * (a.y - centerY);
+            double db = (b.x - centerX) * (b.x - centerX) + (b.y - centerY) * (b.y - centerY);
+            return da < db;
+        });
+        // Never queue more than the cache can hold, or prefetched chunks would evict each other
+        if (wanted.size() > m_maxChunks) {
+            wanted.resize(m_maxChunks);
+        }
+        m_requests.assign(wanted.begin(), wanted.end());
+    }
+    m_wake.notify_all();
+}
+
+size_t ChunkedWorld::cachedCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_cache.size();
+}
+
+size_t ChunkedWorld::pendingCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_requests.size() + m_inFlight.size();
+}
+
+size_t ChunkedWorld::memoryBytes() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t total = 0;
+    for (const auto& entry : m_cache) {
+        total += entry.second.chunk->mask.cells.size();
+    }
+    return total;
+}
+
+void ChunkedWorld::workerLoop() {
+    Profiler::instance().setThreadName("chunk worker");
+    for (;;) {
+        ChunkCoord coord;
+        WorldSettings settings;
+        uint64_t version;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_stopping || !m_requests.empty(); });
+            if (m_stopping) {
+                return;
+            }
+            coord = m_requests.front();
+            m_requests.pop_front();
+            if (m_cache.count(key(coord)) || isInFlight(key(coord))) {
+                continue;
+            }
+            m_inFlight.push_back(key(coord));
+            settings = m_settings;
+            version = m_settingsVersion;
+        }
+
+        auto chunk = std::make_shared<TerrainChunk>();
+        chunk->coord = coord;
+        chunk->settingsVersion = version;
+        generateChunk(settings, coord, chunk->mask);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_inFlight.erase(std::find(m_inFlight.begin(), m_inFlight.end(), key(coord)));
+        if (version == m_settingsVersion) {
+            insert(std::move(chunk));
+        }
+    }
+}
@@ -0,0 +1,188 @@
+#include "DistanceField.hpp"
+#include "PngWriter.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+
+namespace {
+
+constexpr double NoDistance = 1e20;  // Finite, so differences of two stay meaningful
+
+// 1D squared distance transform of the sampled function f (Felzenszwalb &
+// Huttenlocher). v and z are scratch of n and n + 1 entries.
+void distanceTransform1D(const double* f, double* d, int n, int* v, double* z) {
+    const double inf = std::numeric_limits<double>::infinity();
+    auto intersect = [f](int q, int p) {
+        return ((f[q] + static_cast<double>(q) * q) - (f[p] + static_cast<double>(p) * p)) / (2.0 * (q - p));
+    };
+
+    int k = 0;
+    v[0] = 0;
+    z[0] = -inf;
+    z[1] = inf;
+    for (int q = 1; q < n; q++) {
+        double s = intersect(q, v[k]);
+        while (s <= z[k]) {
+            k--;
+            s = intersect(q, v[k]);
+        }
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = inf;
+    }
+
+    k = 0;
+    for (int q = 0; q < n; q++) {
+        while (z[k + 1] < q) {
+            k++;
+        }
+        double offset = q - v[k];
+        d[q] = offset * offset + f[v[k]];
+    }
+}
+
+// Vertical distance to the closest pixel of the other class in the same
+// column, for a strip of columns. Top-down then bottom-up. The largest
+// Distance value marks columns without any, so Distance must hold the
+// height.
+template <typename Distance>
+void columnPass(const TerrainBitmap& solid, Distance* g, unsigned int x0, unsigned int x1) {
+    constexpr Distance NoSource = std::numeric_limits<Distance>::max();
+    const unsigned int width = solid.width();
+    const unsigned int height = solid.height();
+    for (unsigned int y = 0; y < height; y++) {
+        Distance* row = g + static_cast<size_t>(y) * width;
+        const Distance* above = y > 0 ? row - width : nullptr;
+        for (unsigned int x = x0; x < x1; x++) {
+            if (y > 0 && solid.get(x, y) != solid.get(x, y - 1)) {
+                row[x] = 1;
+            } else if (y > 0 && above[x] != NoSource) {
+                row[x] = static_cast<Distance>(above[x] + 1);
+            } else {
+                row[x] = NoSource;
+            }
+        }
+    }
+    for (unsigned int y = height - 1; y-- > 0;) {
+        Distance* row = g + static_cast<size_t>(y) * width;
+        const Distance* below = row + width;
+        for (unsigned int x = x0; x < x1; x++) {
+            Distance fromBelow = solid.get(x, y) != solid.get(x, y + 1) ? Distance{1}
+                               : below[x] != NoSource ? static_cast<Distance>(below[x] + 1) : NoSource;
+            row[x] = std::min(row[x], fromBelow);
+        }
+    }
+}
+
+template <typename Distance>
+void transform(const TerrainBitmap& solid, DistanceField& field, ThreadPool& workers) {
+    constexpr Distance NoSource = std::numeric_limits<Distance>::max();
+    const unsigned int width = solid.width();
+    const unsigned int height = solid.height();
+
+    // A pixel's sources are the pixels of the other class, so one buffer
+    // serves both the outside and the inside transform
+    std::vector<Distance> g(static_cast<size_t>(width) * height);
+    size_t strips = (width + 63) / 64;
+    workers.parallelFor(0, strips, 1, [&](size_t begin, size_t end) {
+        unsigned int x0 = static_cast<unsigned int>(begin * 64);
+        unsigned int x1 = std::min(static_cast<unsigned int>(end * 64), width);
+        columnPass(solid, g.data(), x0, x1);
+    });
+
+    const float cap = std::sqrt(static_cast<float>(width) * width + static_cast<float>(height) * height);
+    workers.parallelFor(0, height, 16, [&](size_t begin, size_t end) {
+        std::vector<double> fOutside(width), fInside(width), dOutside(width), dInside(width), z(width + 1);
+        std::vector<int> v(width);
+        for (size_t y = begin; y < end; y++) {
+            const Distance* column = g.data() + y * width;
+            for (unsigned int x = 0; x < width; x++) {
+                double vertical = column[x] == NoSource ? NoDistance : static_cast<double>(column[x]) * column[x];
+                bool inside = solid.get(x, static_cast<unsigned int>(y));
+                fOutside[x] = inside ? 0.0 : vertical;
+                fInside[x] = inside ? vertical : 0.0;
+            }
+            distanceTransform1D(fOutside.data(), dOutside.data(), static_cast<int>(width), v.data(), z.data());
+            distanceTransform1D(fInside.data(), dInside.data(), static_cast<int>(width), v.data(), z.data());
+
+            float* out = field.distances.data() + y * width;
+            for (unsigned int x = 0; x < width; x++) {
+                bool inside = solid.get(x, static_cast<unsigned int>(y));
+                double squared = inside ? dInside[x] : dOutside[x];
+                float distance = squared >= NoDistance ? cap : static_cast<float>(std::sqrt(squared)) - 0.5f;
+                out[x] = inside ? -distance : distance;
+            }
+        }
+    });
+}
+
+} // namespace
+
+void computeDistanceField(const TerrainBitmap& solid, DistanceField& field, ThreadPool* pool) {
+    const unsigned int width = solid.width();
+    const unsigned int height = solid.height();
+    field.width = width;
+    field.height = height;
+    field.distances.resize(static_cast<size_t>(width) * height);
+    if (width == 0 || height == 0) {
+        return;
+    }
+
+    ThreadPool& workers = pool ? *pool : ThreadPool::shared();
+    // Column distances stay under the height; 16 bits halve the traffic of
+    // the column buffer on any canvas short enough for them
+    if (height < std::numeric_limits<uint16_t>::max()) {
+        transform<uint16_t>(solid, field, workers);
+    } else {
+        transform<uint32_t>(solid, field, workers);
+    }
+}
+
+std::vector<uint8_t> quantizeDistanceField8(const DistanceField& field, float range) {
+    std::vector<uint8_t> out(field.distances.size());
+    float scale = 255.0f / (2.0f * range);
+    for (size_t i = 0; i < out.size(); i++) {
+        float value = (field.distances[i] + range) * scale;
+        out[i] = static_cast<uint8_t>(std::min(std::max(value, 0.0f), 255.0f) + 0.5f);
+    }
+    return out;
+}
+
+std::vector<uint16_t> quantizeDistanceField16(const DistanceField& field, float range) {
+    std::vector<uint16_t> out(field.distances.size());
+    float scale = 65535.0f / (2.0f * range);
+    for (size_t i = 0; i < out.size(); i++) {
+        float value = (field.distances[i] + range) * scale;
+        out[i] = static_cast<uint16_t>(std::min(std::max(value, 0.0f), 65535.0f) + 0.5f);
+    }
+    return out;
+}
+
+bool writeDistanceField(const std::string& filename, const DistanceField& field,
+                        DistanceFieldFormat format, float range) {
+    switch (format) {
+    case DistanceFieldFormat::Gray8: {
+        std::vector<uint8_t> pixels = quantizeDistanceField8(field, range);
+        return writePng(filename, field.width, field.height, PngWriter::Format::Gray8, pixels.data());
+    }
+    case DistanceFieldFormat::Gray16: {
+        std::vector<uint16_t> pixels = quantizeDistanceField16(field, range);
+        return writePng(filename, field.width, field.height, PngWriter::Format::Gray16, pixels.data());
+    }
+    case DistanceFieldFormat::Float32:
+        break;
+    }
+
+    std::ofstream file(filename, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    uint32_t header[3] = {0x46445354u, field.width, field.height};  // "TSDF"
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(field.distances.data()),
+               static_cast<std::streamsize>(field.distances.size() * sizeof(float)));
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,43 @@
+#include "../include/GalleryView.hpp"
+#include <algorithm>
+
+GalleryView::GalleryView(unsigned int columns)
+    : m_columns(std::max(columns, 1u)) {
+}
+
+void GalleryView::generate(const TerrainParams& base, const GallerySettings& settings) {
+    m_gallery.generate(base, settings);
+    m_cellSize = sf::Vector2u{m_gallery.thumbnailWidth(), m_gallery.thumbnailHeight()};
+    m_ready.assign(m_gallery.size(), false);
+    m_finished.clear();
+
+    unsigned int rows = (static_cast<unsigned int>(m_gallery.size()) + m_columns - 1) / m_columns;
+    sf::Vector2u size{m_cellSize.x * m_columns, m_cellSize.y * std::max(rows, 1u)};
+    if (m_atlas.getSize() != size && !m_atlas.resize(size)) {
+        return;
+    }
+    // Cells still rendering show up empty rather than with the previous sweep
+    std::vector<uint8_t> clear(static_cast<size_t>(size.x) * size.y * 4, 0);
+    m_atlas.update(clear.data());
+}
+
+void GalleryView::update() {
+    m_finished.clear();
+    m_gallery.takeFinished(m_finished);
+    for (const GalleryThumbnail& thumbnail : m_finished) {
+        if (thumbnail.width != m_cellSize.x || thumbnail.height != m_cellSize.y) {
+            continue;
+        }
+        unsigned int column = static_cast<unsigned int>(thumbnail.index % m_columns);
+        unsigned int row = static_cast<unsigned int>(thumbnail.index / m_columns);
+        m_atlas.update(thumbnail.pixels.data(), m_cellSize, sf::Vector2u{column * m_cellSize.x, row * m_cellSize.y});
+        m_ready[thumbnail.index] = true;
+    }
+}
+
+sf::Sprite GalleryView::sprite(size_t index) const {
+    int column = static_cast<int>(index % m_columns);
+    int row = static_cast<int>(index / m_columns);
+    sf::Vector2i cell(static_cast<int>(m_cellSize.x), static_cast<int>(m_cellSize.y));
+    return sf::Sprite(m_atlas, sf::IntRect({column * cell.x, row * cell.y}, cell));
+}
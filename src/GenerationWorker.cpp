@@ -0,0 +1,109 @@
+#include "GenerationWorker.hpp"
+#include "Profiler.hpp"
+#include <chrono>
+#include <utility>
+
+void buildGeneration(const TerrainParams& params, TerrainCache* cache, bool keep, GenerationResult& result,
+                     CaveOutlineCache* caveOutlines) {
+    auto start = std::chrono::steady_clock::now();
+    result.key = terrainParamsHash(params);
+    std::shared_ptr<const CachedTerrain> cached = cache ? cache->find(result.key) : nullptr;
+    result.fromCache = cached != nullptr;
+    result.tessellatedCaves = 0;
+    if (cached) {
+        // Copied into the result's own buffers, which keep their capacity
+        result.outlines = cached->outlines;
+        result.mask = cached->mask;
+    } else {
+        {
+            PROFILE_ZONE("buildTerrainOutlines");
+            buildTerrainOutlines(params, result.outlines, caveOutlines);
+        }
+        result.tessellatedCaves = caveOutlines ? caveOutlines->rebuiltCount() : result.outlines.caveCount();
+        {
+            PROFILE_ZONE("rasterizeTerrain");
+            rasterizeTerrain(result.outlines, params.width, params.height, result.mask);
+        }
+        if (cache && keep) {
+            auto entry = std::make_shared<CachedTerrain>();
+            entry->params = params;
+            entry->outlines = result.outlines;
+            entry->mask = result.mask;
+            cache->store(result.key, std::move(entry));
+        }
+    }
+    result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+GenerationWorker::GenerationWorker(std::shared_ptr<TerrainCache> cache) : m_cache(std::move(cache)) {
+    m_thread = std::thread([this] { workerLoop(); });
+}
+
+GenerationWorker::~GenerationWorker() {
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+}
+
+void GenerationWorker::request(uint64_t generation, const TerrainParams& params, unsigned int stage, bool keep) {
+    Request& slot = m_requests.back();
+    slot.generation = generation;
+    slot.stage = stage;
+    slot.keep = keep;
+    slot.params = params;
+    m_requestCount++;
+    if (m_requests.publish()) {
+        m_skippedCount++;
+    }
+
+    // The worker holds the mutex only to check for work, never while
+    // generating; taking it here just closes the gap between its check and
+    // its wait, so the wakeup cannot get lost
+    { std::lock_guard<std::mutex> lock(m_wakeMutex); }
+    m_wake.notify_one();
+}
+
+bool GenerationWorker::takeResult(GenerationResult& result) {
+    if (!m_results.update()) {
+        return false;
+    }
+    GenerationResult& latest = m_results.front();
+    result.generation = latest.generation;
+    result.stage = latest.stage;
+    result.key = latest.key;
+    result.fromCache = latest.fromCache;
+    result.milliseconds = latest.milliseconds;
+    result.tessellatedCaves = latest.tessellatedCaves;
+    std::swap(result.outlines, latest.outlines);
+    std::swap(result.mask, latest.mask);
+    return true;
+}
+
+void GenerationWorker::workerLoop() {
+    Profiler::instance().setThreadName("generation");
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+            m_wake.wait(lock, [this] { return m_stopping || m_requests.hasUpdate(); });
+            if (m_stopping) {
+                return;
+            }
+        }
+        m_busy.store(true, std::memory_order_relaxed);
+        m_requests.update();
+        const Request& request = m_requests.front();
+
+        GenerationResult& result = m_results.back();
+        if (m_caveOutlines.size() <= request.stage) {
+            m_caveOutlines.resize(request.stage + 1);
+        }
+        buildGeneration(request.params, m_cache.get(), request.keep, result, &m_caveOutlines[request.stage]);
+        result.generation = request.generation;
+        result.stage = request.stage;
+        m_results.publish();
+        m_busy.store(false, std::memory_order_relaxed);
+    }
+}
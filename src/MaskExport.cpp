@@ -0,0 +1,235 @@
+#include "MaskExport.hpp"
+#include "BandedExport.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TERRAIN_EXPORT_SSE2 1
+#else
+#define TERRAIN_EXPORT_SSE2 0
+#endif
+
+namespace {
+
+uint32_t packColor(const PngWriter::PaletteEntry& color) {
+    uint8_t bytes[4] = {color.r, color.g, color.b, color.a};
+    uint32_t value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+} // namespace
+
+void recolorMaskRow(const uint8_t* cells, uint8_t* rgba, unsigned int count, const MaskColors& colors) {
+    const uint32_t lut[3] = {packColor(colors.empty), packColor(colors.solid), packColor(colors.cave)};
+    unsigned int x = 0;
+#if TERRAIN_EXPORT_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi32(TerrainMask::Solid);
+    const __m128i two = _mm_set1_epi32(TerrainMask::Cave);
+    const __m128i empty = _mm_set1_epi32(static_cast<int>(lut[0]));
+    const __m128i solid = _mm_set1_epi32(static_cast<int>(lut[1]));
+    const __m128i cave = _mm_set1_epi32(static_cast<int>(lut[2]));
+    for (; x + 16 <= count; x += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cells + x));
+        __m128i lo16 = _mm_unpacklo_epi8(bytes, zero);
+        __m128i hi16 = _mm_unpackhi_epi8(bytes, zero);
+        __m128i values[4] = {_mm_unpacklo_epi16(lo16, zero), _mm_unpackhi_epi16(lo16, zero),
+                             _mm_unpacklo_epi16(hi16, zero), _mm_unpackhi_epi16(hi16, zero)};
+        for (int i = 0; i < 4; i++) {
+            // Unknown values fall back to the empty color, like the scalar lookup below
+            __m128i isSolid = _mm_cmpeq_epi32(values[i], one);
+            __m128i isCave = _mm_cmpeq_epi32(values[i], two);
+            __m128i isEmpty = _mm_andnot_si128(_mm_or_si128(isSolid, isCave), _mm_set1_epi32(-1));
+            __m128i pixel = _mm_or_si128(_mm_and_si128(isEmpty, empty),
+                            _mm_or_si128(_mm_and_si128(isSolid, solid), _mm_and_si128(isCave, cave)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + (x + i * 4) * 4), pixel);
+        }
+    }
+#endif
+    for (; x < count; x++) {
+        uint8_t cell = cells[x];
+        uint32_t pixel = lut[cell <= TerrainMask::Cave ? cell : 0];
+        std::memcpy(rgba + x * 4, &pixel, sizeof(pixel));
+    }
+}
+
+bool writeMaskPng(const std::string& filename, const TerrainMask& mask, const MaskColors& colors,
+                  std::atomic<unsigned int>* rowsDone, const std::atomic<bool>* cancel,
+                  std::string* error) {
+    PngWriter writer;
+    if (!writer.open(filename, mask.width, mask.height, PngWriter::Format::Rgba8)) {
+        if (error) *error = "cannot open " + filename;
+        return false;
+    }
+
+    std::vector<uint8_t> row(static_cast<size_t>(mask.width) * 4);
+    for (unsigned int y = 0; y < mask.height; y++) {
+        if (cancel && cancel->load(std::memory_order_relaxed)) {
+            writer.close();
+            std::remove(filename.c_str());
+            if (error) *error = "cancelled";
+            return false;
+        }
+        recolorMaskRow(mask.row(y), row.data(), mask.width, colors);
+        if (!writer.writeRow(row.data())) {
+            break;
+        }
+        if (rowsDone) rowsDone->fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (!writer.close()) {
+        if (error) *error = "write error on " + filename;
+        return false;
+    }
+    return true;
+}
+
+ExportQueue::ExportQueue(unsigned int parallelJobs) {
+    parallelJobs = std::max(parallelJobs, 1u);
+    for (unsigned int i = 0; i < parallelJobs; i++) {
+        m_workers.emplace_back([this] { workerLoop(); });
+    }
+}
+
+ExportQueue::~ExportQueue() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+}
+
+ExportQueue::JobId ExportQueue::enqueue(const std::string& filename, TerrainMask mask, const MaskColors& colors) {
+    auto job = std::make_shared<Job>();
+    job->filename = filename;
+    job->height = mask.height;
+    job->mask = std::move(mask);
+    job->colors = colors;
+    return push(std::move(job));
+}
+
+ExportQueue::JobId ExportQueue::enqueueBanded(const std::string& filename, TerrainOutlines outlines, unsigned int width,
+                                              unsigned int height, const MaskColors& colors, size_t memoryBudget) {
+    auto job = std::make_shared<Job>();
+    job->filename = filename;
+    job->banded = true;
+    job->outlines = std::move(outlines);
+    job->width = width;
+    job->height = height;
+    job->colors = colors;
+    job->memoryBudget = memoryBudget;
+    return push(std::move(job));
+}
+
+ExportQueue::JobId ExportQueue::push(std::shared_ptr<Job> job) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        job->id = m_nextId++;
+        m_pending.push_back(job);
+        m_jobs.push_back(job);
+    }
+    m_wake.notify_one();
+    return job->id;
+}
+
+void ExportQueue::cancel(JobId id) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_pending.begin(); it != m_pending.end(); ++it) {
+        if ((*it)->id == id) {
+            (*it)->state = JobState::Cancelled;
+            (*it)->mask = TerrainMask{};
+            (*it)->outlines = TerrainOutlines{};
+            m_pending.erase(it);
+            return;
+        }
+    }
+    for (const auto& job : m_jobs) {
+        if (job->id == id) {
+            job->cancel = true;
+            return;
+        }
+    }
+}
+
+std::vector<ExportQueue::JobStatus> ExportQueue::jobs() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<JobStatus> result;
+    result.reserve(m_jobs.size());
+    for (const auto& job : m_jobs) {
+        JobStatus status;
+        status.id = job->id;
+        status.filename = job->filename;
+        status.state = job->state;
+        unsigned int height = job->height;
+        status.progress = status.state == JobState::Done ? 1.0f
+                        : height > 0 ? static_cast<float>(job->rowsDone) / height : 0.0f;
+        // Written by the worker before it publishes the final state
+        if (status.state != JobState::Queued && status.state != JobState::Running) {
+            status.milliseconds = job->milliseconds;
+            status.error = job->error;
+        }
+        result.push_back(std::move(status));
+    }
+    return result;
+}
+
+void ExportQueue::clearFinished() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_jobs.erase(std::remove_if(m_jobs.begin(), m_jobs.end(), [](const std::shared_ptr<Job>& job) {
+        JobState state = job->state;
+        return state != JobState::Queued && state != JobState::Running;
+    }), m_jobs.end());
+}
+
+size_t ExportQueue::activeCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return static_cast<size_t>(std::count_if(m_jobs.begin(), m_jobs.end(), [](const std::shared_ptr<Job>& job) {
+        JobState state = job->state;
+        return state == JobState::Queued || state == JobState::Running;
+    }));
+}
+
+void ExportQueue::workerLoop() {
+    Profiler::instance().setThreadName("export");
+    for (;;) {
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_stopping || !m_pending.empty(); });
+            if (m_pending.empty()) {
+                return;
+            }
+            job = m_pending.front();
+            m_pending.pop_front();
+            job->state = JobState::Running;
+        }
+
+        PROFILE_ZONE("ExportQueue::writeMaskPng");
+        auto start = std::chrono::steady_clock::now();
+        bool ok;
+        if (job->banded) {
+            BandedExportOptions options;
+            options.pngFile = job->filename;
+            options.colors = job->colors;
+            options.memoryBudget = job->memoryBudget;
+            ok = exportTerrainBanded(job->outlines, job->width, job->height, options, nullptr,
+                                     &job->rowsDone, &job->cancel, &job->error);
+        } else {
+            ok = writeMaskPng(job->filename, job->mask, job->colors, &job->rowsDone, &job->cancel, &job->error);
+        }
+        job->milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        job->mask.cells = std::vector<uint8_t>{};  // Drop the pixels, the job height stays for progress
+        job->outlines = TerrainOutlines{};
+        job->state = ok ? JobState::Done : job->cancel ? JobState::Cancelled : JobState::Failed;
+    }
+}
@@ -0,0 +1,85 @@
+#include "MaskRasterizer.hpp"
+#include <algorithm>
+#include <cstring>
+
+bool ScanlineRasterizer::buildEdges(const float* xs, const float* ys, size_t count, int clipBegin, int clipEnd,
+                                    int& rowBegin, int& rowEnd) {
+    m_edges.clear();
+    if (count < 3) {
+        return false;
+    }
+
+    float minY = ys[0];
+    float maxY = ys[0];
+    for (size_t i = 0; i < count; i++) {
+        size_t next = i + 1 == count ? 0 : i + 1;
+        Point2f a{xs[i], ys[i]};
+        Point2f b{xs[next], ys[next]};
+        minY = std::min(minY, a.y);
+        maxY = std::max(maxY, a.y);
+        if (a.y == b.y) {
+            continue;  // Horizontal edges never cross a sample row
+        }
+
+        const Point2f& top = a.y < b.y ? a : b;
+        const Point2f& bottom = a.y < b.y ? b : a;
+        m_edges.push_back(Edge{top.y, bottom.y, top.x, (bottom.x - top.x) / (bottom.y - top.y)});
+    }
+
+    // Rows whose center y + 0.5 falls inside [minY, maxY)
+    rowBegin = std::max(clipBegin, static_cast<int>(std::ceil(minY - 0.5f)));
+    rowEnd = std::min(clipEnd, static_cast<int>(std::ceil(maxY - 0.5f)));
+    if (rowBegin >= rowEnd || m_edges.empty()) {
+        return false;
+    }
+
+    std::sort(m_edges.begin(), m_edges.end(),
+              [](const Edge& a, const Edge& b) { return a.yTop < b.yTop; });
+    return true;
+}
+
+void fillPolygon(ScanlineRasterizer& rasterizer, TerrainMask& mask,
+                 const float* xs, const float* ys, size_t count, uint8_t value) {
+    rasterizer.fill(xs, ys, count, static_cast<int>(mask.width), static_cast<int>(mask.height),
+        [&mask, value](int y, int x0, int x1) {
+            std::memset(mask.row(y) + x0, value, x1 - x0);
+        });
+}
+
+void fillPolygonBits(ScanlineRasterizer& rasterizer, uint64_t* words, size_t wordsPerRow,
+                     int width, int height, const float* xs, const float* ys, size_t count) {
+    rasterizer.fill(xs, ys, count, width, height,
+        [words, wordsPerRow](int y, int x0, int x1) {
+            uint64_t* row = words + static_cast<size_t>(y) * wordsPerRow;
+            int firstWord = x0 >> 6;
+            int lastWord = (x1 - 1) >> 6;
+            uint64_t headMask = ~0ull << (x0 & 63);
+            uint64_t tailMask = ~0ull >> (63 - ((x1 - 1) & 63));
+            if (firstWord == lastWord) {
+                row[firstWord] |= headMask & tailMask;
+                return;
+            }
+            row[firstWord] |= headMask;
+            for (int w = firstWord + 1; w < lastWord; w++) {
+                row[w] = ~0ull;
+            }
+            row[lastWord] |= tailMask;
+        });
+}
+
+void rasterizeTerrain(const TerrainOutlines& outlines, unsigned int width, unsigned int height,
+                      TerrainMask& mask) {
+    if (mask.width != width || mask.height != height) {
+        mask.resize(width, height);
+    } else {
+        std::fill(mask.cells.begin(), mask.cells.end(), TerrainMask::Empty);
+    }
+
+    // Caves come last and are painted over everything, like the white shapes in the GPU path
+    ScanlineRasterizer rasterizer;
+    for (size_t i = 0; i < outlines.polygonCount(); i++) {
+        uint32_t begin = outlines.begin(i);
+        fillPolygon(rasterizer, mask, outlines.xs.data() + begin, outlines.ys.data() + begin,
+                    outlines.size(i), outlines.isCave(i) ? TerrainMask::Cave : TerrainMask::Solid);
+    }
+}
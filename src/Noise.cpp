@@ -0,0 +1,94 @@
+#include "Noise.hpp"
+#include "NoiseKernels.hpp"
+#include "NoisePolicies.hpp"
+#include <atomic>
+#include <cmath>
+
+#if TERRAIN_NOISE_X86 && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace {
+
+NoiseKernel detectNoiseKernel() {
+#if TERRAIN_NOISE_X86 && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && perlinBatchAvx2(nullptr, nullptr, nullptr, 0)) {
+        return NoiseKernel::Avx2;
+    }
+    if (__builtin_cpu_supports("sse4.1") && perlinBatchSse41(nullptr, nullptr, nullptr, 0)) {
+        return NoiseKernel::Sse41;
+    }
+#elif TERRAIN_NOISE_X86 && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool sse41 = (info[2] & (1 << 19)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    bool avx2 = false;
+    if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+    if (avx2) {
+        return NoiseKernel::Avx2;
+    }
+    if (sse41) {
+        return NoiseKernel::Sse41;
+    }
+#endif
+    return NoiseKernel::Scalar;
+}
+
+NoiseKernel s_supportedKernel = detectNoiseKernel();
+std::atomic<NoiseKernel> s_activeKernel{s_supportedKernel};
+
+} // namespace
+
+const int32_t* perlinPermutation() {
+    return NoiseTable<0>::value.p;
+}
+
+float perlinNoise2D(float x, float y) {
+    return perlinScalar(NoiseTable<0>::value.p, x, y);
+}
+
+void perlinNoise2DBatch(const float* xs, const float* ys, float* out, size_t count) {
+    switch (s_activeKernel.load(std::memory_order_relaxed)) {
+        case NoiseKernel::Avx2:
+            perlinBatchAvx2(xs, ys, out, count);
+            return;
+        case NoiseKernel::Sse41:
+            perlinBatchSse41(xs, ys, out, count);
+            return;
+        case NoiseKernel::Scalar:
+            break;
+    }
+    for (size_t i = 0; i < count; i++) {
+        out[i] = perlinScalar(NoiseTable<0>::value.p, xs[i], ys[i]);
+    }
+}
+
+NoiseKernel supportedNoiseKernel() {
+    return s_supportedKernel;
+}
+
+NoiseKernel activeNoiseKernel() {
+    return s_activeKernel.load(std::memory_order_relaxed);
+}
+
+void setNoiseKernel(NoiseKernel kernel) {
+    s_activeKernel = static_cast<int>(kernel) <= static_cast<int>(s_supportedKernel) ? kernel : s_supportedKernel;
+}
+
+const char* noiseKernelName(NoiseKernel kernel) {
+    switch (kernel) {
+        case NoiseKernel::Scalar: return "Scalar";
+        case NoiseKernel::Sse41: return "SSE4.1";
+        case NoiseKernel::Avx2: return "AVX2";
+    }
+    return "Unknown";
+}
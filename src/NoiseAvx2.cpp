@@ -0,0 +1,85 @@
+#include "NoiseKernels.hpp"
+
+#if TERRAIN_NOISE_X86 && (defined(__AVX2__) || defined(_MSC_VER))
+#include <immintrin.h>
+
+namespace {
+
+inline __m256 fade8(__m256 t) {
+    __m256 t3 = _mm256_mul_ps(_mm256_mul_ps(t, t), t);
+    __m256 inner = _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6.0f)), _mm256_set1_ps(15.0f));
+    inner = _mm256_add_ps(_mm256_mul_ps(t, inner), _mm256_set1_ps(10.0f));
+    return _mm256_mul_ps(t3, inner);
+}
+
+inline __m256 lerp8(__m256 t, __m256 a, __m256 b) {
+    return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+}
+
+inline __m256 grad8(__m256i hash, __m256 x, __m256 y) {
+    __m256i h = _mm256_and_si256(hash, _mm256_set1_epi32(15));
+    __m256 useX = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(8), h));
+    __m256 u = _mm256_blendv_ps(y, x, useX);
+
+    __m256 useY = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), h));
+    __m256 useXForV = _mm256_castsi256_ps(_mm256_or_si256(_mm256_cmpeq_epi32(h, _mm256_set1_epi32(12)),
+                                                          _mm256_cmpeq_epi32(h, _mm256_set1_epi32(14))));
+    __m256 v = _mm256_blendv_ps(_mm256_and_ps(useXForV, x), y, useY);
+
+    // Bits 0 and 1 of h flip the signs of u and v
+    __m256 signU = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(1)), 31));
+    __m256 signV = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(2)), 30));
+    return _mm256_add_ps(_mm256_xor_ps(u, signU), _mm256_xor_ps(v, signV));
+}
+
+} // namespace
+
+bool perlinBatchAvx2(const float* xs, const float* ys, float* out, size_t count) {
+    const int32_t* permutation = perlinPermutation();
+    const __m256i mask255 = _mm256_set1_epi32(255);
+    const __m256i oneI = _mm256_set1_epi32(1);
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 x = _mm256_loadu_ps(xs + i);
+        __m256 y = _mm256_loadu_ps(ys + i);
+        __m256 fx = _mm256_floor_ps(x);
+        __m256 fy = _mm256_floor_ps(y);
+        __m256i X = _mm256_and_si256(_mm256_cvttps_epi32(fx), mask255);
+        __m256i Y = _mm256_and_si256(_mm256_cvttps_epi32(fy), mask255);
+        x = _mm256_sub_ps(x, fx);
+        y = _mm256_sub_ps(y, fy);
+
+        __m256i A = _mm256_add_epi32(_mm256_i32gather_epi32(permutation, X, 4), Y);
+        __m256i B = _mm256_add_epi32(_mm256_i32gather_epi32(permutation, _mm256_add_epi32(X, oneI), 4), Y);
+        __m256i h00 = _mm256_i32gather_epi32(permutation, A, 4);
+        __m256i h10 = _mm256_i32gather_epi32(permutation, B, 4);
+        __m256i h01 = _mm256_i32gather_epi32(permutation, _mm256_add_epi32(A, oneI), 4);
+        __m256i h11 = _mm256_i32gather_epi32(permutation, _mm256_add_epi32(B, oneI), 4);
+
+        __m256 u = fade8(x);
+        __m256 v = fade8(y);
+        __m256 xm1 = _mm256_sub_ps(x, one);
+        __m256 ym1 = _mm256_sub_ps(y, one);
+
+        __m256 g00 = grad8(h00, x, y);
+        __m256 g10 = grad8(h10, xm1, y);
+        __m256 g01 = grad8(h01, x, ym1);
+        __m256 g11 = grad8(h11, xm1, ym1);
+
+        _mm256_storeu_ps(out + i, lerp8(v, lerp8(u, g00, g10), lerp8(u, g01, g11)));
+    }
+    for (; i < count; i++) {
+        out[i] = perlinScalar(permutation, xs[i], ys[i]);
+    }
+    return true;
+}
+
+#else
+
+bool perlinBatchAvx2(const float*, const float*, float*, size_t) {
+    return false;
+}
+
+#endif
@@ -0,0 +1,63 @@
+#pragma once
+
+// Private to the Noise*.cpp translation units. Every batch kernel must be
+// bit-identical to perlinScalar(), so the operation order below is the
+// reference: keep the SIMD versions in sync when changing anything here.
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define TERRAIN_NOISE_X86 1
+#else
+#define TERRAIN_NOISE_X86 0
+#endif
+
+// Perlin's permutation repeated to 512 entries, widened to int32 for gathers
+const int32_t* perlinPermutation();
+
+// Internal linkage on purpose: the kernels are built with different ISA
+// flags and must not share one out-of-line copy of this through the linker
+static inline float perlinFade(float t) {
+    // Fade function as defined by Ken Perlin
+    return t * t * t * (t * (t * 6 - 15) + 10);
+}
+
+static inline float perlinLerp(float t, float a, float b) {
+    return a + t * (b - a);
+}
+
+static inline float perlinGrad(int hash, float x, float y) {
+    // Convert low 4 bits of hash code into 12 gradient directions
+    int h = hash & 15;
+    float u = h < 8 ? x : y;
+    float v = h < 4 ? y : h == 12 || h == 14 ? x : 0;
+    return ((h & 1) == 0 ? u : -u) + ((h & 2) == 0 ? v : -v);
+}
+
+static inline float perlinScalar(const int32_t* permutation, float x, float y) {
+    float fx = std::floor(x);
+    float fy = std::floor(y);
+    int X = static_cast<int>(fx) & 255;
+    int Y = static_cast<int>(fy) & 255;
+    x -= fx;
+    y -= fy;
+
+    float u = perlinFade(x);
+    float v = perlinFade(y);
+
+    int A = permutation[X] + Y;
+    int B = permutation[X + 1] + Y;
+
+    return perlinLerp(v,
+        perlinLerp(u, perlinGrad(permutation[A], x, y),
+                      perlinGrad(permutation[B], x - 1, y)),
+        perlinLerp(u, perlinGrad(permutation[A + 1], x, y - 1),
+                      perlinGrad(permutation[B + 1], x - 1, y - 1)));
+}
+
+// Each returns false when its translation unit was built without the ISA;
+// calling with count 0 is a cheap probe for that
+bool perlinBatchSse41(const float* xs, const float* ys, float* out, size_t count);
+bool perlinBatchAvx2(const float* xs, const float* ys, float* out, size_t count);
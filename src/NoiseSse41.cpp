@@ -0,0 +1,91 @@
+#include "NoiseKernels.hpp"
+
+#if TERRAIN_NOISE_X86 && (defined(__SSE4_1__) || defined(_MSC_VER))
+#include <smmintrin.h>
+
+namespace {
+
+inline __m128 fade4(__m128 t) {
+    __m128 t3 = _mm_mul_ps(_mm_mul_ps(t, t), t);
+    __m128 inner = _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f));
+    inner = _mm_add_ps(_mm_mul_ps(t, inner), _mm_set1_ps(10.0f));
+    return _mm_mul_ps(t3, inner);
+}
+
+inline __m128 lerp4(__m128 t, __m128 a, __m128 b) {
+    return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+}
+
+inline __m128 grad4(__m128i hash, __m128 x, __m128 y) {
+    __m128i h = _mm_and_si128(hash, _mm_set1_epi32(15));
+    __m128 useX = _mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(8)));
+    __m128 u = _mm_blendv_ps(y, x, useX);
+
+    __m128 useY = _mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(4)));
+    __m128 useXForV = _mm_castsi128_ps(_mm_or_si128(_mm_cmpeq_epi32(h, _mm_set1_epi32(12)),
+                                                    _mm_cmpeq_epi32(h, _mm_set1_epi32(14))));
+    __m128 v = _mm_blendv_ps(_mm_and_ps(useXForV, x), y, useY);
+
+    // Bits 0 and 1 of h flip the signs of u and v
+    __m128 signU = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(1)), 31));
+    __m128 signV = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(2)), 30));
+    return _mm_add_ps(_mm_xor_ps(u, signU), _mm_xor_ps(v, signV));
+}
+
+} // namespace
+
+bool perlinBatchSse41(const float* xs, const float* ys, float* out, size_t count) {
+    const int32_t* permutation = perlinPermutation();
+    const __m128i mask255 = _mm_set1_epi32(255);
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_loadu_ps(xs + i);
+        __m128 y = _mm_loadu_ps(ys + i);
+        __m128 fx = _mm_floor_ps(x);
+        __m128 fy = _mm_floor_ps(y);
+
+        alignas(16) int32_t X[4];
+        alignas(16) int32_t Y[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(X), _mm_and_si128(_mm_cvttps_epi32(fx), mask255));
+        _mm_store_si128(reinterpret_cast<__m128i*>(Y), _mm_and_si128(_mm_cvttps_epi32(fy), mask255));
+        x = _mm_sub_ps(x, fx);
+        y = _mm_sub_ps(y, fy);
+
+        // No gathers before AVX2, the hash lookups stay scalar
+        alignas(16) int32_t h00[4], h10[4], h01[4], h11[4];
+        for (int lane = 0; lane < 4; lane++) {
+            int A = permutation[X[lane]] + Y[lane];
+            int B = permutation[X[lane] + 1] + Y[lane];
+            h00[lane] = permutation[A];
+            h10[lane] = permutation[B];
+            h01[lane] = permutation[A + 1];
+            h11[lane] = permutation[B + 1];
+        }
+
+        __m128 u = fade4(x);
+        __m128 v = fade4(y);
+        __m128 xm1 = _mm_sub_ps(x, one);
+        __m128 ym1 = _mm_sub_ps(y, one);
+
+        __m128 g00 = grad4(_mm_load_si128(reinterpret_cast<const __m128i*>(h00)), x, y);
+        __m128 g10 = grad4(_mm_load_si128(reinterpret_cast<const __m128i*>(h10)), xm1, y);
+        __m128 g01 = grad4(_mm_load_si128(reinterpret_cast<const __m128i*>(h01)), x, ym1);
+        __m128 g11 = grad4(_mm_load_si128(reinterpret_cast<const __m128i*>(h11)), xm1, ym1);
+
+        _mm_storeu_ps(out + i, lerp4(v, lerp4(u, g00, g10), lerp4(u, g01, g11)));
+    }
+    for (; i < count; i++) {
+        out[i] = perlinScalar(permutation, xs[i], ys[i]);
+    }
+    return true;
+}
+
+#else
+
+bool perlinBatchSse41(const float*, const float*, float*, size_t) {
+    return false;
+}
+
+#endif
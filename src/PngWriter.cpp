@@ -0,0 +1,329 @@
+#include "PngWriter.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr size_t kIdatChunkSize = 64 * 1024;
+constexpr int kMaxHistory = 4;     // Largest match distance we look at (one RGBA pixel)
+constexpr int kMaxMatch = 258;
+
+struct CrcTable {
+    uint32_t entries[256];
+    CrcTable() {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            entries[n] = c;
+        }
+    }
+};
+
+const CrcTable kCrc;
+
+uint32_t crc32(uint32_t crc, const uint8_t* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        crc = kCrc.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+void storeBigEndian(uint8_t* out, uint32_t value) {
+    out[0] = static_cast<uint8_t>(value >> 24);
+    out[1] = static_cast<uint8_t>(value >> 16);
+    out[2] = static_cast<uint8_t>(value >> 8);
+    out[3] = static_cast<uint8_t>(value);
+}
+
+// Deflate length and distance code tables (RFC 1951, 3.2.5)
+const int kLengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                             35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const int kLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                              3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+// Transitions in a byte string; fewer transitions mean longer runs for the encoder
+size_t countTransitions(const uint8_t* data, size_t size, int stride) {
+    size_t transitions = 0;
+    for (size_t i = stride; i < size; i++) {
+        transitions += data[i] != data[i - stride];
+    }
+    return transitions;
+}
+
+} // namespace
+
+PngWriter::~PngWriter() {
+    if (m_file.is_open()) {
+        close();
+    }
+}
+
+bool PngWriter::open(const std::string& filename, unsigned int width, unsigned int height, Format format,
+                     const std::vector<PaletteEntry>& palette) {
+    m_file.open(filename, std::ios::binary | std::ios::trunc);
+    if (!m_file || width == 0 || height == 0) {
+        m_ok = false;
+        return false;
+    }
+
+    m_width = width;
+    m_height = height;
+    m_rowsWritten = 0;
+    m_bytesWritten = 0;
+    m_bitBuffer = 0;
+    m_bitCount = 0;
+    m_adlerA = 1;
+    m_adlerB = 0;
+    m_streamBytes = 0;
+    m_idat.clear();
+    m_ok = true;
+
+    uint8_t colorType = 0;
+    uint8_t bitDepth = 8;
+    switch (format) {
+        case Format::Gray8: colorType = 0; m_bytesPerPixel = 1; break;
+        case Format::Gray16: colorType = 0; bitDepth = 16; m_bytesPerPixel = 2; break;
+        case Format::Rgba8: colorType = 6; m_bytesPerPixel = 4; break;
+        case Format::Indexed8: colorType = 3; m_bytesPerPixel = 1; break;
+    }
+
+    size_t stride = static_cast<size_t>(width) * m_bytesPerPixel;
+    m_previousRow.assign(stride, 0);
+    m_currentRow.resize(stride);
+    m_filtered.assign(kMaxHistory + 1 + stride, 0);
+
+    static const uint8_t signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    m_file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+    m_bytesWritten += sizeof(signature);
+
+    uint8_t header[13];
+    storeBigEndian(header, width);
+    storeBigEndian(header + 4, height);
+    header[8] = bitDepth;
+    header[9] = colorType;
+    header[10] = 0;  // Deflate
+    header[11] = 0;  // Adaptive filtering
+    header[12] = 0;  // No interlace
+    writeChunk("IHDR", header, sizeof(header));
+
+    if (format == Format::Indexed8) {
+        std::vector<uint8_t> colors;
+        std::vector<uint8_t> alphas;
+        for (const PaletteEntry& entry : palette) {
+            colors.insert(colors.end(), {entry.r, entry.g, entry.b});
+            alphas.push_back(entry.a);
+        }
+        writeChunk("PLTE", colors.data(), colors.size());
+        if (std::any_of(alphas.begin(), alphas.end(), [](uint8_t a) { return a != 255; })) {
+            writeChunk("tRNS", alphas.data(), alphas.size());
+        }
+    }
+
+    // zlib header: deflate, 32K window, no preset dictionary
+    m_idat.push_back(0x78);
+    m_idat.push_back(0x01);
+    // One open-ended fixed-Huffman block; close() appends an empty final block
+    putBits(0, 1);
+    putBits(1, 2);
+    return m_ok;
+}
+
+bool PngWriter::writeRow(const void* row) {
+    if (!m_ok || m_rowsWritten >= m_height) {
+        return false;
+    }
+
+    size_t stride = m_currentRow.size();
+    if (m_bytesPerPixel == 2) {
+        // 16-bit samples are big-endian in PNG
+        const uint16_t* samples = static_cast<const uint16_t*>(row);
+        for (unsigned int x = 0; x < m_width; x++) {
+            m_currentRow[x * 2] = static_cast<uint8_t>(samples[x] >> 8);
+            m_currentRow[x * 2 + 1] = static_cast<uint8_t>(samples[x]);
+        }
+    } else {
+        std::memcpy(m_currentRow.data(), row, stride);
+    }
+
+    // Pick None or Up, whichever leaves longer runs for the run-length matcher
+    uint8_t* out = m_filtered.data() + kMaxHistory;
+    uint8_t* body = out + 1;
+    size_t noneCost = countTransitions(m_currentRow.data(), stride, m_bytesPerPixel);
+    for (size_t i = 0; i < stride; i++) {
+        body[i] = static_cast<uint8_t>(m_currentRow[i] - m_previousRow[i]);
+    }
+    size_t upCost = m_rowsWritten == 0 ? stride : countTransitions(body, stride, m_bytesPerPixel);
+    if (noneCost <= upCost) {
+        out[0] = 0;
+        std::memcpy(body, m_currentRow.data(), stride);
+    } else {
+        out[0] = 2;
+    }
+
+    deflateBytes(out, stride + 1);
+
+    // The last bytes of this row are the match history of the next one
+    std::memmove(m_filtered.data(), out + stride + 1 - kMaxHistory, kMaxHistory);
+    m_previousRow.swap(m_currentRow);
+    m_rowsWritten++;
+    flushIdat(false);
+    return m_ok;
+}
+
+bool PngWriter::close() {
+    if (!m_file.is_open()) {
+        return false;
+    }
+
+    bool complete = m_ok && m_rowsWritten == m_height;
+    if (m_ok) {
+        putHuffman(0, 7);  // End of the open block
+        putBits(1, 1);     // Final, empty fixed block
+        putBits(1, 2);
+        putHuffman(0, 7);
+        if (m_bitCount > 0) {
+            m_idat.push_back(static_cast<uint8_t>(m_bitBuffer));
+            m_bitBuffer = 0;
+            m_bitCount = 0;
+        }
+        uint8_t adler[4];
+        storeBigEndian(adler, (m_adlerB << 16) | m_adlerA);
+        m_idat.insert(m_idat.end(), adler, adler + 4);
+        flushIdat(true);
+        writeChunk("IEND", nullptr, 0);
+    }
+
+    m_file.close();
+    m_ok = m_ok && !m_file.fail();
+    return complete && m_ok;
+}
+
+void PngWriter::writeChunk(const char type[4], const uint8_t* data, size_t size) {
+    uint8_t header[8];
+    storeBigEndian(header, static_cast<uint32_t>(size));
+    std::memcpy(header + 4, type, 4);
+
+    uint32_t crc = crc32(0xFFFFFFFFu, header + 4, 4);
+    crc = crc32(crc, data, size);
+    uint8_t footer[4];
+    storeBigEndian(footer, crc ^ 0xFFFFFFFFu);
+
+    m_file.write(reinterpret_cast<const char*>(header), 8);
+    if (size > 0) {
+        m_file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+    }
+    m_file.write(reinterpret_cast<const char*>(footer), 4);
+    m_bytesWritten += size + 12;
+    if (!m_file) {
+        m_ok = false;
+    }
+}
+
+void PngWriter::flushIdat(bool force) {
+    while (m_idat.size() >= kIdatChunkSize || (force && !m_idat.empty())) {
+        size_t size = std::min(m_idat.size(), kIdatChunkSize);
+        writeChunk("IDAT", m_idat.data(), size);
+        m_idat.erase(m_idat.begin(), m_idat.begin() + size);
+    }
+}
+
+void PngWriter::putBits(uint32_t bits, int count) {
+    m_bitBuffer |= bits << m_bitCount;
+    m_bitCount += count;
+    while (m_bitCount >= 8) {
+        m_idat.push_back(static_cast<uint8_t>(m_bitBuffer));
+        m_bitBuffer >>= 8;
+        m_bitCount -= 8;
+    }
+}
+
+void PngWriter::putHuffman(uint32_t code, int length) {
+    // Huffman codes are stored most significant bit first
+    uint32_t reversed = 0;
+    for (int i = 0; i < length; i++) {
+        reversed = (reversed << 1) | ((code >> i) & 1);
+    }
+    putBits(reversed, length);
+}
+
+void PngWriter::putLiteral(uint8_t value) {
+    if (value < 144) {
+        putHuffman(0x30 + value, 8);
+    } else {
+        putHuffman(0x190 + (value - 144), 9);
+    }
+}
+
+void PngWriter::putMatch(int length, int distance) {
+    int index = 28;
+    while (kLengthBase[index] > length) {
+        index--;
+    }
+    int symbol = 257 + index;
+    if (symbol < 280) {
+        putHuffman(symbol - 256, 7);
+    } else {
+        putHuffman(0xC0 + (symbol - 280), 8);
+    }
+    if (kLengthExtra[index] > 0) {
+        putBits(length - kLengthBase[index], kLengthExtra[index]);
+    }
+    // Distances 1..4 map to codes 0..3 with no extra bits
+    putHuffman(static_cast<uint32_t>(distance - 1), 5);
+}
+
+void PngWriter::deflateBytes(const uint8_t* data, size_t size) {
+    // data[-kMaxHistory .. -1] holds the tail of the previous row
+    int distance = m_bytesPerPixel;
+    size_t i = 0;
+    while (i < size) {
+        size_t length = 0;
+        while (i + length < size && length < kMaxMatch && data[i + length] == data[i + length - distance]) {
+            length++;
+        }
+        if (length >= 3 && m_streamBytes + i >= static_cast<size_t>(distance)) {
+            putMatch(static_cast<int>(length), distance);
+        } else {
+            length = 1;
+            putLiteral(data[i]);
+        }
+        i += length;
+    }
+    m_streamBytes += size;
+
+    // Adler-32, reducing only every 5552 bytes as zlib does
+    const uint8_t* p = data;
+    size_t remaining = size;
+    while (remaining > 0) {
+        size_t block = std::min<size_t>(remaining, 5552);
+        for (size_t k = 0; k < block; k++) {
+            m_adlerA += p[k];
+            m_adlerB += m_adlerA;
+        }
+        m_adlerA %= 65521;
+        m_adlerB %= 65521;
+        p += block;
+        remaining -= block;
+    }
+}
+
+bool writePng(const std::string& filename, unsigned int width, unsigned int height,
+              PngWriter::Format format, const void* pixels,
+              const std::vector<PngWriter::PaletteEntry>& palette) {
+    PngWriter writer;
+    if (!writer.open(filename, width, height, format, palette)) {
+        return false;
+    }
+
+    size_t bytesPerPixel = format == PngWriter::Format::Rgba8 ? 4 : format == PngWriter::Format::Gray16 ? 2 : 1;
+    size_t stride = width * bytesPerPixel;
+    const uint8_t* bytes = static_cast<const uint8_t*>(pixels);
+    for (unsigned int y = 0; y < height; y++) {
+        if (!writer.writeRow(bytes + y * stride)) {
+            return false;
+        }
+    }
+    return writer.close();
+}
@@ -0,0 +1,252 @@
+#include "Profiler.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+
+std::atomic<bool> Profiler::s_enabled{false};
+
+namespace {
+
+// Hands the thread's buffer back to the profiler when the thread exits, so
+// short-lived threads reuse buffers instead of piling up new ones
+struct BufferHandle {
+    std::atomic<bool>* owned{nullptr};
+    void* buffer{nullptr};
+    const char* name{nullptr};
+
+    ~BufferHandle() {
+        if (owned) {
+            owned->store(false, std::memory_order_release);
+        }
+    }
+};
+
+thread_local BufferHandle t_buffer;
+
+void writeJsonString(std::ostream& out, const char* text) {
+    out << '"';
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            out << '\\' << *c;
+        } else if (static_cast<unsigned char>(*c) >= 0x20) {
+            out << *c;
+        }
+    }
+    out << '"';
+}
+
+} // namespace
+
+Profiler& Profiler::instance() {
+    // Never destroyed: pool threads may still record while statics are torn down
+    static Profiler* profiler = new Profiler();
+    return *profiler;
+}
+
+Profiler::ThreadBuffer& Profiler::threadBuffer() {
+    if (t_buffer.buffer) {
+        return *static_cast<ThreadBuffer*>(t_buffer.buffer);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ThreadBuffer* buffer = nullptr;
+    for (const auto& candidate : m_threads) {
+        if (!candidate->owned.load(std::memory_order_acquire)) {
+            buffer = candidate.get();
+            buffer->owned.store(true, std::memory_order_relaxed);
+            break;
+        }
+    }
+    if (!buffer) {
+        m_threads.push_back(std::make_unique<ThreadBuffer>());
+        buffer = m_threads.back().get();
+        buffer->id = static_cast<uint32_t>(m_threads.size());
+    }
+    {
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        buffer->name = t_buffer.name ? t_buffer.name : "";
+    }
+    t_buffer.owned = &buffer->owned;
+    t_buffer.buffer = buffer;
+    return *buffer;
+}
+
+void Profiler::setThreadName(const char* name) {
+    // Threads that never record do not get a buffer
+    t_buffer.name = name;
+    if (t_buffer.buffer) {
+        ThreadBuffer& buffer = *static_cast<ThreadBuffer*>(t_buffer.buffer);
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+        buffer.name = name;
+    }
+}
+
+void Profiler::record(const char* name, uint64_t start, uint64_t end) {
+    ThreadBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);  // only contended while a reader copies the buffer
+    if (buffer.events.size() < EventsPerThread) {
+        buffer.events.push_back(Event{name, start, end});
+    } else {
+        buffer.events[buffer.head] = Event{name, start, end};
+    }
+    buffer.head = buffer.head + 1 == EventsPerThread ? 0 : buffer.head + 1;
+    buffer.count = std::min(buffer.count + 1, EventsPerThread);
+}
+
+void Profiler::frameMark() {
+    uint64_t t = now();
+    uint64_t start;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        start = m_frameStart;
+        m_frameStart = t;
+        if (start == 0) {
+            return;
+        }
+        m_frameTimes[m_frameHead] = static_cast<float>((t - start) / 1e6);
+        m_frameEnds[m_frameHead] = t;
+        m_frameHead = (m_frameHead + 1) % FrameHistory;
+        m_frameCount = std::min(m_frameCount + 1, FrameHistory);
+    }
+    if (enabled()) {
+        record("Frame", start, t);
+    }
+}
+
+std::vector<float> Profiler::frameTimes() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<float> times(m_frameCount);
+    size_t first = (m_frameHead + FrameHistory - m_frameCount) % FrameHistory;
+    for (size_t i = 0; i < m_frameCount; i++) {
+        times[i] = m_frameTimes[(first + i) % FrameHistory];
+    }
+    return times;
+}
+
+template <typename Fn>
+void Profiler::forEachEvent(uint64_t since, Fn&& fn) const {
+    std::vector<ThreadBuffer*> buffers;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& buffer : m_threads) {
+            buffers.push_back(buffer.get());
+        }
+    }
+    // Buffers are never freed, only handed to the next thread
+    for (ThreadBuffer* buffer : buffers) {
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+        size_t first = (buffer->head + EventsPerThread - buffer->count) % EventsPerThread;
+        for (size_t i = 0; i < buffer->count; i++) {
+            const Event& event = buffer->events[(first + i) % EventsPerThread];
+            if (event.end >= since) {
+                fn(*buffer, event);
+            }
+        }
+    }
+}
+
+Profiler::Summary Profiler::summarize(double seconds) const {
+    uint64_t since = now() - static_cast<uint64_t>(std::max(0.0, seconds) * 1e9);
+    Summary summary;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < m_frameCount; i++) {
+            summary.frames += m_frameEnds[(m_frameHead + FrameHistory - 1 - i) % FrameHistory] >= since;
+        }
+    }
+
+    std::map<std::string, ZoneSummary> zones;
+    forEachEvent(since, [&](const ThreadBuffer&, const Event& event) {
+        ZoneSummary& zone = zones[event.name];
+        double ms = (event.end - event.start) / 1e6;
+        zone.totalMs += ms;
+        zone.maxMs = std::max(zone.maxMs, ms);
+        zone.calls++;
+    });
+
+    for (auto& [name, zone] : zones) {
+        zone.name = name;
+        summary.zones.push_back(std::move(zone));
+    }
+    std::sort(summary.zones.begin(), summary.zones.end(),
+              [](const ZoneSummary& a, const ZoneSummary& b) { return a.totalMs > b.totalMs; });
+    return summary;
+}
+
+bool Profiler::writeChromeTrace(const std::string& filename, double seconds, std::string* error) const {
+    struct TraceEvent {
+        const char* name;
+        uint64_t start;
+        uint64_t end;
+        uint32_t thread;
+    };
+    std::vector<TraceEvent> events;
+    std::map<uint32_t, std::string> threadNames;
+
+    uint64_t since = now() - static_cast<uint64_t>(std::max(0.0, seconds) * 1e9);
+    forEachEvent(since, [&](const ThreadBuffer& buffer, const Event& event) {
+        events.push_back(TraceEvent{event.name, event.start, event.end, buffer.id});
+        threadNames.try_emplace(buffer.id, buffer.name);
+    });
+    std::sort(events.begin(), events.end(),
+              [](const TraceEvent& a, const TraceEvent& b) { return a.start < b.start; });
+
+    std::ofstream file(filename, std::ios::trunc);
+    if (!file) {
+        if (error) {
+            *error = "cannot open " + filename;
+        }
+        return false;
+    }
+
+    // Timestamps in microseconds, relative to the first event in the window
+    uint64_t base = events.empty() ? 0 : events.front().start;
+    char number[64];
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (const auto& [id, name] : threadNames) {
+        file << (first ? "\n" : ",\n");
+        first = false;
+        std::string label = name.empty() ? "thread " + std::to_string(id) : name;
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << id << ",\"args\":{\"name\":";
+        writeJsonString(file, label.c_str());
+        file << "}}";
+    }
+    for (const TraceEvent& event : events) {
+        file << (first ? "\n" : ",\n");
+        first = false;
+        file << "{\"name\":";
+        writeJsonString(file, event.name);
+        std::snprintf(number, sizeof(number), "%.3f,\"dur\":%.3f",
+                      (event.start - base) / 1e3, (event.end - event.start) / 1e3);
+        file << ",\"cat\":\"terrain\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread << ",\"ts\":" << number << "}";
+    }
+    file << "\n]}\n";
+
+    if (!file) {
+        if (error) {
+            *error = "write failed for " + filename;
+        }
+        return false;
+    }
+    return true;
+}
+
+void Profiler::clear() {
+    std::vector<ThreadBuffer*> buffers;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& buffer : m_threads) {
+            buffers.push_back(buffer.get());
+        }
+        m_frameHead = 0;
+        m_frameCount = 0;
+    }
+    for (ThreadBuffer* buffer : buffers) {
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+        buffer->events.clear();
+        buffer->head = 0;
+        buffer->count = 0;
+    }
+}
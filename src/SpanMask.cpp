@@ -0,0 +1,287 @@
+#include "SpanMask.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+struct SpanRange {
+    const Span* begin;
+    const Span* end;
+};
+
+// Appends a span, joining it to the previous one when they overlap or touch
+void appendMerged(std::vector<Span>& out, size_t rowStart, int32_t x0, int32_t x1) {
+    if (out.size() > rowStart && x0 <= out.back().x1) {
+        out.back().x1 = std::max(out.back().x1, x1);
+    } else {
+        out.push_back(Span{x0, x1});
+    }
+}
+
+void uniteRow(SpanRange a, SpanRange b, std::vector<Span>& out) {
+    size_t rowStart = out.size();
+    while (a.begin != a.end || b.begin != b.end) {
+        const Span*& next = b.begin == b.end || (a.begin != a.end && a.begin->x0 < b.begin->x0) ? a.begin : b.begin;
+        appendMerged(out, rowStart, next->x0, next->x1);
+        ++next;
+    }
+}
+
+void subtractRow(SpanRange a, SpanRange b, std::vector<Span>& out) {
+    for (; a.begin != a.end; ++a.begin) {
+        int32_t x = a.begin->x0;
+        int32_t end = a.begin->x1;
+        // Cutters are sorted too; the ones ending before this span never matter again
+        while (b.begin != b.end && b.begin->x1 <= x) {
+            ++b.begin;
+        }
+        for (const Span* cut = b.begin; cut != b.end && cut->x0 < end; ++cut) {
+            if (cut->x0 > x) {
+                out.push_back(Span{x, cut->x0});
+            }
+            x = std::max(x, cut->x1);
+        }
+        if (x < end) {
+            out.push_back(Span{x, end});
+        }
+    }
+}
+
+void intersectRow(SpanRange a, SpanRange b, std::vector<Span>& out) {
+    while (a.begin != a.end && b.begin != b.end) {
+        int32_t x0 = std::max(a.begin->x0, b.begin->x0);
+        int32_t x1 = std::min(a.begin->x1, b.begin->x1);
+        if (x0 < x1) {
+            out.push_back(Span{x0, x1});
+        }
+        if (a.begin->x1 < b.begin->x1) {
+            ++a.begin;
+        } else {
+            ++b.begin;
+        }
+    }
+}
+
+} // namespace
+
+void SpanMask::resize(unsigned int width, unsigned int height) {
+    m_width = width;
+    m_height = height;
+    clear();
+}
+
+void SpanMask::clear() {
+    m_spans.clear();
+    m_rowStart.assign(static_cast<size_t>(m_height) + 1, 0);
+}
+
+bool SpanMask::contains(int x, int y) const {
+    if (x < 0 || y < 0 || x >= static_cast<int>(m_width) || y >= static_cast<int>(m_height)) {
+        return false;
+    }
+    const Span* begin = rowBegin(static_cast<unsigned int>(y));
+    const Span* end = rowEnd(static_cast<unsigned int>(y));
+    // Last span starting at or before x
+    const Span* it = std::upper_bound(begin, end, x, [](int value, const Span& span) { return value < span.x0; });
+    return it != begin && x < (it - 1)->x1;
+}
+
+uint64_t SpanMask::count() const {
+    uint64_t total = 0;
+    for (const Span& span : m_spans) {
+        total += static_cast<uint64_t>(span.x1 - span.x0);
+    }
+    return total;
+}
+
+uint64_t SpanMask::countRow(unsigned int y) const {
+    uint64_t total = 0;
+    for (const Span* span = rowBegin(y); span != rowEnd(y); ++span) {
+        total += static_cast<uint64_t>(span->x1 - span->x0);
+    }
+    return total;
+}
+
+uint64_t SpanMask::countRect(int x0, int y0, int x1, int y1) const {
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    x1 = std::min(x1, static_cast<int>(m_width));
+    y1 = std::min(y1, static_cast<int>(m_height));
+    uint64_t total = 0;
+    if (x0 >= x1) {
+        return 0;
+    }
+    for (int y = y0; y < y1; y++) {
+        const Span* end = rowEnd(static_cast<unsigned int>(y));
+        // First span ending past x0
+        const Span* span = std::upper_bound(rowBegin(static_cast<unsigned int>(y)), end, x0,
+                                            [](int value, const Span& s) { return value < s.x1; });
+        for (; span != end && span->x0 < x1; ++span) {
+            total += static_cast<uint64_t>(std::min(span->x1, x1) - std::max(span->x0, x0));
+        }
+    }
+    return total;
+}
+
+template <typename OtherFn, typename RowOp>
+void SpanMask::rewriteRows(unsigned int rowBegin, unsigned int rowEnd, OtherFn&& other, RowOp&& op) {
+    std::vector<Span> spans;
+    spans.reserve(m_spans.size() + 16);
+    spans.insert(spans.end(), m_spans.begin(), m_spans.begin() + m_rowStart[rowBegin]);
+
+    std::vector<uint32_t> rowStart(m_rowStart.begin(), m_rowStart.begin() + rowBegin + 1);
+    rowStart.reserve(m_rowStart.size());
+    for (unsigned int y = rowBegin; y < rowEnd; y++) {
+        op(SpanRange{this->rowBegin(y), this->rowEnd(y)}, other(y), spans);
+        rowStart.push_back(static_cast<uint32_t>(spans.size()));
+    }
+
+    // Rows below keep their spans, only their offsets move
+    int64_t shift = static_cast<int64_t>(spans.size()) - m_rowStart[rowEnd];
+    spans.insert(spans.end(), m_spans.begin() + m_rowStart[rowEnd], m_spans.end());
+    for (size_t y = static_cast<size_t>(rowEnd) + 1; y < m_rowStart.size(); y++) {
+        rowStart.push_back(static_cast<uint32_t>(m_rowStart[y] + shift));
+    }
+
+    m_spans = std::move(spans);
+    m_rowStart = std::move(rowStart);
+}
+
+void SpanMask::unite(const SpanMask& other) {
+    rewriteRows(0, m_height, [&other](unsigned int y) { return SpanRange{other.rowBegin(y), other.rowEnd(y)}; },
+                uniteRow);
+}
+
+void SpanMask::subtract(const SpanMask& other) {
+    rewriteRows(0, m_height, [&other](unsigned int y) { return SpanRange{other.rowBegin(y), other.rowEnd(y)}; },
+                subtractRow);
+}
+
+void SpanMask::intersect(const SpanMask& other) {
+    rewriteRows(0, m_height, [&other](unsigned int y) { return SpanRange{other.rowBegin(y), other.rowEnd(y)}; },
+                intersectRow);
+}
+
+void SpanMask::paintPolygon(ScanlineRasterizer& rasterizer, const float* xs, const float* ys, size_t count,
+                            bool solid) {
+    // The brush's own spans, one row after the other as the rasterizer emits them
+    std::vector<Span> brush;
+    std::vector<uint32_t> brushStart;
+    int firstRow = -1;
+    rasterizer.fill(xs, ys, count, static_cast<int>(m_width), static_cast<int>(m_height),
+        [&](int y, int x0, int x1) {
+            if (firstRow < 0) {
+                firstRow = y;
+            }
+            while (static_cast<int>(brushStart.size()) <= y - firstRow) {
+                brushStart.push_back(static_cast<uint32_t>(brush.size()));
+            }
+            brush.push_back(Span{x0, x1});
+        });
+    if (firstRow < 0) {
+        return;
+    }
+    brushStart.push_back(static_cast<uint32_t>(brush.size()));
+
+    unsigned int rowBegin = static_cast<unsigned int>(firstRow);
+    unsigned int rowEnd = rowBegin + static_cast<unsigned int>(brushStart.size() - 1);
+    auto brushRow = [&](unsigned int y) {
+        size_t row = y - rowBegin;
+        return SpanRange{brush.data() + brushStart[row], brush.data() + brushStart[row + 1]};
+    };
+    if (solid) {
+        rewriteRows(rowBegin, rowEnd, brushRow, uniteRow);
+    } else {
+        rewriteRows(rowBegin, rowEnd, brushRow, subtractRow);
+    }
+}
+
+void SpanMask::toMask(TerrainMask& mask, uint8_t value) const {
+    mask.resize(m_width, m_height);
+    for (unsigned int y = 0; y < m_height; y++) {
+        uint8_t* row = mask.row(y);
+        for (const Span* span = rowBegin(y); span != rowEnd(y); ++span) {
+            std::memset(row + span->x0, value, static_cast<size_t>(span->x1 - span->x0));
+        }
+    }
+}
+
+TerrainBitmap SpanMask::toBitmap() const {
+    TerrainBitmap bitmap(m_width, m_height);
+    for (unsigned int y = 0; y < m_height; y++) {
+        for (const Span* span = rowBegin(y); span != rowEnd(y); ++span) {
+            bitmap.fillSpan(y, static_cast<unsigned int>(span->x0), static_cast<unsigned int>(span->x1), true);
+        }
+    }
+    return bitmap;
+}
+
+SpanMask SpanMask::fromMask(const TerrainMask& mask, uint8_t value) {
+    SpanMask spans(mask.width, mask.height);
+    for (unsigned int y = 0; y < mask.height; y++) {
+        const uint8_t* row = mask.row(y);
+        unsigned int x = 0;
+        while (x < mask.width) {
+            while (x < mask.width && row[x] != value) {
+                x++;
+            }
+            unsigned int start = x;
+            while (x < mask.width && row[x] == value) {
+                x++;
+            }
+            if (start < x) {
+                spans.m_spans.push_back(Span{static_cast<int32_t>(start), static_cast<int32_t>(x)});
+            }
+        }
+        spans.m_rowStart[y + 1] = static_cast<uint32_t>(spans.m_spans.size());
+    }
+    return spans;
+}
+
+SpanMask SpanMask::fromBitmap(const TerrainBitmap& bitmap) {
+    SpanMask spans(bitmap.width(), bitmap.height());
+    for (unsigned int y = 0; y < bitmap.height(); y++) {
+        bitmap.forEachSpan(y, [&spans](unsigned int x0, unsigned int x1) {
+            spans.m_spans.push_back(Span{static_cast<int32_t>(x0), static_cast<int32_t>(x1)});
+        });
+        spans.m_rowStart[y + 1] = static_cast<uint32_t>(spans.m_spans.size());
+    }
+    return spans;
+}
+
+SpanMask SpanMask::fromRowSpans(unsigned int width, unsigned int height, std::vector<RowSpan> input) {
+    std::sort(input.begin(), input.end(), [](const RowSpan& a, const RowSpan& b) {
+        return a.y != b.y ? a.y < b.y : a.x0 < b.x0;
+    });
+
+    SpanMask spans(width, height);
+    size_t next = 0;
+    for (unsigned int y = 0; y < height; y++) {
+        size_t rowStart = spans.m_spans.size();
+        for (; next < input.size() && input[next].y == y; next++) {
+            appendMerged(spans.m_spans, rowStart, input[next].x0, input[next].x1);
+        }
+        spans.m_rowStart[y + 1] = static_cast<uint32_t>(spans.m_spans.size());
+    }
+    return spans;
+}
+
+void rasterizeTerrainSpans(const TerrainOutlines& outlines, unsigned int width, unsigned int height,
+                           SpanMask& spans) {
+    std::vector<RowSpan> blobs;
+    std::vector<RowSpan> caves;
+    ScanlineRasterizer rasterizer;
+    for (size_t i = 0; i < outlines.polygonCount(); i++) {
+        std::vector<RowSpan>& target = outlines.isCave(i) ? caves : blobs;
+        uint32_t begin = outlines.begin(i);
+        rasterizer.fill(outlines.xs.data() + begin, outlines.ys.data() + begin, outlines.size(i),
+                        static_cast<int>(width), static_cast<int>(height),
+            [&target](int y, int x0, int x1) {
+                target.push_back(RowSpan{static_cast<uint32_t>(y), x0, x1});
+            });
+    }
+
+    // Caves are painted over every blob, so they cut the union of all of them
+    spans = SpanMask::fromRowSpans(width, height, std::move(blobs));
+    spans.subtract(SpanMask::fromRowSpans(width, height, std::move(caves)));
+}
@@ -0,0 +1,236 @@
+#include "TerrainBitmap.hpp"
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TERRAIN_BITMAP_SSE2 1
+#else
+#define TERRAIN_BITMAP_SSE2 0
+#endif
+
+namespace {
+
+// Bits of the word that hold pixels [x0, x1) relative to the word start, x1 <= 64
+uint64_t bitRange(unsigned int x0, unsigned int x1) {
+    uint64_t high = x1 >= 64 ? ~0ull : (1ull << x1) - 1;
+    return high & (~0ull << x0);
+}
+
+// Packs 64 comparisons of `bytes[i] == value` into one word
+uint64_t packEqualBytes(const uint8_t* bytes, uint8_t value, unsigned int count) {
+    uint64_t word = 0;
+    unsigned int i = 0;
+#if TERRAIN_BITMAP_SSE2
+    __m128i needle = _mm_set1_epi8(static_cast<char>(value));
+    for (; i + 16 <= count; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i));
+        uint32_t bits = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)));
+        word |= static_cast<uint64_t>(bits) << i;
+    }
+#endif
+    for (; i < count; i++) {
+        word |= static_cast<uint64_t>(bytes[i] == value) << i;
+    }
+    return word;
+}
+
+// Packs 64 comparisons of `pixels[i] == opaque black` into one word
+uint64_t packBlackPixels(const uint8_t* rgba, unsigned int count) {
+    uint64_t word = 0;
+    unsigned int i = 0;
+#if TERRAIN_BITMAP_SSE2
+    // Opaque black is 0xFF000000 when read as a little-endian uint32
+    __m128i black = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+    for (; i + 4 <= count; i += 4) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + i * 4));
+        uint32_t bits = static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(chunk, black))));
+        word |= static_cast<uint64_t>(bits) << i;
+    }
+#endif
+    for (; i < count; i++) {
+        const uint8_t* p = rgba + i * 4;
+        word |= static_cast<uint64_t>(p[0] == 0 && p[1] == 0 && p[2] == 0 && p[3] == 255) << i;
+    }
+    return word;
+}
+
+} // namespace
+
+void TerrainBitmap::resize(unsigned int width, unsigned int height) {
+    m_width = width;
+    m_height = height;
+    m_wordsPerRow = (width + 63) / 64;
+    m_words.assign(m_wordsPerRow * height, 0);
+}
+
+void TerrainBitmap::clear() {
+    std::fill(m_words.begin(), m_words.end(), 0);
+}
+
+void TerrainBitmap::set(unsigned int x, unsigned int y, bool value) {
+    uint64_t& word = row(y)[x >> 6];
+    uint64_t bit = 1ull << (x & 63);
+    word = value ? word | bit : word & ~bit;
+}
+
+void TerrainBitmap::fillSpan(unsigned int y, unsigned int x0, unsigned int x1, bool value) {
+    x1 = std::min(x1, m_width);
+    if (x0 >= x1) {
+        return;
+    }
+    uint64_t* words = row(y);
+    size_t first = x0 >> 6;
+    size_t last = (x1 - 1) >> 6;
+    for (size_t w = first; w <= last; w++) {
+        unsigned int begin = w == first ? x0 & 63 : 0;
+        unsigned int end = w == last ? ((x1 - 1) & 63) + 1 : 64;
+        uint64_t bits = bitRange(begin, end);
+        words[w] = value ? words[w] | bits : words[w] & ~bits;
+    }
+}
+
+uint64_t TerrainBitmap::count() const {
+    uint64_t total = 0;
+    for (uint64_t word : m_words) {
+        total += popcount64(word);
+    }
+    return total;
+}
+
+uint64_t TerrainBitmap::countRow(unsigned int y) const {
+    const uint64_t* words = row(y);
+    uint64_t total = 0;
+    for (size_t w = 0; w < m_wordsPerRow; w++) {
+        total += popcount64(words[w]);
+    }
+    return total;
+}
+
+uint64_t TerrainBitmap::countRect(int x0, int y0, int x1, int y1) const {
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    x1 = std::min(x1, static_cast<int>(m_width));
+    y1 = std::min(y1, static_cast<int>(m_height));
+    if (x0 >= x1 || y0 >= y1) {
+        return 0;
+    }
+
+    size_t first = static_cast<size_t>(x0) >> 6;
+    size_t last = static_cast<size_t>(x1 - 1) >> 6;
+    uint64_t total = 0;
+    for (int y = y0; y < y1; y++) {
+        const uint64_t* words = row(y);
+        for (size_t w = first; w <= last; w++) {
+            unsigned int begin = w == first ? x0 & 63 : 0;
+            unsigned int end = w == last ? ((x1 - 1) & 63) + 1 : 64;
+            total += popcount64(words[w] & bitRange(begin, end));
+        }
+    }
+    return total;
+}
+
+void TerrainBitmap::unite(const TerrainBitmap& other) {
+    size_t count = std::min(m_words.size(), other.m_words.size());
+    for (size_t i = 0; i < count; i++) {
+        m_words[i] |= other.m_words[i];
+    }
+}
+
+void TerrainBitmap::subtract(const TerrainBitmap& other) {
+    size_t count = std::min(m_words.size(), other.m_words.size());
+    for (size_t i = 0; i < count; i++) {
+        m_words[i] &= ~other.m_words[i];
+    }
+}
+
+void TerrainBitmap::intersect(const TerrainBitmap& other) {
+    size_t count = std::min(m_words.size(), other.m_words.size());
+    for (size_t i = 0; i < count; i++) {
+        m_words[i] &= other.m_words[i];
+    }
+}
+
+std::vector<uint8_t> TerrainBitmap::toBytes() const {
+    std::vector<uint8_t> bytes(static_cast<size_t>(m_width) * m_height, 0);
+    for (unsigned int y = 0; y < m_height; y++) {
+        uint8_t* out = bytes.data() + static_cast<size_t>(y) * m_width;
+        forEachSpan(y, [out](unsigned int x0, unsigned int x1) {
+            std::fill(out + x0, out + x1, uint8_t{1});
+        });
+    }
+    return bytes;
+}
+
+TerrainBitmap TerrainBitmap::fromMask(const TerrainMask& mask, uint8_t value) {
+    TerrainBitmap bitmap(mask.width, mask.height);
+    for (unsigned int y = 0; y < mask.height; y++) {
+        const uint8_t* cells = mask.row(y);
+        uint64_t* words = bitmap.row(y);
+        for (size_t w = 0; w < bitmap.m_wordsPerRow; w++) {
+            unsigned int x = static_cast<unsigned int>(w * 64);
+            words[w] = packEqualBytes(cells + x, value, std::min(64u, mask.width - x));
+        }
+    }
+    return bitmap;
+}
+
+void TerrainBitmap::updateFromMask(const TerrainMask& mask, uint8_t value, int x0, int y0, int x1, int y1) {
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    x1 = std::min(x1, static_cast<int>(m_width));
+    y1 = std::min(y1, static_cast<int>(m_height));
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+    size_t first = static_cast<size_t>(x0) >> 6;
+    size_t last = static_cast<size_t>(x1 - 1) >> 6;
+    for (int y = y0; y < y1; y++) {
+        const uint8_t* cells = mask.row(static_cast<unsigned int>(y));
+        uint64_t* words = row(static_cast<unsigned int>(y));
+        for (size_t w = first; w <= last; w++) {
+            unsigned int x = static_cast<unsigned int>(w * 64);
+            words[w] = packEqualBytes(cells + x, value, std::min(64u, m_width - x));
+        }
+    }
+}
+
+TerrainBitmap TerrainBitmap::fromRgba(const uint8_t* rgba, unsigned int width, unsigned int height) {
+    TerrainBitmap bitmap(width, height);
+    for (unsigned int y = 0; y < height; y++) {
+        const uint8_t* pixels = rgba + static_cast<size_t>(y) * width * 4;
+        uint64_t* words = bitmap.row(y);
+        for (size_t w = 0; w < bitmap.m_wordsPerRow; w++) {
+            unsigned int x = static_cast<unsigned int>(w * 64);
+            words[w] = packBlackPixels(pixels + x * 4, std::min(64u, width - x));
+        }
+    }
+    return bitmap;
+}
+
+void rasterizeTerrainBits(const TerrainOutlines& outlines, unsigned int width, unsigned int height,
+                          TerrainBitmap& bitmap) {
+    if (bitmap.width() != width || bitmap.height() != height) {
+        bitmap.resize(width, height);
+    } else {
+        bitmap.clear();
+    }
+
+    ScanlineRasterizer rasterizer;
+    TerrainBitmap caves;
+    for (size_t i = 0; i < outlines.polygonCount(); i++) {
+        TerrainBitmap* target = &bitmap;
+        if (outlines.isCave(i)) {
+            if (caves.width() != width || caves.height() != height) {
+                caves.resize(width, height);
+            }
+            target = &caves;
+        }
+        uint32_t begin = outlines.begin(i);
+        fillPolygonBits(rasterizer, target->data(), target->wordsPerRow(),
+                        static_cast<int>(width), static_cast<int>(height),
+                        outlines.xs.data() + begin, outlines.ys.data() + begin, outlines.size(i));
+    }
+    if (outlines.caveCount() > 0) {
+        bitmap.subtract(caves);
+    }
+}
@@ -0,0 +1,370 @@
+#include "TerrainCache.hpp"
+#include "Profiler.hpp"
+#include "TerrainFile.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Files the cache owns: 16 hex digits, then an extension
+bool isCacheFile(const fs::path& path) {
+    std::string stem = path.stem().string();
+    return stem.size() == 16 && std::all_of(stem.begin(), stem.end(), [](char c) {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+    });
+}
+
+// Marks a file as just used, disk eviction goes by modification time
+void touch(const std::string& path) {
+    std::error_code ec;
+    fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+}
+
+// Written next to the target and renamed over it, so readers never see half a file
+std::string tempPathFor(const std::string& path) {
+    return path + ".tmp" + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+}
+
+} // namespace
+
+size_t CachedTerrain::memoryBytes() const {
+    size_t bytes = sizeof(CachedTerrain) + params.caves.size() * sizeof(CaveDesc);
+    bytes += (outlines.xs.size() + outlines.ys.size()) * sizeof(float) + outlines.offsets.size() * sizeof(uint32_t);
+    bytes += mask.cells.size();
+    if (distanceField) {
+        bytes += distanceField->distances.size() * sizeof(float);
+    }
+    return bytes;
+}
+
+TerrainCache::TerrainCache(const std::string& directory, size_t memoryBudget, uint64_t diskBudget)
+    : m_directory(directory), m_memoryBudget(memoryBudget), m_diskBudget(diskBudget) {
+    if (m_directory.empty()) {
+        return;
+    }
+    std::error_code ec;
+    fs::create_directories(m_directory, ec);
+    for (const fs::directory_entry& entry : fs::directory_iterator(m_directory, ec)) {
+        if (!entry.is_regular_file(ec)) {
+            continue;
+        }
+        if (entry.path().filename().string().find(".tmp") != std::string::npos) {
+            fs::remove(entry.path(), ec);  // Left over from a write that never finished
+        } else if (isCacheFile(entry.path())) {
+            m_diskBytes += entry.file_size(ec);
+            m_diskFiles++;
+        }
+    }
+}
+
+std::shared_ptr<const CachedTerrain> TerrainCache::find(uint64_t key) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_memory.find(key);
+        if (it != m_memory.end()) {
+            m_lru.splice(m_lru.begin(), m_lru, it->second.order);
+            m_stats.memoryHits++;
+            return it->second.terrain;
+        }
+    }
+
+    std::shared_ptr<const CachedTerrain> terrain = m_directory.empty() ? nullptr : loadFromDisk(key);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!terrain) {
+        m_stats.misses++;
+        return nullptr;
+    }
+    m_stats.diskHits++;
+    insertMemory(key, terrain);
+    return terrain;
+}
+
+void TerrainCache::store(uint64_t key, std::shared_ptr<const CachedTerrain> entry, bool persist) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        insertMemory(key, entry);
+        m_stats.stores++;
+    }
+    if (persist && !m_directory.empty()) {
+        std::string path = pathFor(key, ".terrain");
+        std::error_code ec;
+        // Same key, same terrain: a file already there only needs to count as used
+        if (fs::exists(path, ec)) {
+            touch(path);
+        } else {
+            writeToDisk(key, *entry);
+        }
+    }
+}
+
+void TerrainCache::attachDistanceField(uint64_t key, std::shared_ptr<const DistanceField> field) {
+    std::shared_ptr<const CachedTerrain> updated;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_memory.find(key);
+        if (it == m_memory.end() || it->second.terrain->distanceField) {
+            return;
+        }
+        auto copy = std::make_shared<CachedTerrain>(*it->second.terrain);
+        copy->distanceField = std::move(field);
+        updated = copy;
+        insertMemory(key, updated);
+    }
+    if (!m_directory.empty()) {
+        writeToDisk(key, *updated);
+    }
+}
+
+bool TerrainCache::findFile(uint64_t key, const std::string& extension, std::string& path) {
+    std::error_code ec;
+    std::string candidate = m_directory.empty() ? std::string() : pathFor(key, extension);
+    bool found = !candidate.empty() && fs::is_regular_file(candidate, ec);
+    if (found) {
+        touch(candidate);
+        path = candidate;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (found) {
+        m_stats.diskHits++;
+    } else {
+        m_stats.misses++;
+    }
+    return found;
+}
+
+bool TerrainCache::storeFile(uint64_t key, const std::string& extension, const std::string& source) {
+    if (m_directory.empty()) {
+        return false;
+    }
+    std::string path = pathFor(key, extension);
+    std::string temp = tempPathFor(path);
+    std::error_code ec;
+    bool existed = fs::exists(path, ec);
+    uint64_t oldBytes = existed ? fs::file_size(path, ec) : 0;
+    if (!fs::copy_file(source, temp, fs::copy_options::overwrite_existing, ec)) {
+        fs::remove(temp, ec);
+        return false;
+    }
+    uint64_t bytes = fs::file_size(temp, ec);
+    fs::rename(temp, path, ec);
+    if (ec) {
+        fs::remove(temp, ec);
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.stores++;
+        m_diskBytes = m_diskBytes + bytes - std::min(oldBytes, m_diskBytes);
+        m_diskFiles += existed ? 0 : 1;
+    }
+    evictDisk();
+    return true;
+}
+
+uint64_t TerrainCache::deriveKey(uint64_t key, const void* data, size_t size) {
+    uint64_t hash = 0xCBF29CE484222325ull ^ key;
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    }
+    hash += 0x9E3779B97F4A7C15ull;
+    hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+    return hash ^ (hash >> 31);
+}
+
+std::string TerrainCache::keyString(uint64_t key) {
+    char text[17];
+    std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(key));
+    return text;
+}
+
+std::string TerrainCache::userDirectory(const std::string& name) {
+#if defined(_WIN32)
+    const char* base = std::getenv("LOCALAPPDATA");
+    if (base && *base) {
+        return (fs::path(base) / name).string();
+    }
+#else
+    const char* xdg = std::getenv("XDG_CACHE_HOME");
+    if (xdg && *xdg) {
+        return (fs::path(xdg) / name).string();
+    }
+    const char* home = std::getenv("HOME");
+    if (home && *home) {
+        return (fs::path(home) / ".cache" / name).string();
+    }
+#endif
+    return {};
+}
+
+TerrainCache::Stats TerrainCache::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats stats = m_stats;
+    stats.memoryEntries = m_memory.size();
+    stats.memoryBytes = m_memoryBytes;
+    stats.diskFiles = m_diskFiles;
+    stats.diskBytes = m_diskBytes;
+    return stats;
+}
+
+void TerrainCache::clear(bool disk) {
+    std::lock_guard<std::mutex> diskLock(m_diskMutex);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_memory.clear();
+    m_lru.clear();
+    m_memoryBytes = 0;
+    if (!disk || m_directory.empty()) {
+        return;
+    }
+    std::error_code ec;
+    for (const fs::directory_entry& entry : fs::directory_iterator(m_directory, ec)) {
+        if (isCacheFile(entry.path())) {
+            fs::remove(entry.path(), ec);
+        }
+    }
+    m_diskBytes = 0;
+    m_diskFiles = 0;
+}
+
+std::string TerrainCache::pathFor(uint64_t key, const std::string& extension) const {
+    return (fs::path(m_directory) / (keyString(key) + extension)).string();
+}
+
+std::shared_ptr<const CachedTerrain> TerrainCache::loadFromDisk(uint64_t key) {
+    std::string path = pathFor(key, ".terrain");
+    std::error_code ec;
+    if (!fs::exists(path, ec)) {
+        return nullptr;
+    }
+    PROFILE_ZONE("TerrainCache::loadFromDisk");
+    auto terrain = std::make_shared<CachedTerrain>();
+    {
+        TerrainFile file;
+        if (!file.open(path)) {
+            return nullptr;
+        }
+        // Only trust files that describe exactly the terrain asked for
+        terrain->params = file.params();
+        if (!file.hasParams() || !file.hasCaveMask() || terrainParamsHash(terrain->params) != key) {
+            return nullptr;
+        }
+        terrain->mask = file.mask();
+        if (const float* distances = file.distanceField()) {
+            auto field = std::make_shared<DistanceField>();
+            field->width = file.width();
+            field->height = file.height();
+            field->distances.assign(distances, distances + static_cast<size_t>(file.width()) * file.height());
+            terrain->distanceField = std::move(field);
+        }
+    }
+    // Outlines are not stored, rebuilding them costs a fraction of the rasterization
+    buildTerrainOutlines(terrain->params, terrain->outlines);
+    touch(path);
+    return terrain;
+}
+
+bool TerrainCache::writeToDisk(uint64_t key, const CachedTerrain& terrain) {
+    PROFILE_ZONE("TerrainCache::writeToDisk");
+    TerrainBitmap solid = TerrainBitmap::fromMask(terrain.mask, TerrainMask::Solid);
+    TerrainBitmap caves = TerrainBitmap::fromMask(terrain.mask, TerrainMask::Cave);
+    TerrainFileData data;
+    data.params = &terrain.params;
+    data.seed = terrain.params.seed;
+    data.solid = &solid;
+    data.caves = &caves;
+    data.distanceField = terrain.distanceField.get();
+
+    std::string path = pathFor(key, ".terrain");
+    std::string temp = tempPathFor(path);
+    std::error_code ec;
+    bool existed = fs::exists(path, ec);
+    uint64_t oldBytes = existed ? fs::file_size(path, ec) : 0;
+    if (!writeTerrainFile(temp, data)) {
+        fs::remove(temp, ec);
+        return false;
+    }
+    uint64_t bytes = fs::file_size(temp, ec);
+    fs::rename(temp, path, ec);
+    if (ec) {
+        fs::remove(temp, ec);
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_diskBytes = m_diskBytes + bytes - std::min(oldBytes, m_diskBytes);
+        m_diskFiles += existed ? 0 : 1;
+    }
+    evictDisk();
+    return true;
+}
+
+void TerrainCache::insertMemory(uint64_t key, std::shared_ptr<const CachedTerrain> terrain) {
+    auto it = m_memory.find(key);
+    if (it != m_memory.end()) {
+        m_memoryBytes -= it->second.bytes;
+        m_lru.erase(it->second.order);
+        m_memory.erase(it);
+    }
+    size_t bytes = terrain->memoryBytes();
+    m_lru.push_front(key);
+    m_memory.emplace(key, MemoryEntry{std::move(terrain), bytes, m_lru.begin()});
+    m_memoryBytes += bytes;
+
+    // The newest entry always stays, even when it alone is over budget
+    while (m_memoryBytes > m_memoryBudget && m_lru.size() > 1) {
+        auto oldest = m_memory.find(m_lru.back());
+        m_memoryBytes -= oldest->second.bytes;
+        m_memory.erase(oldest);
+        m_lru.pop_back();
+        m_stats.evictions++;
+    }
+}
+
+void TerrainCache::evictDisk() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_diskBytes <= m_diskBudget) {
+            return;
+        }
+    }
+    std::lock_guard<std::mutex> diskLock(m_diskMutex);
+
+    struct File {
+        fs::file_time_type time;
+        fs::path path;
+        uint64_t bytes;
+    };
+    std::vector<File> files;
+    uint64_t total = 0;
+    std::error_code ec;
+    for (const fs::directory_entry& entry : fs::directory_iterator(m_directory, ec)) {
+        if (entry.is_regular_file(ec) && isCacheFile(entry.path())) {
+            files.push_back(File{entry.last_write_time(ec), entry.path(), entry.file_size(ec)});
+            total += files.back().bytes;
+        }
+    }
+    std::sort(files.begin(), files.end(), [](const File& a, const File& b) { return a.time < b.time; });
+
+    // Down to 90% of the budget, so the next few stores do not scan again
+    uint64_t target = m_diskBudget / 10 * 9;
+    uint64_t evicted = 0;
+    for (size_t i = 0; i < files.size() && total > target; i++) {
+        if (fs::remove(files[i].path, ec)) {
+            total -= files[i].bytes;
+            evicted++;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_diskBytes = total;
+    m_diskFiles = files.size() - evicted;
+    m_stats.evictions += evicted;
+}
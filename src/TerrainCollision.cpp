@@ -0,0 +1,333 @@
+#include "TerrainCollision.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+
+namespace {
+
+// Packs the OR of every bit pair of `bits` into the low 32 bits
+uint64_t foldPairs(uint64_t bits) {
+    bits = (bits | (bits >> 1)) & 0x5555555555555555ull;
+    bits = (bits | (bits >> 1)) & 0x3333333333333333ull;
+    bits = (bits | (bits >> 2)) & 0x0F0F0F0F0F0F0F0Full;
+    bits = (bits | (bits >> 4)) & 0x00FF00FF00FF00FFull;
+    bits = (bits | (bits >> 8)) & 0x0000FFFF0000FFFFull;
+    bits = (bits | (bits >> 16)) & 0x00000000FFFFFFFFull;
+    return bits;
+}
+
+// Recomputes coarse words [wordBegin, wordEnd) of coarse row y from the finer level
+void downsampleWords(const TerrainBitmap& fine, TerrainBitmap& coarse, unsigned int y,
+                     size_t wordBegin, size_t wordEnd) {
+    size_t fineWords = fine.wordsPerRow();
+    const uint64_t* row0 = fine.row(y * 2);
+    const uint64_t* row1 = y * 2 + 1 < fine.height() ? fine.row(y * 2 + 1) : row0;
+    uint64_t* out = coarse.row(y);
+    for (size_t w = wordBegin; w < wordEnd; w++) {
+        size_t lo = w * 2;
+        size_t hi = lo + 1;
+        uint64_t low = foldPairs(row0[lo] | row1[lo]);
+        uint64_t high = hi < fineWords ? foldPairs(row0[hi] | row1[hi]) : 0;
+        out[w] = low | (high << 32);
+    }
+}
+
+TerrainBitmap downsample(const TerrainBitmap& fine) {
+    TerrainBitmap coarse((fine.width() + 1) / 2, (fine.height() + 1) / 2);
+    for (unsigned int y = 0; y < coarse.height(); y++) {
+        downsampleWords(fine, coarse, y, 0, coarse.wordsPerRow());
+    }
+    return coarse;
+}
+
+float distanceSquaredToRange(float value, float lo, float hi) {
+    float d = value < lo ? lo - value : value > hi ? value - hi : 0.0f;
+    return d * d;
+}
+
+} // namespace
+
+void TerrainCollision::build(const TerrainBitmap& solid) {
+    m_levels.clear();
+    m_levels.push_back(solid);
+    while (m_levels.back().width() > 1 || m_levels.back().height() > 1) {
+        m_levels.push_back(downsample(m_levels.back()));
+    }
+}
+
+void TerrainCollision::update(const TerrainBitmap& solid, int x0, int y0, int x1, int y1) {
+    if (m_levels.empty() || solid.width() != width() || solid.height() != height()) {
+        build(solid);
+        return;
+    }
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    x1 = std::min(x1, static_cast<int>(width()));
+    y1 = std::min(y1, static_cast<int>(height()));
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+
+    // Level 0 is a copy of the bitmap, whole words at a time
+    size_t first = static_cast<size_t>(x0) >> 6;
+    size_t last = static_cast<size_t>(x1 - 1) >> 6;
+    for (int y = y0; y < y1; y++) {
+        std::copy(solid.row(y) + first, solid.row(y) + last + 1, m_levels[0].row(y) + first);
+    }
+
+    // Every level up halves the rect, so the whole update costs about as much as level 0
+    unsigned int bx0 = static_cast<unsigned int>(x0);
+    unsigned int by0 = static_cast<unsigned int>(y0);
+    unsigned int bx1 = static_cast<unsigned int>(x1 - 1);
+    unsigned int by1 = static_cast<unsigned int>(y1 - 1);
+    for (size_t level = 1; level < m_levels.size(); level++) {
+        bx0 >>= 1;
+        by0 >>= 1;
+        bx1 >>= 1;
+        by1 >>= 1;
+        for (unsigned int y = by0; y <= by1; y++) {
+            downsampleWords(m_levels[level - 1], m_levels[level], y, bx0 >> 6, (bx1 >> 6) + 1);
+        }
+    }
+}
+
+size_t TerrainCollision::memoryBytes() const {
+    size_t total = 0;
+    for (const TerrainBitmap& level : m_levels) {
+        total += level.memoryBytes();
+    }
+    return total;
+}
+
+bool TerrainCollision::isSolid(int x, int y) const {
+    return !m_levels.empty() && x >= 0 && y >= 0 &&
+           occupied(0, static_cast<unsigned int>(x), static_cast<unsigned int>(y));
+}
+
+bool TerrainCollision::isSolid(float x, float y) const {
+    return isSolid(static_cast<int>(std::floor(x)), static_cast<int>(std::floor(y)));
+}
+
+bool TerrainCollision::anyInBlock(size_t level, unsigned int bx, unsigned int by,
+                                  int x0, int y0, int x1, int y1) const {
+    if (!occupied(level, bx, by)) {
+        return false;
+    }
+    if (level == 0) {
+        return true;
+    }
+    int size = 1 << level;
+    int left = static_cast<int>(bx) * size;
+    int top = static_cast<int>(by) * size;
+    if (left >= x0 && top >= y0 && left + size <= x1 && top + size <= y1) {
+        return true;
+    }
+
+    int half = size / 2;
+    for (unsigned int cy = by * 2; cy < by * 2 + 2; cy++) {
+        int childTop = static_cast<int>(cy) * half;
+        if (childTop >= y1 || childTop + half <= y0) continue;
+        for (unsigned int cx = bx * 2; cx < bx * 2 + 2; cx++) {
+            int childLeft = static_cast<int>(cx) * half;
+            if (childLeft >= x1 || childLeft + half <= x0) continue;
+            if (anyInBlock(level - 1, cx, cy, x0, y0, x1, y1)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool TerrainCollision::overlaps(float minX, float minY, float maxX, float maxY) const {
+    if (m_levels.empty()) {
+        return false;
+    }
+    // Pixels touched by the box, clamped to the bitmap
+    int x0 = std::max(static_cast<int>(std::floor(minX)), 0);
+    int y0 = std::max(static_cast<int>(std::floor(minY)), 0);
+    int x1 = std::min(static_cast<int>(std::ceil(maxX)), static_cast<int>(width()));
+    int y1 = std::min(static_cast<int>(std::ceil(maxY)), static_cast<int>(height()));
+    if (x0 >= x1 || y0 >= y1) {
+        return false;
+    }
+    return anyInBlock(m_levels.size() - 1, 0, 0, x0, y0, x1, y1);
+}
+
+void TerrainCollision::surfaceNormal(int x, int y, float dx, float dy, bool crossedX, RayHit& hit) const {
+    // Occupancy gradient over the 5x5 neighborhood, smoother than the pixel face
+    float nx = 0.0f;
+    float ny = 0.0f;
+    for (int j = -2; j <= 2; j++) {
+        for (int i = -2; i <= 2; i++) {
+            if (isSolid(x + i, y + j)) {
+                nx -= static_cast<float>(i);
+                ny -= static_cast<float>(j);
+            }
+        }
+    }
+    float length = std::sqrt(nx * nx + ny * ny);
+    if (length > 0.0f && nx * dx + ny * dy < 0.0f) {
+        hit.normalX = nx / length;
+        hit.normalY = ny / length;
+        return;
+    }
+
+    // Flat or degenerate neighborhood: fall back to the face the ray came through
+    hit.normalX = crossedX ? (dx > 0.0f ? -1.0f : 1.0f) : 0.0f;
+    hit.normalY = crossedX ? 0.0f : (dy > 0.0f ? -1.0f : 1.0f);
+    if (dx == 0.0f && dy == 0.0f) {
+        hit.normalX = 0.0f;
+        hit.normalY = -1.0f;
+    }
+}
+
+TerrainCollision::RayHit TerrainCollision::raycast(const Ray& ray) const {
+    RayHit hit;
+    if (m_levels.empty()) {
+        return hit;
+    }
+
+    float length = std::sqrt(ray.directionX * ray.directionX + ray.directionY * ray.directionY);
+    float dx = length > 0.0f ? ray.directionX / length : 0.0f;
+    float dy = length > 0.0f ? ray.directionY / length : 0.0f;
+    const float inf = std::numeric_limits<float>::infinity();
+    const float w = static_cast<float>(width());
+    const float h = static_cast<float>(height());
+
+    // Clip against the bitmap bounds first, nothing can be hit outside of them
+    float tEnter = 0.0f;
+    float tExit = ray.maxDistance;
+    bool enteredX = false;
+    auto clip = [&](float origin, float direction, float size, bool isX) {
+        if (direction == 0.0f) {
+            return origin >= 0.0f && origin < size;
+        }
+        float t0 = (0.0f - origin) / direction;
+        float t1 = (size - origin) / direction;
+        if (t0 > t1) std::swap(t0, t1);
+        if (t0 > tEnter) {
+            tEnter = t0;
+            enteredX = isX;
+        }
+        tExit = std::min(tExit, t1);
+        return true;
+    };
+    if (!clip(ray.originX, dx, w, true) || !clip(ray.originY, dy, h, false) || tEnter > tExit) {
+        return hit;
+    }
+
+    float t = tEnter;
+    bool crossedX = enteredX;
+    int cx = std::min(std::max(static_cast<int>(std::floor(ray.originX + dx * t)), 0), static_cast<int>(width()) - 1);
+    int cy = std::min(std::max(static_cast<int>(std::floor(ray.originY + dy * t)), 0), static_cast<int>(height()) - 1);
+
+    while (t <= tExit) {
+        if (cx < 0 || cy < 0 || cx >= static_cast<int>(width()) || cy >= static_cast<int>(height())) {
+            return hit;
+        }
+        if (occupied(0, static_cast<unsigned int>(cx), static_cast<unsigned int>(cy))) {
+            hit.hit = true;
+            hit.distance = t;
+            hit.x = ray.originX + dx * t;
+            hit.y = ray.originY + dy * t;
+            hit.cellX = cx;
+            hit.cellY = cy;
+            surfaceNormal(cx, cy, dx, dy, crossedX, hit);
+            return hit;
+        }
+
+        // Largest empty block around the current cell, then jump to its far side
+        size_t level = 0;
+        while (level + 1 < m_levels.size() &&
+               !occupied(level + 1, static_cast<unsigned int>(cx) >> (level + 1),
+                         static_cast<unsigned int>(cy) >> (level + 1))) {
+            level++;
+        }
+        int size = 1 << level;
+        int left = (cx >> level) << level;
+        int top = (cy >> level) << level;
+        float tx = dx > 0.0f ? (left + size - ray.originX) / dx : dx < 0.0f ? (left - ray.originX) / dx : inf;
+        float ty = dy > 0.0f ? (top + size - ray.originY) / dy : dy < 0.0f ? (top - ray.originY) / dy : inf;
+
+        if (tx <= ty) {
+            t = std::max(t, tx);
+            cx = dx > 0.0f ? left + size : left - 1;
+            cy = std::min(std::max(static_cast<int>(std::floor(ray.originY + dy * t)), top), top + size - 1);
+            crossedX = true;
+        } else {
+            t = std::max(t, ty);
+            cy = dy > 0.0f ? top + size : top - 1;
+            cx = std::min(std::max(static_cast<int>(std::floor(ray.originX + dx * t)), left), left + size - 1);
+            crossedX = false;
+        }
+    }
+    return hit;
+}
+
+TerrainCollision::NearestSolid TerrainCollision::nearestSolid(float x, float y, float maxDistance) const {
+    NearestSolid result;
+    if (m_levels.empty()) {
+        return result;
+    }
+
+    struct Node {
+        float distanceSquared;
+        unsigned int level;
+        unsigned int bx;
+        unsigned int by;
+        bool operator>(const Node& other) const { return distanceSquared > other.distanceSquared; }
+    };
+    // Lower bound from (x, y) to the pixel centers inside a block
+    auto bound = [x, y](unsigned int level, unsigned int bx, unsigned int by) {
+        float size = static_cast<float>(1u << level);
+        float left = bx * size + 0.5f;
+        float top = by * size + 0.5f;
+        return distanceSquaredToRange(x, left, left + size - 1.0f) +
+               distanceSquaredToRange(y, top, top + size - 1.0f);
+    };
+
+    // Best-first over the pyramid: the first pixel popped is the closest one
+    float limit = maxDistance * maxDistance;
+    std::priority_queue<Node, std::vector<Node>, std::greater<Node>> queue;
+    unsigned int top = static_cast<unsigned int>(m_levels.size() - 1);
+    if (occupied(top, 0, 0)) {
+        queue.push(Node{bound(top, 0, 0), top, 0, 0});
+    }
+    while (!queue.empty()) {
+        Node node = queue.top();
+        queue.pop();
+        if (node.distanceSquared > limit) {
+            break;
+        }
+        if (node.level == 0) {
+            result.found = true;
+            result.cellX = static_cast<int>(node.bx);
+            result.cellY = static_cast<int>(node.by);
+            result.distance = std::sqrt(node.distanceSquared);
+            break;
+        }
+        unsigned int child = node.level - 1;
+        for (unsigned int cy = node.by * 2; cy < node.by * 2 + 2; cy++) {
+            for (unsigned int cx = node.bx * 2; cx < node.bx * 2 + 2; cx++) {
+                if (occupied(child, cx, cy)) {
+                    float d = bound(child, cx, cy);
+                    if (d <= limit) {
+                        queue.push(Node{d, child, cx, cy});
+                    }
+                }
+            }
+        }
+    }
+    return result;
+}
+
+void TerrainCollision::raycastBatch(const Ray* rays, RayHit* hits, size_t count, ThreadPool* pool) const {
+    ThreadPool& workers = pool ? *pool : ThreadPool::shared();
+    workers.parallelFor(0, count, 256, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            hits[i] = raycast(rays[i]);
+        }
+    });
+}
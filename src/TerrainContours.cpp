@@ -0,0 +1,398 @@
+#include "TerrainContours.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <unordered_map>
+
+namespace {
+
+// Marching squares corners are pixel centers; corner (i, j) is pixel (i, j).
+// Crossing vertices live on the grid edges between two corners, identified
+// by the lower corner and the direction, with a one-corner border of air.
+class EdgeGrid {
+public:
+    EdgeGrid(const TerrainBitmap& solid) : m_solid(solid), m_stride(static_cast<int64_t>(solid.width()) + 2) {}
+
+    bool solid(int i, int j) const {
+        return i >= 0 && j >= 0 && i < static_cast<int>(m_solid.width()) && j < static_cast<int>(m_solid.height()) &&
+               m_solid.get(static_cast<unsigned int>(i), static_cast<unsigned int>(j));
+    }
+    uint64_t horizontal(int i, int j) const { return static_cast<uint64_t>(((j + 1) * m_stride + (i + 1)) * 2); }
+    uint64_t vertical(int i, int j) const { return horizontal(i, j) + 1; }
+
+    void position(uint64_t edge, float& x, float& y) const {
+        int64_t corner = static_cast<int64_t>(edge / 2);
+        int i = static_cast<int>(corner % m_stride) - 1;
+        int j = static_cast<int>(corner / m_stride) - 1;
+        int i1 = (edge & 1) ? i : i + 1;
+        int j1 = (edge & 1) ? j + 1 : j;
+
+        // Sub-pixel placement from the smoothed occupancy, kept between the
+        // two pixel centers so the loops keep the topology of the bitmap
+        float g0 = smoothed(i, j);
+        float g1 = smoothed(i1, j1);
+        float t = 0.5f;
+        if (g0 != g1) {
+            t = std::min(std::max((0.5f - g0) / (g1 - g0), 0.25f), 0.75f);
+        }
+        x = i + 0.5f + t * (i1 - i);
+        y = j + 0.5f + t * (j1 - j);
+    }
+
+private:
+    float smoothed(int i, int j) const {
+        int count = 0;
+        for (int dj = -1; dj <= 1; dj++) {
+            for (int di = -1; di <= 1; di++) {
+                count += solid(i + di, j + dj);
+            }
+        }
+        return count / 9.0f;
+    }
+
+    const TerrainBitmap& m_solid;
+    int64_t m_stride;
+};
+
+struct Chain {
+    std::vector<uint64_t> edges;
+    bool closed{false};
+};
+
+// Traces cell rows [j0, j1) into chains of edge ids. Every crossing edge has
+// exactly one segment leaving it and one entering it across the whole grid,
+// so chains are either closed or end on the band seams.
+void traceBand(const EdgeGrid& grid, int width, int j0, int j1, std::vector<Chain>& chains) {
+    std::unordered_map<uint64_t, uint64_t> next;
+    std::unordered_map<uint64_t, uint64_t> previous;
+
+    for (int j = j0; j < j1; j++) {
+        for (int i = -1; i < width; i++) {
+            bool corners[4] = {grid.solid(i, j), grid.solid(i + 1, j), grid.solid(i + 1, j + 1), grid.solid(i, j + 1)};
+            if (corners[0] == corners[1] && corners[1] == corners[2] && corners[2] == corners[3]) {
+                continue;
+            }
+            // Cell sides clockwise on screen: top, right, bottom, left
+            uint64_t sides[4] = {grid.horizontal(i, j), grid.vertical(i + 1, j),
+                                 grid.horizontal(i, j + 1), grid.vertical(i, j)};
+            // Every exit (solid -> air along the walk) joins the entry right
+            // before it, which cuts off that arc of solid corners
+            int lastEnter = -1;
+            int firstExit = -1;
+            for (int side = 0; side < 4; side++) {
+                bool from = corners[side];
+                bool to = corners[(side + 1) % 4];
+                if (from == to) continue;
+                if (!from) {
+                    lastEnter = side;
+                } else if (lastEnter >= 0) {
+                    next[sides[side]] = sides[lastEnter];
+                    previous[sides[lastEnter]] = sides[side];
+                } else {
+                    firstExit = side;
+                }
+            }
+            if (firstExit >= 0) {
+                next[sides[firstExit]] = sides[lastEnter];
+                previous[sides[lastEnter]] = sides[firstExit];
+            }
+        }
+    }
+
+    std::unordered_map<uint64_t, bool> visited;
+    visited.reserve(next.size());
+    auto follow = [&](uint64_t start, Chain& chain) {
+        uint64_t edge = start;
+        for (;;) {
+            chain.edges.push_back(edge);
+            visited[edge] = true;
+            auto it = next.find(edge);
+            if (it == next.end()) {
+                return;  // Continues in another band
+            }
+            edge = it->second;
+            if (edge == start) {
+                chain.closed = true;
+                return;
+            }
+        }
+    };
+
+    // Open chains first, starting from edges nothing in this band leads to
+    for (const auto& segment : next) {
+        if (!previous.count(segment.first)) {
+            chains.emplace_back();
+            follow(segment.first, chains.back());
+        }
+    }
+    for (const auto& segment : next) {
+        if (!visited.count(segment.first)) {
+            chains.emplace_back();
+            follow(segment.first, chains.back());
+        }
+    }
+}
+
+float segmentDistanceSquared(float px, float py, float ax, float ay, float bx, float by) {
+    float dx = bx - ax;
+    float dy = by - ay;
+    float lengthSquared = dx * dx + dy * dy;
+    float t = lengthSquared > 0.0f ? ((px - ax) * dx + (py - ay) * dy) / lengthSquared : 0.0f;
+    t = std::min(std::max(t, 0.0f), 1.0f);
+    float ex = ax + t * dx - px;
+    float ey = ay + t * dy - py;
+    return ex * ex + ey * ey;
+}
+
+// Douglas-Peucker on the closed loop, split at point 0 and the point farthest from it
+void simplifyLoop(const std::vector<float>& xs, const std::vector<float>& ys, float tolerance,
+                  std::vector<uint8_t>& keep) {
+    size_t n = xs.size();
+    keep.assign(n, 0);
+    if (n < 4) {
+        std::fill(keep.begin(), keep.end(), 1);
+        return;
+    }
+
+    size_t far = 0;
+    float farDistance = -1.0f;
+    for (size_t i = 1; i < n; i++) {
+        float dx = xs[i] - xs[0];
+        float dy = ys[i] - ys[0];
+        if (dx * dx + dy * dy > farDistance) {
+            farDistance = dx * dx + dy * dy;
+            far = i;
+        }
+    }
+    keep[0] = 1;
+    keep[far] = 1;
+
+    float limit = tolerance * tolerance;
+    std::vector<std::pair<size_t, size_t>> stack = {{0, far}, {far, n}};
+    while (!stack.empty()) {
+        auto range = stack.back();
+        stack.pop_back();
+        size_t a = range.first;
+        size_t b = range.second;  // n stands for point 0 again
+        size_t bi = b % n;
+        float worst = -1.0f;
+        size_t worstIndex = 0;
+        for (size_t i = a + 1; i < b; i++) {
+            float d = segmentDistanceSquared(xs[i], ys[i], xs[a], ys[a], xs[bi], ys[bi]);
+            if (d > worst) {
+                worst = d;
+                worstIndex = i;
+            }
+        }
+        if (worst > limit) {
+            keep[worstIndex] = 1;
+            stack.push_back({a, worstIndex});
+            stack.push_back({worstIndex, b});
+        }
+    }
+}
+
+} // namespace
+
+size_t TerrainContours::holeCount() const {
+    return static_cast<size_t>(std::count(holes.begin(), holes.end(), uint8_t{1}));
+}
+
+void TerrainContours::clear() {
+    xs.clear();
+    ys.clear();
+    offsets.assign(1, 0);
+    holes.clear();
+}
+
+ContourStats extractContours(const TerrainBitmap& solid, float tolerance, TerrainContours& out,
+                             unsigned int tileRows, ThreadPool* pool) {
+    ContourExtractor extractor;
+    return extractor.extract(solid, tolerance, out, tileRows, pool);
+}
+
+ContourStats ContourExtractor::extract(const TerrainBitmap& solid, float tolerance, TerrainContours& out,
+                                       unsigned int tileRows, ThreadPool* pool) {
+    m_width = solid.width();
+    m_height = solid.height();
+    m_tolerance = tolerance;
+    m_tileRows = std::max(tileRows, 1u);
+    const int cellRows = static_cast<int>(m_height) + 1;  // From -1 to height - 1
+    m_tiles.assign((cellRows + m_tileRows - 1) / m_tileRows, Tile{});
+    std::vector<uint8_t> dirty(m_tiles.size(), 1);
+    return run(solid, dirty, out, pool);
+}
+
+ContourStats ContourExtractor::update(const TerrainBitmap& solid, int y0, int y1, TerrainContours& out,
+                                      ThreadPool* pool) {
+    if (m_tiles.empty() || solid.width() != m_width || solid.height() != m_height) {
+        return extract(solid, m_tolerance, out, m_tileRows, pool);
+    }
+    // Cell row j reads pixel rows j and j + 1, and vertex placement reads one
+    // more row on either side, so tile [j0, j1) sees pixel rows [j0 - 1, j1 + 2)
+    std::vector<uint8_t> dirty(m_tiles.size(), 0);
+    for (size_t tile = 0; tile < m_tiles.size(); tile++) {
+        int j0 = -1 + static_cast<int>(tile * m_tileRows);
+        int j1 = j0 + static_cast<int>(m_tileRows);
+        dirty[tile] = j0 - 1 < y1 && y0 < j1 + 2;
+    }
+    return run(solid, dirty, out, pool);
+}
+
+ContourStats ContourExtractor::run(const TerrainBitmap& solid, const std::vector<uint8_t>& dirty,
+                                   TerrainContours& out, ThreadPool* pool) {
+    auto start = std::chrono::steady_clock::now();
+    ContourStats stats;
+    stats.tiles = m_tiles.size();
+    out.clear();
+
+    ThreadPool& workers = pool ? *pool : ThreadPool::shared();
+    EdgeGrid grid(solid);
+    const int width = static_cast<int>(m_width);
+    const int cellRows = static_cast<int>(m_height) + 1;
+    const float tolerance = m_tolerance;
+
+    // Positions, orientation and simplification of one finished loop
+    auto finish = [&grid, tolerance](const std::vector<uint64_t>& edges, std::vector<float>& xs,
+                                     std::vector<float>& ys, std::vector<uint8_t>& keep, TerrainContours& loops) {
+        xs.resize(edges.size());
+        ys.resize(edges.size());
+        double area = 0.0;
+        for (size_t k = 0; k < edges.size(); k++) {
+            grid.position(edges[k], xs[k], ys[k]);
+        }
+        for (size_t k = 0; k < edges.size(); k++) {
+            size_t n = (k + 1) % edges.size();
+            area += static_cast<double>(xs[k]) * ys[n] - static_cast<double>(xs[n]) * ys[k];
+        }
+
+        simplifyLoop(xs, ys, tolerance, keep);
+        size_t kept = static_cast<size_t>(std::count(keep.begin(), keep.end(), uint8_t{1}));
+        if (kept < 3) return;
+        for (size_t k = 0; k < xs.size(); k++) {
+            if (keep[k]) {
+                loops.xs.push_back(xs[k]);
+                loops.ys.push_back(ys[k]);
+            }
+        }
+        loops.offsets.push_back(static_cast<uint32_t>(loops.xs.size()));
+        loops.holes.push_back(area < 0.0 ? 1 : 0);
+    };
+
+    // Loops closed inside a tile are finished with it and kept until the tile
+    // is traced again; only the chains ending on seams carry over
+    workers.parallelFor(0, m_tiles.size(), 1, [&](size_t begin, size_t end) {
+        std::vector<Chain> chains;
+        std::vector<float> xs, ys;
+        std::vector<uint8_t> keep;
+        for (size_t tile = begin; tile < end; tile++) {
+            if (!dirty[tile]) continue;
+            int j0 = -1 + static_cast<int>(tile * m_tileRows);
+            int j1 = std::min(j0 + static_cast<int>(m_tileRows), cellRows - 1);
+            chains.clear();
+            traceBand(grid, width, j0, j1, chains);
+
+            Tile& traced = m_tiles[tile];
+            traced.open.clear();
+            traced.closed.clear();
+            traced.closedRawPoints = 0;
+            for (Chain& chain : chains) {
+                if (chain.closed) {
+                    traced.closedRawPoints += chain.edges.size();
+                    finish(chain.edges, xs, ys, keep, traced.closed);
+                } else {
+                    traced.open.push_back(std::move(chain.edges));
+                }
+            }
+        }
+    });
+    stats.tracedTiles = static_cast<size_t>(std::count(dirty.begin(), dirty.end(), uint8_t{1}));
+
+    // Seam stitching: an open chain continues with the chain starting where it ends
+    std::vector<std::vector<uint64_t>> loops;
+    std::vector<const std::vector<uint64_t>*> open;
+    std::unordered_map<uint64_t, size_t> openByFirstEdge;
+    for (const Tile& tile : m_tiles) {
+        for (const std::vector<uint64_t>& chain : tile.open) {
+            openByFirstEdge[chain.front()] = open.size();
+            open.push_back(&chain);
+        }
+    }
+    std::vector<uint8_t> used(open.size(), 0);
+    for (size_t i = 0; i < open.size(); i++) {
+        if (used[i]) continue;
+        std::vector<uint64_t> loop;
+        size_t current = i;
+        while (!used[current]) {
+            used[current] = 1;
+            const std::vector<uint64_t>& edges = *open[current];
+            loop.insert(loop.end(), edges.begin(), edges.end());
+            // The edge after the last one is the first edge of the next chain
+            auto it = openByFirstEdge.find(loop.back());
+            if (it == openByFirstEdge.end()) break;
+            current = it->second;
+        }
+        // The last edge was also recorded as the next chain's first edge
+        for (size_t k = 1; k < loop.size(); k++) {
+            if (loop[k] == loop[k - 1]) {
+                loop.erase(loop.begin() + k);
+                k--;
+            }
+        }
+        if (loop.size() > 1 && loop.front() == loop.back()) {
+            loop.pop_back();
+        }
+        loops.push_back(std::move(loop));
+    }
+
+    std::vector<TerrainContours> stitched(loops.size());
+    workers.parallelFor(0, loops.size(), 16, [&](size_t begin, size_t end) {
+        std::vector<float> xs, ys;
+        std::vector<uint8_t> keep;
+        for (size_t l = begin; l < end; l++) {
+            finish(loops[l], xs, ys, keep, stitched[l]);
+        }
+    });
+
+    // Tile loops in tile order, then the stitched ones, as a single pass would
+    auto append = [&out](const TerrainContours& loops) {
+        for (size_t l = 0; l < loops.loopCount(); l++) {
+            out.xs.insert(out.xs.end(), loops.xs.begin() + loops.begin(l), loops.xs.begin() + loops.offsets[l + 1]);
+            out.ys.insert(out.ys.end(), loops.ys.begin() + loops.begin(l), loops.ys.begin() + loops.offsets[l + 1]);
+            out.offsets.push_back(static_cast<uint32_t>(out.xs.size()));
+            out.holes.push_back(loops.holes[l]);
+        }
+    };
+    for (const Tile& tile : m_tiles) {
+        stats.rawPoints += tile.closedRawPoints;
+        append(tile.closed);
+    }
+    for (size_t l = 0; l < loops.size(); l++) {
+        stats.rawPoints += loops[l].size();
+        append(stitched[l]);
+    }
+
+    stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+bool writeContours(const std::string& filename, const TerrainContours& contours) {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    uint32_t header[4] = {0x544E4354u, 1u, static_cast<uint32_t>(contours.loopCount()),
+                          static_cast<uint32_t>(contours.pointCount())};  // "TCNT"
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    for (size_t i = 0; i < contours.loopCount(); i++) {
+        uint32_t count = contours.size(i) | (contours.holes[i] ? 0x80000000u : 0u);
+        file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    }
+    for (size_t i = 0; i < contours.pointCount(); i++) {
+        float point[2] = {contours.xs[i], contours.ys[i]};
+        file.write(reinterpret_cast<const char*>(point), sizeof(point));
+    }
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,808 @@
+#include "TerrainCoverage.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+struct RowSpan {
+    int row;
+    int x0;
+    int x1;
+    bool cave;
+};
+
+struct Bounds {
+    float minX, minY, maxX, maxY;
+};
+
+Bounds polygonBounds(const TerrainOutlines& outlines, size_t polygon) {
+    const float* xs = outlines.xs.data() + outlines.begin(polygon);
+    const float* ys = outlines.ys.data() + outlines.begin(polygon);
+    uint32_t count = outlines.size(polygon);
+    auto [minX, maxX] = std::minmax_element(xs, xs + count);
+    auto [minY, maxY] = std::minmax_element(ys, ys + count);
+    return Bounds{*minX, *minY, *maxX, *maxY};
+}
+
+bool overlaps(const Bounds& a, const Bounds& b) {
+    return a.minX < b.maxX && b.minX < a.maxX && a.minY < b.maxY && b.minY < a.maxY;
+}
+
+// Merges sorted spans in place into disjoint ones, returns the new count
+size_t mergeSpans(RowSpan* spans, size_t count) {
+    if (count == 0) {
+        return 0;
+    }
+    std::sort(spans, spans + count, [](const RowSpan& a, const RowSpan& b) { return a.x0 < b.x0; });
+    size_t merged = 0;
+    for (size_t i = 1; i < count; i++) {
+        if (spans[i].x0 <= spans[merged].x1) {
+            spans[merged].x1 = std::max(spans[merged].x1, spans[i].x1);
+        } else {
+            spans[++merged] = spans[i];
+        }
+    }
+    return merged + 1;
+}
+
+// Whether segment a-b meets segment c-d, at parameter t along a-b and u
+// along c-d, both in [0, 1]. Collinear segments sharing more than a point
+// set `collinear`; segments meeting at an endpoint of either one set
+// `touching`.
+bool segmentCrossing(double ax, double ay, double bx, double by, double cx, double cy, double dx, double dy,
+                     double& t, double& u, bool& collinear, bool& touching) {
+    double rx = bx - ax;
+    double ry = by - ay;
+    double sx = dx - cx;
+    double sy = dy - cy;
+    double qx = cx - ax;
+    double qy = cy - ay;
+    double denominator = rx * sy - ry * sx;
+    if (denominator == 0.0) {
+        double lengthSquared = rx * rx + ry * ry;
+        if (qx * ry - qy * rx == 0.0 && lengthSquared > 0.0) {
+            double t0 = (qx * rx + qy * ry) / lengthSquared;
+            double t1 = t0 + (sx * rx + sy * ry) / lengthSquared;
+            double overlap = std::min(std::max(t0, t1), 1.0) - std::max(std::min(t0, t1), 0.0);
+            if (overlap > 0.0) {
+                collinear = true;
+            } else if (overlap == 0.0) {
+                touching = true;
+            }
+        }
+        return false;
+    }
+    t = (qx * sy - qy * sx) / denominator;
+    u = (qx * ry - qy * rx) / denominator;
+    if (t < 0.0 || t > 1.0 || u < 0.0 || u > 1.0) {
+        return false;
+    }
+    if (t == 0.0 || t == 1.0 || u == 0.0 || u == 1.0) {
+        touching = true;
+    }
+    return true;
+}
+
+// Even-odd, the rule the rasterizer fills by
+bool insidePolygon(const TerrainOutlines& outlines, size_t polygon, double x, double y) {
+    const float* xs = outlines.xs.data() + outlines.begin(polygon);
+    const float* ys = outlines.ys.data() + outlines.begin(polygon);
+    uint32_t count = outlines.size(polygon);
+    bool inside = false;
+    for (uint32_t i = 0, j = count - 1; i < count; j = i++) {
+        if ((ys[i] > y) != (ys[j] > y) &&
+            x < (static_cast<double>(xs[j]) - xs[i]) * (y - ys[i]) / (static_cast<double>(ys[j]) - ys[i]) + xs[i]) {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
+
+// The visible terrain: inside the canvas, inside some blob and outside every
+// cave. Point tests only consult the polygons they are handed, the caller
+// passes the ones whose bounds can reach the point.
+class SolidRegion {
+public:
+    SolidRegion(const TerrainOutlines& outlines, const std::vector<Bounds>& bounds, double width, double height)
+        : m_outlines(outlines), m_bounds(bounds), m_width(width), m_height(height) {}
+
+    bool contains(double x, double y, const std::vector<uint32_t>& polygons) const {
+        if (x < 0.0 || y < 0.0 || x > m_width || y > m_height) {
+            return false;
+        }
+        bool solid = false;
+        for (uint32_t polygon : polygons) {
+            if (!m_outlines.isCave(polygon) && near(polygon, x, y) && insidePolygon(m_outlines, polygon, x, y)) {
+                solid = true;
+                break;
+            }
+        }
+        if (!solid) {
+            return false;
+        }
+        for (uint32_t polygon : polygons) {
+            if (m_outlines.isCave(polygon) && near(polygon, x, y) && insidePolygon(m_outlines, polygon, x, y)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Which side of the piece a-b the region is on: 1 left, -1 right, 0 when
+    // the piece does not bound it
+    int side(double ax, double ay, double bx, double by, const std::vector<uint32_t>& polygons) const {
+        double dx = bx - ax;
+        double dy = by - ay;
+        double length = std::sqrt(dx * dx + dy * dy);
+        if (length <= 0.0) {
+            return 0;
+        }
+        double nx = -dy / length * SideOffset;
+        double ny = dx / length * SideOffset;
+        double mx = (ax + bx) * 0.5;
+        double my = (ay + by) * 0.5;
+        bool left = contains(mx + nx, my + ny, polygons);
+        bool right = contains(mx - nx, my - ny, polygons);
+        return left == right ? 0 : left ? 1 : -1;
+    }
+
+    // side() for a piece of an edge of `owner`. Every other polygon is on
+    // the same side of the piece throughout, so one test at its midpoint
+    // settles whether it bounds the region and only the owner needs a probe.
+    int edgeSide(uint32_t owner, double ax, double ay, double bx, double by,
+                 const std::vector<uint32_t>& polygons) const {
+        double mx = (ax + bx) * 0.5;
+        double my = (ay + by) * 0.5;
+        if (mx < 0.0 || my < 0.0 || mx > m_width || my > m_height) {
+            return 0;
+        }
+        // A blob edge bounds the terrain outside other blobs, a cave edge inside them
+        bool cave = m_outlines.isCave(owner);
+        bool inBlob = false;
+        for (uint32_t polygon : polygons) {
+            if (polygon != owner && !m_outlines.isCave(polygon) && near(polygon, mx, my) &&
+                insidePolygon(m_outlines, polygon, mx, my)) {
+                inBlob = true;
+                break;
+            }
+        }
+        if (inBlob != cave) {
+            return 0;
+        }
+        for (uint32_t polygon : polygons) {
+            if (polygon != owner && m_outlines.isCave(polygon) && near(polygon, mx, my) &&
+                insidePolygon(m_outlines, polygon, mx, my)) {
+                return 0;
+            }
+        }
+        double dx = bx - ax;
+        double dy = by - ay;
+        double length = std::sqrt(dx * dx + dy * dy);
+        if (length <= 0.0) {
+            return 0;
+        }
+        // Terrain lies inside a blob and outside a cave
+        bool leftInside = insidePolygon(m_outlines, owner, mx - dy / length * SideOffset, my + dx / length * SideOffset);
+        return leftInside != cave ? 1 : -1;
+    }
+
+    bool insideCanvas(double x, double y) const { return x >= 0.0 && y >= 0.0 && x <= m_width && y <= m_height; }
+    // Whether (x, y) lies in `polygon` alone
+    bool covers(uint32_t polygon, double x, double y) const {
+        return near(polygon, x, y) && insidePolygon(m_outlines, polygon, x, y);
+    }
+
+    // Distance of the side probes from a boundary piece, in pixels
+    static constexpr double SideOffset = 1e-3;
+
+private:
+    bool near(uint32_t polygon, double x, double y) const {
+        const Bounds& b = m_bounds[polygon];
+        return x >= b.minX && x <= b.maxX && y >= b.minY && y <= b.maxY;
+    }
+
+    const TerrainOutlines& m_outlines;
+    const std::vector<Bounds>& m_bounds;
+    double m_width;
+    double m_height;
+};
+
+// Edges of the relevant polygons bucketed into a uniform grid about one
+// edge long per cell, so only edges sharing a cell are tested against each
+// other instead of every edge of every overlapping polygon. Edge i runs from
+// point i of the outlines to next(i).
+class EdgeGrid {
+public:
+    EdgeGrid(const TerrainOutlines& outlines, const std::vector<uint8_t>& relevant)
+        : m_next(outlines.pointCount()), m_owner(outlines.pointCount()) {
+        const float* xs = outlines.xs.data();
+        const float* ys = outlines.ys.data();
+        size_t edgeCount = 0;
+        double totalLength = 0.0;
+        m_origin = Bounds{INFINITY, INFINITY, -INFINITY, -INFINITY};
+        for (size_t p = 0; p < outlines.polygonCount(); p++) {
+            if (!relevant[p]) {
+                continue;
+            }
+            uint32_t begin = outlines.begin(p);
+            uint32_t end = begin + outlines.size(p);
+            for (uint32_t i = begin; i < end; i++) {
+                uint32_t next = i + 1 == end ? begin : i + 1;
+                m_next[i] = next;
+                m_owner[i] = static_cast<uint32_t>(p);
+                totalLength += std::hypot(xs[next] - xs[i], ys[next] - ys[i]);
+                m_origin.minX = std::min(m_origin.minX, xs[i]);
+                m_origin.minY = std::min(m_origin.minY, ys[i]);
+                m_origin.maxX = std::max(m_origin.maxX, xs[i]);
+                m_origin.maxY = std::max(m_origin.maxY, ys[i]);
+            }
+            edgeCount += end - begin;
+        }
+        if (edgeCount == 0) {
+            return;
+        }
+        double spanX = static_cast<double>(m_origin.maxX) - m_origin.minX;
+        double spanY = static_cast<double>(m_origin.maxY) - m_origin.minY;
+        if (!std::isfinite(spanX + spanY + totalLength)) {
+            m_unbounded = true;
+            return;
+        }
+        m_cellSize = std::max(totalLength / edgeCount, 1.0);
+        // Never much more than a few cells per edge, however short the edges
+        double cells = (spanX / m_cellSize + 1.0) * (spanY / m_cellSize + 1.0);
+        if (cells > 4.0 * edgeCount) {
+            m_cellSize *= std::sqrt(cells / (4.0 * edgeCount));
+        }
+        m_columns = static_cast<int>(spanX / m_cellSize) + 1;
+        m_rows = static_cast<int>(spanY / m_cellSize) + 1;
+
+        // Counting pass, then a fill in the same order
+        m_cellStart.assign(static_cast<size_t>(m_columns) * m_rows + 1, 0);
+        forEachEdge(outlines, relevant, [this](uint32_t, size_t cell) { m_cellStart[cell + 1]++; });
+        for (size_t c = 1; c < m_cellStart.size(); c++) {
+            m_cellStart[c] += m_cellStart[c - 1];
+        }
+        m_edges.resize(m_cellStart.back());
+        m_boxes.resize(m_cellStart.back());
+        std::vector<uint32_t> cursor(m_cellStart.begin(), m_cellStart.end() - 1);
+        forEachEdge(outlines, relevant, [this, &cursor, xs, ys](uint32_t edge, size_t cell) {
+            uint32_t next = m_next[edge];
+            m_boxes[cursor[cell]] = Bounds{std::min(xs[edge], xs[next]), std::min(ys[edge], ys[next]),
+                                           std::max(xs[edge], xs[next]), std::max(ys[edge], ys[next])};
+            m_edges[cursor[cell]++] = edge;
+        });
+    }
+
+    uint32_t next(uint32_t edge) const { return m_next[edge]; }
+    uint32_t owner(uint32_t edge) const { return m_owner[edge]; }
+
+    // Edge pairs forEachPair() tests, UINT64_MAX when non-finite points
+    // left the grid unbuilt
+    uint64_t pairWork() const {
+        if (m_unbounded) {
+            return UINT64_MAX;
+        }
+        uint64_t work = 0;
+        for (size_t c = 0; c + 1 < m_cellStart.size(); c++) {
+            uint64_t count = m_cellStart[c + 1] - m_cellStart[c];
+            work += count * (count - 1) / 2;
+        }
+        return work;
+    }
+
+    // Calls fn(a, b) once for every pair of edges whose boxes meet
+    template <typename Fn>
+    void forEachPair(Fn&& fn) const {
+        for (int r = 0; r < m_rows; r++) {
+            for (int c = 0; c < m_columns; c++) {
+                size_t cell = static_cast<size_t>(r) * m_columns + c;
+                uint32_t end = m_cellStart[cell + 1];
+                for (uint32_t i = m_cellStart[cell]; i < end; i++) {
+                    const Bounds& a = m_boxes[i];
+                    for (uint32_t j = i + 1; j < end; j++) {
+                        const Bounds& b = m_boxes[j];
+                        if (b.maxX < a.minX || b.minX > a.maxX || b.maxY < a.minY || b.minY > a.maxY) {
+                            continue;
+                        }
+                        // Boxes sharing several cells meet in all of them,
+                        // only the one holding their overlap's corner counts
+                        if (column(std::max(a.minX, b.minX)) == c && row(std::max(a.minY, b.minY)) == r) {
+                            fn(m_edges[i], m_edges[j]);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    int column(float x) const {
+        return std::min(std::max(static_cast<int>((x - m_origin.minX) / m_cellSize), 0), m_columns - 1);
+    }
+    int row(float y) const {
+        return std::min(std::max(static_cast<int>((y - m_origin.minY) / m_cellSize), 0), m_rows - 1);
+    }
+
+    // fn(edge, cell) for every cell the box of every relevant edge covers
+    template <typename Fn>
+    void forEachEdge(const TerrainOutlines& outlines, const std::vector<uint8_t>& relevant, Fn&& fn) const {
+        const float* xs = outlines.xs.data();
+        const float* ys = outlines.ys.data();
+        for (size_t p = 0; p < outlines.polygonCount(); p++) {
+            if (!relevant[p]) {
+                continue;
+            }
+            uint32_t begin = outlines.begin(p);
+            uint32_t end = begin + outlines.size(p);
+            for (uint32_t i = begin; i < end; i++) {
+                uint32_t next = m_next[i];
+                int lastColumn = column(std::max(xs[i], xs[next]));
+                int lastRow = row(std::max(ys[i], ys[next]));
+                for (int r = row(std::min(ys[i], ys[next])); r <= lastRow; r++) {
+                    for (int c = column(std::min(xs[i], xs[next])); c <= lastColumn; c++) {
+                        fn(i, static_cast<size_t>(r) * m_columns + c);
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<uint32_t> m_next;
+    std::vector<uint32_t> m_owner;
+    std::vector<uint32_t> m_cellStart;
+    std::vector<uint32_t> m_edges;
+    std::vector<Bounds> m_boxes;        // Box of the edge at the same entry
+    Bounds m_origin{0.0f, 0.0f, 0.0f, 0.0f};  // Box around every relevant point
+    double m_cellSize{1.0};
+    int m_columns{0};
+    int m_rows{0};
+    bool m_unbounded{false};
+};
+
+constexpr uint32_t NoOwner = 0xFFFFFFFFu;
+
+// Edge pairs estimateCoverage() takes on per row the exact walk would
+// cover. A pair costs about as much as an exact row, and the estimate has
+// per-edge work on top, so past this it would take longer than the exact
+// answer.
+constexpr double OverlapWorkPerRow = 0.6;
+
+// Signed area the segment a-b adds once split at every `cuts` parameter:
+// each piece bounding the region contributes its shoelace term, positive
+// with the region on its left. `owner` is the polygon the segment is an
+// edge of, NoOwner for the canvas border.
+double splitBoundaryTerm(const SolidRegion& region, uint32_t owner, double ax, double ay, double bx, double by,
+                         std::vector<double>& cuts, const std::vector<uint32_t>& polygons) {
+    cuts.push_back(0.0);
+    cuts.push_back(1.0);
+    std::sort(cuts.begin(), cuts.end());
+    double area = 0.0;
+    for (size_t k = 0; k + 1 < cuts.size(); k++) {
+        double t0 = cuts[k];
+        double t1 = cuts[k + 1];
+        if (t1 - t0 <= 1e-12) {
+            continue;
+        }
+        double x0 = ax + (bx - ax) * t0;
+        double y0 = ay + (by - ay) * t0;
+        double x1 = ax + (bx - ax) * t1;
+        double y1 = ay + (by - ay) * t1;
+        int side = owner == NoOwner ? region.side(x0, y0, x1, y1, polygons)
+                                    : region.edgeSide(owner, x0, y0, x1, y1, polygons);
+        area += side * (x0 * y1 - x1 * y0) * 0.5;
+    }
+    return area;
+}
+
+// Where an outline edge is crossed, and by which polygon's edge
+struct Cut {
+    double t;
+    uint32_t polygon;  // NoOwner for the canvas border
+};
+
+// Parameters where a-b crosses the canvas border lines
+void canvasCuts(double ax, double ay, double bx, double by, double width, double height, std::vector<Cut>& cuts) {
+    const double lines[4] = {0.0, width, 0.0, height};
+    for (int i = 0; i < 4; i++) {
+        double a = i < 2 ? ax : ay;
+        double b = i < 2 ? bx : by;
+        if ((a - lines[i]) * (b - lines[i]) < 0.0) {
+            cuts.push_back(Cut{(lines[i] - a) / (b - a), NoOwner});
+        }
+    }
+}
+
+// The boundary terms of every edge of polygon `owner`, like
+// splitBoundaryTerm() on each, but probing only once. Which of `polygons`
+// hold the walk changes only where it crosses one of their edges, so a
+// single probe at the start is followed by one flip per cut; crossing an
+// edge of the owner itself flips the side the owner lies on. Edge k is cut
+// at cuts[cutStart[k] .. cutStart[k + 1]), which this sorts. Every cut must
+// be a clean crossing: one through a vertex would be seen twice or not at
+// all. `inside` is scratch, one entry per polygon.
+double walkBoundaryTerm(const TerrainOutlines& outlines, const SolidRegion& region, uint32_t owner,
+                        std::vector<Cut>& cuts, const std::vector<uint32_t>& cutStart,
+                        const std::vector<uint32_t>& polygons, std::vector<uint8_t>& inside) {
+    const float* xs = outlines.xs.data() + outlines.begin(owner);
+    const float* ys = outlines.ys.data() + outlines.begin(owner);
+    uint32_t count = outlines.size(owner);
+    bool cave = outlines.isCave(owner);
+
+    // Start on the longest uncut stretch, where the probes sit furthest from other edges
+    uint32_t start = 0;
+    double startLength = -1.0;
+    for (uint32_t k = 0; k < count; k++) {
+        std::sort(cuts.begin() + cutStart[k], cuts.begin() + cutStart[k + 1],
+                  [](const Cut& a, const Cut& b) { return a.t < b.t; });
+        uint32_t next = k + 1 == count ? 0 : k + 1;
+        double firstCut = cutStart[k + 1] > cutStart[k] ? cuts[cutStart[k]].t : 1.0;
+        double length = std::hypot(static_cast<double>(xs[next]) - xs[k], static_cast<double>(ys[next]) - ys[k]) * firstCut;
+        if (length > startLength) {
+            startLength = length;
+            start = k;
+        }
+    }
+    if (startLength <= 0.0) {
+        return 0.0;
+    }
+    uint32_t startNext = start + 1 == count ? 0 : start + 1;
+    double firstCut = cutStart[start + 1] > cutStart[start] ? cuts[cutStart[start]].t : 1.0;
+    double dx = static_cast<double>(xs[startNext]) - xs[start];
+    double dy = static_cast<double>(ys[startNext]) - ys[start];
+    double mx = xs[start] + dx * firstCut * 0.5;
+    double my = ys[start] + dy * firstCut * 0.5;
+    int blobsInside = 0;
+    int cavesInside = 0;
+    for (uint32_t polygon : polygons) {
+        inside[polygon] = polygon != owner && region.covers(polygon, mx, my);
+        if (inside[polygon]) {
+            (outlines.isCave(polygon) ? cavesInside : blobsInside)++;
+        }
+    }
+    double length = std::hypot(dx, dy);
+    bool leftInside = insidePolygon(outlines, owner, mx - dy / length * SolidRegion::SideOffset,
+                                    my + dx / length * SolidRegion::SideOffset);
+
+    double area = 0.0;
+    for (uint32_t step = 0; step < count; step++) {
+        uint32_t k = (start + step) % count;
+        uint32_t next = k + 1 == count ? 0 : k + 1;
+        double ax = xs[k], ay = ys[k], bx = xs[next], by = ys[next];
+        double t0 = 0.0;
+        for (uint32_t c = cutStart[k]; c <= cutStart[k + 1]; c++) {
+            bool last = c == cutStart[k + 1];
+            double t1 = last ? 1.0 : cuts[c].t;
+            if (t1 - t0 > 1e-12) {
+                double x0 = ax + (bx - ax) * t0;
+                double y0 = ay + (by - ay) * t0;
+                double x1 = ax + (bx - ax) * t1;
+                double y1 = ay + (by - ay) * t1;
+                // Same rule as SolidRegion::edgeSide()
+                if (region.insideCanvas((x0 + x1) * 0.5, (y0 + y1) * 0.5) && (blobsInside > 0) == cave &&
+                    cavesInside == 0) {
+                    area += (leftInside != cave ? 1 : -1) * (x0 * y1 - x1 * y0) * 0.5;
+                }
+            }
+            if (last) {
+                break;
+            }
+            uint32_t polygon = cuts[c].polygon;
+            if (polygon == owner) {
+                leftInside = !leftInside;
+            } else if (polygon != NoOwner) {
+                inside[polygon] = !inside[polygon];
+                (outlines.isCave(polygon) ? cavesInside : blobsInside) += inside[polygon] ? 1 : -1;
+            }
+            t0 = t1;
+        }
+    }
+    return area;
+}
+
+} // namespace
+
+CoverageResult exactCoverage(const TerrainOutlines& outlines, unsigned int width, unsigned int height) {
+    Clock::time_point start = Clock::now();
+    CoverageResult result;
+    result.exact = true;
+
+    std::vector<RowSpan> spans;
+    ScanlineRasterizer rasterizer;
+    for (size_t i = 0; i < outlines.polygonCount(); i++) {
+        uint32_t begin = outlines.begin(i);
+        bool cave = outlines.isCave(i);
+        rasterizer.fill(outlines.xs.data() + begin, outlines.ys.data() + begin, outlines.size(i),
+                        static_cast<int>(width), static_cast<int>(height),
+                        [&spans, cave](int y, int x0, int x1) { spans.push_back(RowSpan{y, x0, x1, cave}); });
+    }
+
+    // Bucket spans by row, blobs before caves within a row
+    std::vector<uint32_t> rowStart(height + 1, 0);
+    for (const RowSpan& span : spans) {
+        rowStart[span.row + 1]++;
+    }
+    for (unsigned int y = 0; y < height; y++) {
+        rowStart[y + 1] += rowStart[y];
+    }
+    std::vector<RowSpan> sorted(spans.size());
+    std::vector<uint32_t> cursor(rowStart.begin(), rowStart.end() - 1);
+    for (const RowSpan& span : spans) {
+        if (!span.cave) {
+            sorted[cursor[span.row]++] = span;
+        }
+    }
+    std::vector<uint32_t> caveStart(cursor);
+    for (const RowSpan& span : spans) {
+        if (span.cave) {
+            sorted[cursor[span.row]++] = span;
+        }
+    }
+
+    for (unsigned int y = 0; y < height; y++) {
+        RowSpan* blobs = sorted.data() + rowStart[y];
+        RowSpan* caves = sorted.data() + caveStart[y];
+        size_t blobCount = mergeSpans(blobs, caveStart[y] - rowStart[y]);
+        size_t caveCount = mergeSpans(caves, rowStart[y + 1] - caveStart[y]);
+
+        // Terrain length minus the part of it the caves cover
+        size_t c = 0;
+        for (size_t b = 0; b < blobCount; b++) {
+            int covered = blobs[b].x1 - blobs[b].x0;
+            while (c < caveCount && caves[c].x1 <= blobs[b].x0) {
+                c++;
+            }
+            for (size_t k = c; k < caveCount && caves[k].x0 < blobs[b].x1; k++) {
+                covered -= std::min(blobs[b].x1, caves[k].x1) - std::max(blobs[b].x0, caves[k].x0);
+            }
+            result.solidPixels += covered;
+        }
+    }
+
+    result.coverage = static_cast<float>(result.solidPixels) / (static_cast<float>(width) * height) * 100.0f;
+    result.milliseconds = elapsedMs(start);
+    return result;
+}
+
+CoverageResult estimateCoverage(const TerrainOutlines& outlines, unsigned int width, unsigned int height) {
+    Clock::time_point start = Clock::now();
+    CoverageResult result;
+    const double canvasWidth = width;
+    const double canvasHeight = height;
+
+    // Bounds grown by the probe offset, so every polygon that can hold a
+    // probe point next to an edge shows up among that edge's neighbours
+    const float margin = 0.01f;
+    std::vector<Bounds> bounds(outlines.polygonCount());
+    for (size_t i = 0; i < bounds.size(); i++) {
+        Bounds box = polygonBounds(outlines, i);
+        bounds[i] = Bounds{box.minX - margin, box.minY - margin, box.maxX + margin, box.maxY + margin};
+    }
+
+    // Polygons whose bounds meet, found with a sweep along x so thousands of
+    // caves stay cheap. Each list starts with the polygon itself.
+    std::vector<std::vector<uint32_t>> neighbours(bounds.size());
+    std::vector<uint32_t> order(bounds.size());
+    for (uint32_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+        neighbours[i].push_back(i);
+    }
+    std::sort(order.begin(), order.end(),
+              [&bounds](uint32_t a, uint32_t b) { return bounds[a].minX < bounds[b].minX; });
+    for (size_t i = 0; i < order.size(); i++) {
+        const Bounds& current = bounds[order[i]];
+        for (size_t j = i + 1; j < order.size() && bounds[order[j]].minX < current.maxX; j++) {
+            if (overlaps(current, bounds[order[j]])) {
+                neighbours[order[i]].push_back(order[j]);
+                neighbours[order[j]].push_back(order[i]);
+            }
+        }
+    }
+    // A cave away from every blob carves nothing, it can be left out entirely
+    std::vector<uint8_t> relevant(bounds.size(), 0);
+    for (size_t p = 0; p < bounds.size(); p++) {
+        relevant[p] = !outlines.isCave(p) ||
+                      std::any_of(neighbours[p].begin(), neighbours[p].end(),
+                                  [&outlines](uint32_t other) { return !outlines.isCave(other); });
+    }
+    for (std::vector<uint32_t>& list : neighbours) {
+        list.erase(std::remove_if(list.begin(), list.end(), [&relevant](uint32_t other) { return !relevant[other]; }),
+                   list.end());
+    }
+
+    // Cutting the edges costs roughly one test per edge pair sharing a grid
+    // cell; caves piled on each other make that more than the exact span
+    // walk, which is the better answer then anyway
+    EdgeGrid grid(outlines, relevant);
+    if (static_cast<double>(grid.pairWork()) > OverlapWorkPerRow * exactCoverageCost(outlines, height)) {
+        result.unresolved = true;
+        result.milliseconds = elapsedMs(start);
+        return result;
+    }
+
+    // Green's theorem over the boundary of the solid region: every edge is
+    // cut where other edges (or the canvas border) cross it, and each piece
+    // with solid on exactly one side adds its shoelace term. Overlapping
+    // blobs, caves over air and caves hanging off the canvas all come out
+    // right without clipping polygons against each other.
+    SolidRegion region(outlines, bounds, canvasWidth, canvasHeight);
+    bool collinear = false;
+    std::vector<uint8_t> touching(outlines.polygonCount(), 0);
+    std::vector<std::pair<uint32_t, Cut>> crossings;
+    grid.forEachPair([&](uint32_t a, uint32_t b) {
+        // An edge and its two neighbours share endpoints, nothing to cut there
+        if (grid.next(a) == b || grid.next(b) == a) {
+            return;
+        }
+        const float* xs = outlines.xs.data();
+        const float* ys = outlines.ys.data();
+        double t, u;
+        bool touches = false;
+        bool meet = segmentCrossing(xs[a], ys[a], xs[grid.next(a)], ys[grid.next(a)], xs[b], ys[b], xs[grid.next(b)],
+                                    ys[grid.next(b)], t, u, collinear, touches);
+        if (touches) {
+            touching[grid.owner(a)] = 1;
+            touching[grid.owner(b)] = 1;
+        }
+        if (!meet) {
+            return;
+        }
+        if (t > 0.0 && t < 1.0) {
+            crossings.push_back({a, Cut{t, grid.owner(b)}});
+        }
+        if (u > 0.0 && u < 1.0) {
+            crossings.push_back({b, Cut{u, grid.owner(a)}});
+        }
+    });
+    // Bucketed by the edge they cut
+    std::vector<uint32_t> crossingStart(outlines.pointCount() + 1, 0);
+    for (const auto& crossing : crossings) {
+        crossingStart[crossing.first + 1]++;
+    }
+    for (size_t i = 1; i < crossingStart.size(); i++) {
+        crossingStart[i] += crossingStart[i - 1];
+    }
+    std::vector<Cut> edgeCuts(crossings.size());
+    std::vector<uint32_t> cursor(crossingStart.begin(), crossingStart.end() - 1);
+    for (const auto& crossing : crossings) {
+        edgeCuts[cursor[crossing.first]++] = crossing.second;
+    }
+
+    std::vector<Cut> cuts;
+    std::vector<uint32_t> cutStart;
+    std::vector<uint8_t> inside(outlines.polygonCount(), 0);
+    double area = 0.0;
+    for (size_t p = 0; p < outlines.polygonCount(); p++) {
+        const float* xs = outlines.xs.data() + outlines.begin(p);
+        const float* ys = outlines.ys.data() + outlines.begin(p);
+        uint32_t count = outlines.size(p);
+        if (count < 3 || !relevant[p]) {
+            continue;
+        }
+        const Bounds& box = bounds[p];
+        bool leavesCanvas = box.minX < 0.0f || box.minY < 0.0f || box.maxX > width || box.maxY > height;
+
+        cuts.clear();
+        cutStart.assign(1, 0);
+        for (uint32_t k = 0; k < count; k++) {
+            uint32_t edge = outlines.begin(p) + k;
+            cuts.insert(cuts.end(), edgeCuts.begin() + crossingStart[edge], edgeCuts.begin() + crossingStart[edge + 1]);
+            if (leavesCanvas) {
+                uint32_t next = k + 1 == count ? 0 : k + 1;
+                canvasCuts(xs[k], ys[k], xs[next], ys[next], canvasWidth, canvasHeight, cuts);
+            }
+            cutStart.push_back(static_cast<uint32_t>(cuts.size()));
+        }
+
+        if (cuts.empty()) {
+            // Nothing crosses this outline, so the region lies on the same
+            // side of all of it: one probe on the longest edge decides
+            uint32_t longest = 0;
+            float longestLength = -1.0f;
+            double shoelace = 0.0;
+            for (uint32_t k = 0; k < count; k++) {
+                uint32_t next = k + 1 == count ? 0 : k + 1;
+                float dx = xs[next] - xs[k];
+                float dy = ys[next] - ys[k];
+                if (dx * dx + dy * dy > longestLength) {
+                    longestLength = dx * dx + dy * dy;
+                    longest = k;
+                }
+                shoelace += static_cast<double>(xs[k]) * ys[next] - static_cast<double>(xs[next]) * ys[k];
+            }
+            uint32_t next = longest + 1 == count ? 0 : longest + 1;
+            area += region.edgeSide(static_cast<uint32_t>(p), xs[longest], ys[longest], xs[next], ys[next], neighbours[p]) *
+                    shoelace * 0.5;
+            continue;
+        }
+
+        if (!touching[p]) {
+            area += walkBoundaryTerm(outlines, region, static_cast<uint32_t>(p), cuts, cutStart, neighbours[p], inside);
+            continue;
+        }
+        // Outlines meeting at a vertex: probe every piece on its own
+        std::vector<double> pieceCuts;
+        for (uint32_t k = 0; k < count; k++) {
+            uint32_t next = k + 1 == count ? 0 : k + 1;
+            pieceCuts.clear();
+            for (uint32_t c = cutStart[k]; c < cutStart[k + 1]; c++) {
+                pieceCuts.push_back(cuts[c].t);
+            }
+            area += splitBoundaryTerm(region, static_cast<uint32_t>(p), xs[k], ys[k], xs[next], ys[next], pieceCuts,
+                                      neighbours[p]);
+        }
+    }
+
+    // The canvas border bounds the region wherever solid terrain runs into it
+    const double corners[5][2] = {{0.0, 0.0}, {canvasWidth, 0.0}, {canvasWidth, canvasHeight},
+                                  {0.0, canvasHeight}, {0.0, 0.0}};
+    std::vector<uint32_t> crossing;
+    std::vector<double> borderCuts;
+    for (int side = 0; side < 4; side++) {
+        double ax = corners[side][0], ay = corners[side][1];
+        double bx = corners[side + 1][0], by = corners[side + 1][1];
+        Bounds edge{static_cast<float>(std::min(ax, bx)), static_cast<float>(std::min(ay, by)),
+                    static_cast<float>(std::max(ax, bx)), static_cast<float>(std::max(ay, by))};
+        crossing.clear();
+        for (uint32_t p = 0; p < bounds.size(); p++) {
+            const Bounds& b = bounds[p];
+            if (relevant[p] && b.minX <= edge.maxX && edge.minX <= b.maxX && b.minY <= edge.maxY && edge.minY <= b.maxY) {
+                crossing.push_back(p);
+            }
+        }
+        if (crossing.empty()) {
+            continue;
+        }
+        // The border always probes each piece, touching outlines change nothing here
+        borderCuts.clear();
+        bool touches = false;
+        for (uint32_t p : crossing) {
+            const float* xs = outlines.xs.data() + outlines.begin(p);
+            const float* ys = outlines.ys.data() + outlines.begin(p);
+            uint32_t count = outlines.size(p);
+            for (uint32_t l = 0; l < count; l++) {
+                uint32_t next = l + 1 == count ? 0 : l + 1;
+                double t, u;
+                if (segmentCrossing(ax, ay, bx, by, xs[l], ys[l], xs[next], ys[next], t, u, collinear, touches) &&
+                    t > 0.0 && t < 1.0) {
+                    borderCuts.push_back(t);
+                }
+            }
+        }
+        area += splitBoundaryTerm(region, NoOwner, ax, ay, bx, by, borderCuts, crossing);
+    }
+
+    // Coincident edges leave pieces that are boundary twice or not at all
+    double canvasArea = canvasWidth * canvasHeight;
+    result.unresolved = collinear || !std::isfinite(area) || area < -0.5 || area > canvasArea + 0.5;
+    area = std::min(std::max(area, 0.0), canvasArea);
+    result.solidPixels = static_cast<uint64_t>(std::round(area));
+    result.coverage = static_cast<float>(area / canvasArea * 100.0);
+    result.milliseconds = elapsedMs(start);
+    return result;
+}
+
+uint64_t exactCoverageCost(const TerrainOutlines& outlines, unsigned int height) {
+    uint64_t rows = 0;
+    for (size_t i = 0; i < outlines.polygonCount(); i++) {
+        Bounds box = polygonBounds(outlines, i);
+        float top = std::max(0.0f, box.minY);
+        float bottom = std::min(static_cast<float>(height), box.maxY);
+        if (bottom > top) {
+            rows += static_cast<uint64_t>(bottom - top) + 1;
+        }
+    }
+    return rows;
+}
+
+uint64_t countCells(const TerrainMask& mask, uint8_t value) {
+    return static_cast<uint64_t>(std::count(mask.cells.begin(), mask.cells.end(), value));
+}
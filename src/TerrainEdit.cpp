@@ -0,0 +1,48 @@
+#include "TerrainEdit.hpp"
+#include "Noise.hpp"
+#include "TerrainOutline.hpp"
+#include <vector>
+
+void buildBrushOutline(float centerX, float centerY, float radius, float roughness, float noiseOffset,
+                       int pointCount, float* xs, float* ys) {
+    const AngleTable& table = angleTable(pointCount);
+    size_t count = table.angles.size();
+
+    thread_local std::vector<float> noiseXs, noiseYs, values;
+    noiseXs.resize(count);
+    noiseYs.resize(count);
+    values.resize(count);
+    for (size_t j = 0; j < count; j++) {
+        noiseXs[j] = table.cos[j] * 2.0f + noiseOffset;
+        noiseYs[j] = table.sin[j] * 2.0f + noiseOffset;
+    }
+    perlinNoise2DBatch(noiseXs.data(), noiseYs.data(), values.data(), count);
+
+    for (size_t j = 0; j < count; j++) {
+        float r = radius * (1.0f + values[j] * roughness * 0.5f);
+        xs[j] = centerX + r * table.cos[j];
+        ys[j] = centerY + r * table.sin[j];
+    }
+}
+
+MaskEdit paintPolygon(ScanlineRasterizer& rasterizer, TerrainMask& mask,
+                      const float* xs, const float* ys, size_t count, uint8_t value) {
+    MaskEdit edit;
+    edit.rect = DirtyRect{static_cast<int>(mask.width), static_cast<int>(mask.height), 0, 0};
+    rasterizer.fill(xs, ys, count, static_cast<int>(mask.width), static_cast<int>(mask.height),
+        [&](int y, int x0, int x1) {
+            uint8_t* row = mask.row(static_cast<unsigned int>(y));
+            for (int x = x0; x < x1; x++) {
+                edit.solidDelta += (value == TerrainMask::Solid) - (row[x] == TerrainMask::Solid);
+                row[x] = value;
+            }
+            edit.rect.x0 = std::min(edit.rect.x0, x0);
+            edit.rect.x1 = std::max(edit.rect.x1, x1);
+            edit.rect.y0 = std::min(edit.rect.y0, y);
+            edit.rect.y1 = std::max(edit.rect.y1, y + 1);
+        });
+    if (edit.rect.empty()) {
+        edit.rect = DirtyRect{};
+    }
+    return edit;
+}
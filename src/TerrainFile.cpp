@@ -0,0 +1,432 @@
+#include "TerrainFile.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr char Magic[8] = {'T', 'E', 'R', 'R', 'A', 'I', 'N', '\0'};
+constexpr uint32_t Version = 1;
+constexpr uint64_t SectionAlignment = 4096;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t sectionCount;
+    uint32_t width;
+    uint32_t height;
+    uint32_t seed;
+    uint32_t reserved;
+    uint64_t fileSize;
+};
+
+struct SectionEntry {
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t size;
+};
+
+// TerrainParams without the cave list, which has its own section
+struct ParamsRecord {
+    uint32_t width;
+    uint32_t height;
+    int32_t pointCount;
+    int32_t baseRadius;
+    float horizontalStretch;
+    float noiseFrequency;
+    float noiseAmplitude;
+    int32_t blobCount;
+    float blobSpacing;
+    uint32_t cavesEnabled;
+    float caveScale;
+    float caveNoiseFrequency;
+    float caveNoiseAmplitude;
+    int32_t caveCount;
+    int32_t cavePointCount;
+};
+
+// Appended to ParamsRecord in the same section; files written before the
+// noise settings existed end after ParamsRecord and read back as defaults
+struct NoiseRecord {
+    uint32_t noiseBasis;
+    uint32_t noiseFractal;
+    int32_t noiseOctaves;
+};
+
+static_assert(sizeof(FileHeader) == 40, "FileHeader layout");
+static_assert(sizeof(SectionEntry) == 24, "SectionEntry layout");
+static_assert(sizeof(CaveDesc) == 5 * sizeof(float), "CaveDesc is stored as five floats");
+
+uint64_t alignUp(uint64_t value) {
+    return (value + SectionAlignment - 1) / SectionAlignment * SectionAlignment;
+}
+
+// A section is written from a list of byte ranges, so large payloads go
+// straight from their containers to the file
+struct SectionWriter {
+    TerrainSection type;
+    std::vector<std::pair<const void*, size_t>> parts;
+    uint64_t size() const {
+        uint64_t total = 0;
+        for (const auto& part : parts) {
+            total += part.second;
+        }
+        return total;
+    }
+};
+
+} // namespace
+
+bool writeTerrainFile(const std::string& filename, const TerrainFileData& data, std::string* error) {
+    auto fail = [&](const std::string& message) {
+        if (error) *error = message;
+        return false;
+    };
+    if (!data.solid || data.solid->width() == 0 || data.solid->height() == 0) {
+        return fail("no solid mask to write");
+    }
+    const TerrainBitmap& solid = *data.solid;
+    if ((data.caves && (data.caves->width() != solid.width() || data.caves->height() != solid.height())) ||
+        (data.distanceField && (data.distanceField->width != solid.width() ||
+                                data.distanceField->height != solid.height()))) {
+        return fail("section sizes do not match the solid mask");
+    }
+
+    std::vector<SectionWriter> sections;
+    ParamsRecord params{};
+    NoiseRecord noise{};
+    if (data.params) {
+        const TerrainParams& p = *data.params;
+        params = ParamsRecord{p.width, p.height, p.pointCount, p.baseRadius, p.horizontalStretch,
+                              p.noiseFrequency, p.noiseAmplitude, p.blobCount, p.blobSpacing,
+                              p.cavesEnabled ? 1u : 0u, p.caveScale, p.caveNoiseFrequency,
+                              p.caveNoiseAmplitude, p.caveCount, p.cavePointCount};
+        noise = NoiseRecord{static_cast<uint32_t>(p.noiseBasis), static_cast<uint32_t>(p.noiseFractal),
+                            p.noiseOctaves};
+        sections.push_back({TerrainSection::Params, {{&params, sizeof(params)}, {&noise, sizeof(noise)}}});
+        sections.push_back({TerrainSection::Caves, {{p.caves.data(), p.caves.size() * sizeof(CaveDesc)}}});
+    }
+    size_t bitmapBytes = static_cast<size_t>(solid.height()) * solid.wordsPerRow() * sizeof(uint64_t);
+    sections.push_back({TerrainSection::SolidBits, {{solid.data(), bitmapBytes}}});
+    if (data.caves) {
+        sections.push_back({TerrainSection::CaveBits, {{data.caves->data(), bitmapBytes}}});
+    }
+    if (data.distanceField) {
+        const auto& distances = data.distanceField->distances;
+        sections.push_back({TerrainSection::DistanceField, {{distances.data(), distances.size() * sizeof(float)}}});
+    }
+
+    // Loop and point counts, offsets, hole flags padded to 4 bytes, xs, ys
+    uint32_t contourCounts[2] = {0, 0};
+    std::vector<uint8_t> holes;
+    if (data.contours) {
+        const TerrainContours& c = *data.contours;
+        contourCounts[0] = static_cast<uint32_t>(c.loopCount());
+        contourCounts[1] = static_cast<uint32_t>(c.pointCount());
+        holes = c.holes;
+        holes.resize((holes.size() + 3) / 4 * 4, 0);
+        sections.push_back({TerrainSection::Contours, {
+            {contourCounts, sizeof(contourCounts)},
+            {c.offsets.data(), c.offsets.size() * sizeof(uint32_t)},
+            {holes.data(), holes.size()},
+            {c.xs.data(), c.xs.size() * sizeof(float)},
+            {c.ys.data(), c.ys.size() * sizeof(float)}}});
+    }
+
+    std::vector<SectionEntry> table(sections.size());
+    uint64_t offset = alignUp(sizeof(FileHeader) + table.size() * sizeof(SectionEntry));
+    for (size_t i = 0; i < sections.size(); i++) {
+        table[i] = SectionEntry{static_cast<uint32_t>(sections[i].type), 0, offset, sections[i].size()};
+        offset = alignUp(offset + table[i].size);
+    }
+
+    FileHeader header{};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.sectionCount = static_cast<uint32_t>(table.size());
+    header.width = solid.width();
+    header.height = solid.height();
+    header.seed = data.seed;
+    header.fileSize = offset;
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        return fail("cannot open " + filename);
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(table.size() * sizeof(SectionEntry)));
+    static const char padding[SectionAlignment] = {};
+    uint64_t position = sizeof(header) + table.size() * sizeof(SectionEntry);
+    for (size_t i = 0; i < sections.size(); i++) {
+        file.write(padding, static_cast<std::streamsize>(table[i].offset - position));
+        for (const auto& part : sections[i].parts) {
+            file.write(static_cast<const char*>(part.first), static_cast<std::streamsize>(part.second));
+        }
+        position = table[i].offset + table[i].size;
+    }
+    // Pad the tail too, so the last section can be mapped as whole pages
+    file.write(padding, static_cast<std::streamsize>(header.fileSize - position));
+
+    if (!file) {
+        return fail("write error on " + filename);
+    }
+    return true;
+}
+
+TerrainFile::~TerrainFile() {
+    close();
+}
+
+bool TerrainFile::fail(std::string* error, const std::string& message) {
+    close();
+    if (error) *error = message;
+    return false;
+}
+
+bool TerrainFile::open(const std::string& filename, std::string* error) {
+    close();
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return fail(error, "cannot open " + filename);
+    }
+    m_file = file;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart < static_cast<LONGLONG>(sizeof(FileHeader))) {
+        return fail(error, filename + " is not a terrain file");
+    }
+    m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* view = m_mapping ? MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view) {
+        return fail(error, "cannot map " + filename);
+    }
+    m_data = static_cast<const uint8_t*>(view);
+    m_size = static_cast<size_t>(size.QuadPart);
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return fail(error, "cannot open " + filename);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(FileHeader))) {
+        ::close(fd);
+        return fail(error, filename + " is not a terrain file");
+    }
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // The mapping keeps the file alive
+    if (view == MAP_FAILED) {
+        return fail(error, "cannot map " + filename);
+    }
+    m_data = static_cast<const uint8_t*>(view);
+    m_size = static_cast<size_t>(info.st_size);
+#endif
+
+    FileHeader header;
+    std::memcpy(&header, m_data, sizeof(header));
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0) {
+        return fail(error, filename + " is not a terrain file");
+    }
+    if (header.version != Version) {
+        return fail(error, filename + " has unsupported version " + std::to_string(header.version));
+    }
+    if (header.fileSize > m_size ||
+        sizeof(FileHeader) + static_cast<uint64_t>(header.sectionCount) * sizeof(SectionEntry) > m_size) {
+        return fail(error, filename + " is truncated");
+    }
+    m_width = header.width;
+    m_height = header.height;
+    m_seed = header.seed;
+    m_wordsPerRow = (static_cast<size_t>(m_width) + 63) / 64;
+
+    uint64_t pixels = static_cast<uint64_t>(m_width) * m_height;
+    uint64_t bitmapBytes = static_cast<uint64_t>(m_height) * m_wordsPerRow * sizeof(uint64_t);
+    for (uint32_t i = 0; i < header.sectionCount; i++) {
+        SectionEntry entry;
+        std::memcpy(&entry, m_data + sizeof(FileHeader) + i * sizeof(SectionEntry), sizeof(entry));
+        if (entry.offset % SectionAlignment != 0 || entry.offset > m_size || entry.size > m_size - entry.offset) {
+            return fail(error, filename + " has a corrupt section table");
+        }
+        const uint8_t* section = m_data + entry.offset;
+        bool valid = true;
+        switch (static_cast<TerrainSection>(entry.type)) {
+        case TerrainSection::Params:
+            valid = entry.size >= sizeof(ParamsRecord);
+            m_params = section;
+            m_paramsSize = static_cast<size_t>(entry.size);
+            break;
+        case TerrainSection::Caves:
+            m_caves = reinterpret_cast<const CaveDesc*>(section);
+            m_caveCount = static_cast<size_t>(entry.size / sizeof(CaveDesc));
+            break;
+        case TerrainSection::SolidBits:
+            valid = entry.size >= bitmapBytes;
+            m_solid = reinterpret_cast<const uint64_t*>(section);
+            break;
+        case TerrainSection::CaveBits:
+            valid = entry.size >= bitmapBytes;
+            m_caveBits = reinterpret_cast<const uint64_t*>(section);
+            break;
+        case TerrainSection::DistanceField:
+            valid = entry.size >= pixels * sizeof(float);
+            m_distances = reinterpret_cast<const float*>(section);
+            break;
+        case TerrainSection::Contours: {
+            uint32_t counts[2];
+            valid = entry.size >= sizeof(counts);
+            if (!valid) break;
+            std::memcpy(counts, section, sizeof(counts));
+            uint64_t offsetsBytes = (static_cast<uint64_t>(counts[0]) + 1) * sizeof(uint32_t);
+            uint64_t holesBytes = (static_cast<uint64_t>(counts[0]) + 3) / 4 * 4;
+            uint64_t pointsBytes = static_cast<uint64_t>(counts[1]) * sizeof(float);
+            valid = entry.size >= sizeof(counts) + offsetsBytes + holesBytes + 2 * pointsBytes;
+            if (!valid) break;
+            // Readers index points through the offsets, so they must partition [0, pointCount)
+            const uint32_t* offsets = reinterpret_cast<const uint32_t*>(section + sizeof(counts));
+            bool ordered = offsets[0] == 0 && offsets[counts[0]] == counts[1];
+            for (uint32_t loop = 0; loop < counts[0] && ordered; loop++) {
+                ordered = offsets[loop] <= offsets[loop + 1];
+            }
+            if (!ordered) {
+                return fail(error, filename + " has corrupt contour offsets");
+            }
+            m_contours.loopCount = counts[0];
+            m_contours.pointCount = counts[1];
+            m_contours.offsets = offsets;
+            m_contours.holes = section + sizeof(counts) + offsetsBytes;
+            m_contours.xs = reinterpret_cast<const float*>(section + sizeof(counts) + offsetsBytes + holesBytes);
+            m_contours.ys = m_contours.xs + counts[1];
+            break;
+        }
+        default:
+            break;  // Newer section, not for us
+        }
+        if (!valid) {
+            return fail(error, filename + " has a truncated section");
+        }
+    }
+    if (!m_solid) {
+        return fail(error, filename + " has no solid mask");
+    }
+    return true;
+}
+
+void TerrainFile::close() {
+    if (m_data) {
+#if defined(_WIN32)
+        UnmapViewOfFile(m_data);
+#else
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+    }
+#if defined(_WIN32)
+    if (m_mapping) CloseHandle(m_mapping);
+    if (m_file) CloseHandle(m_file);
+    m_mapping = nullptr;
+    m_file = nullptr;
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_width = 0;
+    m_height = 0;
+    m_seed = 0;
+    m_wordsPerRow = 0;
+    m_params = nullptr;
+    m_paramsSize = 0;
+    m_caves = nullptr;
+    m_caveCount = 0;
+    m_solid = nullptr;
+    m_caveBits = nullptr;
+    m_distances = nullptr;
+    m_contours = ContoursView{};
+}
+
+TerrainParams TerrainFile::params() const {
+    if (!m_params) {
+        return defaultTerrainParams(m_width, m_height);
+    }
+    ParamsRecord record;
+    std::memcpy(&record, m_params, sizeof(record));
+    TerrainParams params;
+    params.width = record.width;
+    params.height = record.height;
+    params.pointCount = record.pointCount;
+    params.baseRadius = record.baseRadius;
+    params.horizontalStretch = record.horizontalStretch;
+    params.noiseFrequency = record.noiseFrequency;
+    params.noiseAmplitude = record.noiseAmplitude;
+    params.blobCount = record.blobCount;
+    params.blobSpacing = record.blobSpacing;
+    params.cavesEnabled = record.cavesEnabled != 0;
+    params.caveScale = record.caveScale;
+    params.caveNoiseFrequency = record.caveNoiseFrequency;
+    params.caveNoiseAmplitude = record.caveNoiseAmplitude;
+    params.caveCount = record.caveCount;
+    params.cavePointCount = record.cavePointCount;
+    if (m_paramsSize >= sizeof(ParamsRecord) + sizeof(NoiseRecord)) {
+        NoiseRecord noise;
+        std::memcpy(&noise, m_params + sizeof(ParamsRecord), sizeof(noise));
+        if (noise.noiseBasis <= static_cast<uint32_t>(NoiseBasis::Value)) {
+            params.noiseBasis = static_cast<NoiseBasis>(noise.noiseBasis);
+        }
+        if (noise.noiseFractal <= static_cast<uint32_t>(NoiseFractal::Ridged)) {
+            params.noiseFractal = static_cast<NoiseFractal>(noise.noiseFractal);
+        }
+        params.noiseOctaves = noise.noiseOctaves;
+    }
+    params.seed = m_seed;
+    params.caves.assign(m_caves, m_caves + m_caveCount);
+    return params;
+}
+
+uint64_t TerrainFile::countSolid() const {
+    // Row padding is always zero, whole words can be counted
+    uint64_t total = 0;
+    size_t words = static_cast<size_t>(m_height) * m_wordsPerRow;
+    for (size_t i = 0; i < words; i++) {
+        total += popcount64(m_solid[i]);
+    }
+    return total;
+}
+
+uint8_t TerrainFile::cell(unsigned int x, unsigned int y) const {
+    if (isSolid(x, y)) {
+        return TerrainMask::Solid;
+    }
+    if (m_caveBits && ((m_caveBits[y * m_wordsPerRow + (x >> 6)] >> (x & 63)) & 1)) {
+        return TerrainMask::Cave;
+    }
+    return TerrainMask::Empty;
+}
+
+TerrainBitmap TerrainFile::solidBitmap() const {
+    TerrainBitmap bitmap(m_width, m_height);
+    std::memcpy(bitmap.data(), m_solid, static_cast<size_t>(m_height) * m_wordsPerRow * sizeof(uint64_t));
+    return bitmap;
+}
+
+TerrainMask TerrainFile::mask() const {
+    TerrainMask mask;
+    mask.resize(m_width, m_height);
+    for (unsigned int y = 0; y < m_height; y++) {
+        uint8_t* row = mask.row(y);
+        for (unsigned int x = 0; x < m_width; x++) {
+            row[x] = cell(x, y);
+        }
+    }
+    return mask;
+}
@@ -1,15 +1,58 @@
 #include "../include/TerrainGenerator.hpp"
+#include "Noise.hpp"
+#include "Profiler.hpp"
+#include "TerrainCoverage.hpp"
+#include <chrono>
 #include <cmath>
 #include <algorithm>
 #include <random>
 
+namespace {
+
+TerrainGenerator::Cave toCave(const CaveDesc& desc) {
+    TerrainGenerator::Cave cave;
+    cave.position = sf::Vector2f(desc.x, desc.y);
+    cave.rotation = desc.rotation;
+    cave.scaleVariant = desc.scaleVariant;
+    cave.noiseOffset = desc.noiseOffset;
+    return cave;
+}
+
+MaskColors exportColors(const TerrainGenerator::ExportSettings& settings) {
+    const PngWriter::PaletteEntry transparent{0, 0, 0, 0};
+    const PngWriter::PaletteEntry white{255, 255, 255, 255};
+
+    MaskColors colors;
+    colors.solid = PngWriter::PaletteEntry{0, 0, 0, 255};
+    colors.empty = settings.transparentBackground ? transparent : white;
+    colors.cave = settings.transparentCaves ? transparent : white;
+    return colors;
+}
+
+// Same colors the GPU path renders: transparent air, black terrain, white caves
+MaskColors displayColors() {
+    MaskColors colors;
+    colors.empty = PngWriter::PaletteEntry{0, 0, 0, 0};
+    return colors;
+}
+
+} // namespace
+
 TerrainGenerator::TerrainGenerator(unsigned int w, unsigned int h) 
     : m_width(w)
     , m_height(h)
     , m_terrainTexture(sf::Vector2u{w, h})  // Direct construction
+    , m_maskTexture(sf::Vector2u{w, h})
 {
     m_baseRadius = std::min(m_width, m_height) / 3;
+    m_seed = std::random_device{}();
+    m_rng.seed(m_seed);
     m_terrainTexture.clear(sf::Color::Transparent);  // Use . instead of ->
+    m_mask.resize(w, h);
+    m_pixels.resize(static_cast<size_t>(w) * h * 4);
+    m_maskTexture.update(m_pixels.data());  // Transparent until the first generation lands
+    m_worker = std::make_unique<GenerationWorker>(m_cache);
+    setProgressiveSettings(m_progressive);
     m_blobCount = 1;  // Initialize blob count
     m_caveCount = 0;  // Initialize cave count
     regenerateCavePositions();
@@ -18,6 +61,7 @@ TerrainGenerator::TerrainGenerator(unsigned int w, unsigned int h)
 void TerrainGenerator::setPointCount(int count) {
     if (m_pointCount != count) {
         m_pointCount = count;
+        relayoutSpacedCaves(true);
         notifyUpdate();
     }
 }
@@ -25,6 +69,7 @@ void TerrainGenerator::setPointCount(int count) {
 void TerrainGenerator::setBaseRadius(int radius) {
     if (m_baseRadius != radius) {
         m_baseRadius = radius;
+        relayoutSpacedCaves(false);
         notifyUpdate();
     }
 }
@@ -32,6 +77,7 @@ void TerrainGenerator::setBaseRadius(int radius) {
 void TerrainGenerator::setHorizontalStretch(float stretch) {
     if (m_horizontalStretch != stretch) {
         m_horizontalStretch = stretch;
+        relayoutSpacedCaves(true);
         notifyUpdate();
     }
 }
@@ -39,6 +85,7 @@ void TerrainGenerator::setHorizontalStretch(float stretch) {
 void TerrainGenerator::setNoiseFrequency(float freq) {
     if (m_noiseFrequency != freq) {
         m_noiseFrequency = freq;
+        relayoutSpacedCaves(true);
         notifyUpdate();
     }
 }
@@ -46,6 +93,32 @@ void TerrainGenerator::setNoiseFrequency(float freq) {
 void TerrainGenerator::setNoiseAmplitude(float amp) {
     if (m_noiseAmplitude != amp) {
         m_noiseAmplitude = amp;
+        relayoutSpacedCaves(true);
+        notifyUpdate();
+    }
+}
+
+void TerrainGenerator::setNoiseBasis(NoiseBasis basis) {
+    if (m_noiseBasis != basis) {
+        m_noiseBasis = basis;
+        relayoutSpacedCaves(true);
+        notifyUpdate();
+    }
+}
+
+void TerrainGenerator::setNoiseFractal(NoiseFractal fractal) {
+    if (m_noiseFractal != fractal) {
+        m_noiseFractal = fractal;
+        relayoutSpacedCaves(true);
+        notifyUpdate();
+    }
+}
+
+void TerrainGenerator::setNoiseOctaves(int octaves) {
+    octaves = std::clamp(octaves, 1, MaxNoiseOctaves);
+    if (m_noiseOctaves != octaves) {
+        m_noiseOctaves = octaves;
+        relayoutSpacedCaves(true);
         notifyUpdate();
     }
 }
@@ -54,6 +127,7 @@ void TerrainGenerator::setBlobCount(int count) {
     if (m_blobCount != count) {
         m_blobCount = count;
         regenerateCavePositions();
+        relayoutSpacedCaves(true);
         notifyUpdate();
     }
 }
@@ -61,6 +135,7 @@ void TerrainGenerator::setBlobCount(int count) {
 void TerrainGenerator::setBlobSpacing(float spacing) {
     if (m_blobSpacing != spacing) {
         m_blobSpacing = spacing;
+        relayoutSpacedCaves(true);
         notifyUpdate();
     }
 }
@@ -80,6 +155,7 @@ void TerrainGenerator::setCavesEnabled(bool enabled) {
 void TerrainGenerator::setCaveScale(float scale) {
     if (m_caveScale != scale) {
         m_caveScale = scale;
+        relayoutSpacedCaves(false);
         notifyUpdate();
     }
 }
@@ -104,35 +180,22 @@ void TerrainGenerator::setCaveCount(int count) {
         m_caveCount = count;
 
         // If increasing count, only generate new caves
-        if (count > oldCount) {
+        if (count > oldCount && m_cavePlacement == CavePlacement::PoissonDisc) {
+            // The layout for more caves starts with the one for fewer, append the rest
+            TerrainParams params = getShapeParams();
+            placeCaves(params, m_seed);
+            for (size_t i = m_caves.size(); i < params.caves.size(); i++) {
+                m_caves.add(params.caves[i]);
+            }
+        } else if (count > oldCount) {
             // Generate only the new caves while preserving existing ones
             for (int i = oldCount; i < count; i++) {
-                Cave cave;
-                int minX = static_cast<int>(m_width * 0.2f);
-                int maxX = static_cast<int>(m_width * 0.8f);
-                int minY = static_cast<int>(m_height * 0.3f);
-                int maxY = static_cast<int>(m_height * 0.7f);
-                
-                std::uniform_int_distribution<int> xDist(minX, maxX);
-                std::uniform_int_distribution<int> yDist(minY, maxY);
-                std::uniform_real_distribution<float> angleDist(0.0f, 2.0f * static_cast<float>(M_PI));
-                std::uniform_real_distribution<float> scaleDist(0.8f, 1.2f);
-                std::uniform_real_distribution<float> noiseDist(0.0f, 10.0f);
-                
-                cave.position = sf::Vector2f(xDist(m_rng), yDist(m_rng));
-                cave.rotation = angleDist(m_rng);
-                cave.scaleVariant = scaleDist(m_rng);
-                cave.noiseOffset = noiseDist(m_rng);
-                
-                m_caves.push_back(cave);
+                m_caves.add(seededCave(m_seed, i, m_width, m_height));
             }
         } else {
-            // If reducing count, just remove caves from the end
-            m_caves.resize(count);
-        }
-
-        if (m_selectedCaveIndex >= m_caves.size()) {
-            m_selectedCaveIndex = m_caves.empty() ? -1 : m_caves.size() - 1;
+            // If reducing count, just remove caves from the end. Poisson-disc
+            // layouts may have stopped short of the old count already.
+            m_caves.truncate(static_cast<size_t>(std::max(count, 0)));
         }
         notifyUpdate();
     }
@@ -145,324 +208,814 @@ void TerrainGenerator::setCavePointCount(int count) {
     }
 }
 
-void TerrainGenerator::setSelectedCaveIndex(int index) {
-    if (m_selectedCaveIndex != index && index >= -1 && index < m_caves.size()) {
-        m_selectedCaveIndex = index;
+void TerrainGenerator::setSeed(uint32_t seed) {
+    if (m_seed != seed) {
+        m_seed = seed;
+        m_rng.seed(seed);
+        // A new layout replaces the old one, individual cave tweaks included
+        m_caves.clear();
+        regenerateCavePositions();
+        notifyUpdate();
+    }
+}
+
+void TerrainGenerator::setCavePlacement(CavePlacement placement) {
+    if (m_cavePlacement != placement) {
+        m_cavePlacement = placement;
+        m_caves.clear();
+        regenerateCavePositions();
         notifyUpdate();
     }
 }
 
+void TerrainGenerator::setCaveSpacing(float spacing) {
+    if (m_caveSpacing != spacing) {
+        m_caveSpacing = spacing;
+        relayoutSpacedCaves(false);
+        notifyUpdate();
+    }
+}
+
+void TerrainGenerator::setCavesInsideBlobs(bool inside) {
+    if (m_cavesInsideBlobs != inside) {
+        m_cavesInsideBlobs = inside;
+        relayoutSpacedCaves(false);
+        notifyUpdate();
+    }
+}
+
+void TerrainGenerator::setParams(const TerrainParams& params) {
+    m_pointCount = params.pointCount;
+    m_baseRadius = params.baseRadius;
+    m_horizontalStretch = params.horizontalStretch;
+    m_noiseFrequency = params.noiseFrequency;
+    m_noiseAmplitude = params.noiseAmplitude;
+    m_noiseBasis = params.noiseBasis;
+    m_noiseFractal = params.noiseFractal;
+    m_noiseOctaves = std::clamp(params.noiseOctaves, 1, MaxNoiseOctaves);
+    m_blobCount = params.blobCount;
+    m_blobSpacing = params.blobSpacing;
+    m_cavesEnabled = params.cavesEnabled;
+    m_caveScale = params.caveScale;
+    m_caveNoiseFrequency = params.caveNoiseFrequency;
+    m_caveNoiseAmplitude = params.caveNoiseAmplitude;
+    m_caveCount = params.caveCount;
+    m_cavePointCount = params.cavePointCount;
+    m_cavePlacement = params.cavePlacement;
+    m_caveSpacing = params.caveSpacing;
+    m_cavesInsideBlobs = params.cavesInsideBlobs;
+    m_seed = params.seed;
+    m_rng.seed(m_seed);
+    // A different terrain, the old selection does not carry over
+    m_caves.clear();
+    m_caves.reserve(params.caves.size());
+    for (const CaveDesc& cave : params.caves) {
+        m_caves.add(cave);
+    }
+    // Parameters with caves disabled come without a list, rebuild it from the seed
+    regenerateCavePositions();
+    notifyUpdate();
+}
+
+void TerrainGenerator::setRenderBackend(RenderBackend backend) {
+    if (m_backend != backend) {
+        m_backend = backend;
+        notifyUpdate();
+    }
+}
+
+void TerrainGenerator::setBackgroundGeneration(bool enabled) {
+    if (enabled == (m_worker != nullptr)) {
+        return;
+    }
+    // Destroying the worker joins it, which waits out a generation in flight
+    m_worker = enabled ? std::make_unique<GenerationWorker>(m_cache) : nullptr;
+    m_requestedGeneration = 0;
+}
+
+void TerrainGenerator::setCache(std::shared_ptr<TerrainCache> cache) {
+    m_cache = std::move(cache);
+    if (m_worker) {
+        m_worker = std::make_unique<GenerationWorker>(m_cache);
+        m_requestedGeneration = 0;
+    }
+}
+
+TerrainGenerator::BackgroundStats TerrainGenerator::getBackgroundStats() const {
+    BackgroundStats stats;
+    if (m_worker) {
+        stats.enabled = true;
+        stats.busy = m_worker->isBusy();
+        stats.requests = m_worker->requestCount();
+        stats.skipped = m_worker->skippedCount();
+        stats.milliseconds = m_workerResult.milliseconds;
+    }
+    return stats;
+}
+
+void TerrainGenerator::setSelectedCaveIndex(int index) {
+    if (index >= -1 && index < static_cast<int>(m_caves.size())) {
+        setSelectedCave(index >= 0 ? m_caves.handle(static_cast<size_t>(index)) : CaveHandle{});
+    }
+}
+
+void TerrainGenerator::setSelectedCave(CaveHandle cave) {
+    // Not a parameter: the terrain and any edits on it stay as they are
+    m_selectedCave = cave;
+}
+
 TerrainGenerator::Cave TerrainGenerator::getSelectedCaveProperties() const {
-    if (m_selectedCaveIndex >= 0 && m_selectedCaveIndex < m_caves.size()) {
-        return m_caves[m_selectedCaveIndex];
+    int index = m_caves.index(m_selectedCave);
+    if (index >= 0) {
+        return toCave(m_caves.get(static_cast<size_t>(index)));
     }
     return Cave(); // Return default cave if none selected
 }
 
 void TerrainGenerator::updateSelectedCave(float scale, float rotation, float noiseOffset) {
-    if (m_selectedCaveIndex >= 0 && m_selectedCaveIndex < m_caves.size()) {
-        Cave& cave = m_caves[m_selectedCaveIndex];
+    int index = m_caves.index(m_selectedCave);
+    if (index >= 0) {
+        CaveDesc cave = m_caves.get(static_cast<size_t>(index));
         cave.scaleVariant = scale;
         cave.rotation = rotation;
         cave.noiseOffset = noiseOffset;
+        m_caves.set(static_cast<size_t>(index), cave);
         notifyUpdate();
     }
 }
 
-sf::RenderTexture& TerrainGenerator::generateTerrain() {
+void TerrainGenerator::removeSelectedCave() {
+    if (m_caves.remove(m_selectedCave)) {
+        m_selectedCave = CaveHandle{};
+        notifyUpdate();
+    }
+}
+
+TerrainParams TerrainGenerator::getParams() const {
+    TerrainParams params = getShapeParams();
+    m_caves.copyTo(params.caves);
+    return params;
+}
+
+TerrainParams TerrainGenerator::getShapeParams() const {
+    TerrainParams params;
+    params.width = m_width;
+    params.height = m_height;
+    params.pointCount = m_pointCount;
+    params.baseRadius = m_baseRadius;
+    params.horizontalStretch = m_horizontalStretch;
+    params.noiseFrequency = m_noiseFrequency;
+    params.noiseAmplitude = m_noiseAmplitude;
+    params.noiseBasis = m_noiseBasis;
+    params.noiseFractal = m_noiseFractal;
+    params.noiseOctaves = m_noiseOctaves;
+    params.blobCount = m_blobCount;
+    params.blobSpacing = m_blobSpacing;
+    params.cavesEnabled = m_cavesEnabled;
+    params.caveScale = m_caveScale;
+    params.caveNoiseFrequency = m_caveNoiseFrequency;
+    params.caveNoiseAmplitude = m_caveNoiseAmplitude;
+    params.caveCount = m_caveCount;
+    params.cavePointCount = m_cavePointCount;
+    params.seed = m_seed;
+    params.cavePlacement = m_cavePlacement;
+    params.caveSpacing = m_caveSpacing;
+    params.cavesInsideBlobs = m_cavesInsideBlobs;
+    return params;
+}
+
+const sf::Texture& TerrainGenerator::generateTerrain() {
+    PROFILE_ZONE("TerrainGenerator::generateTerrain");
+    const sf::Texture& texture = m_backend == RenderBackend::Cpu
+        ? m_maskTexture : m_terrainTexture.getTexture();
+    if (m_renderedGeneration == m_generation) {
+        flushEdits();
+        return texture;  // Nothing changed since the last render
+    }
+
+    if (m_backend == RenderBackend::Cpu) {
+        unsigned int stage = nextStage();
+        if (m_worker) {
+            // Each generation and stage is requested once; slider drags that
+            // outpace the worker are coalesced there, not here
+            if (m_requestedGeneration != m_generation || m_requestedStage != stage) {
+                // Only full-quality results are worth caching
+                m_worker->request(m_generation, stageParams(stage), stage, stage + 1 == m_stageStats.size());
+                m_requestedGeneration = m_generation;
+                m_requestedStage = stage;
+            }
+            if (m_worker->takeResult(m_workerResult)) {
+                adoptResult(m_workerResult);
+            }
+        } else {
+            // Previews would evict the full-quality cave outlines, they are cheap to build anyway
+            bool full = stage + 1 == m_stageStats.size();
+            buildGeneration(stageParams(stage), m_cache.get(), full, m_workerResult, full ? &m_caveOutlines : nullptr);
+            m_workerResult.generation = m_generation;
+            m_workerResult.stage = stage;
+            adoptResult(m_workerResult);
+        }
+        // Until the current generation lands, the newest finished one stays on screen
+        flushEdits();
+        return m_previewGeneration > m_renderedGeneration ? m_previewTexture : texture;
+    }
+
+    // Regenerating from parameters starts from a clean slate
+    m_dirtyRects.clear();
+    m_editCount = 0;
+
+    // The caves are read from the store, not copied out into params.caves
+    TerrainParams params = getShapeParams();
+    {
+        PROFILE_ZONE("buildTerrainOutlines");
+        buildTerrainOutlines(params, m_caves, m_outlines, m_caveOutlines);
+    }
+    m_renderedKey = terrainParamsHash(params, m_caves);
+    m_counters = RenderCounters{};
+    m_counters.generation = m_generation;
+    m_counters.polygons = m_outlines.polygonCount();
+    m_counters.outlinePoints = m_outlines.pointCount();
+    m_counters.tessellatedCaves = m_caveOutlines.rebuiltCount();
+
     m_terrainTexture.clear(sf::Color::Transparent);  // Use . instead of ->
     drawMultiBlob(m_terrainTexture);  // Pass direct reference
     m_terrainTexture.display();
-    return m_terrainTexture;
+    m_renderedGeneration = m_generation;
+    return texture;
 }
 
-void TerrainGenerator::drawBlob(sf::RenderTexture& target) {
-    sf::ConvexShape blob;
-    blob.setPointCount(m_pointCount);
-    blob.setFillColor(sf::Color::Black);
-    blob.setOutlineThickness(0);
+void TerrainGenerator::setProgressiveSettings(const ProgressiveSettings& settings) {
+    m_progressive = settings;
+    m_stageStats.clear();
+    if (settings.enabled) {
+        for (float scale = std::max(settings.previewScale, 1.0f / 16.0f); scale < 1.0f; scale *= 2.0f) {
+            StageStats stage;
+            stage.scale = scale;
+            m_stageStats.push_back(stage);
+        }
+    }
+    m_stageStats.push_back(StageStats{});  // Full quality
+    m_requestedGeneration = 0;  // Request again with the new stages
+}
 
-    float centerX = m_width / 2.0f;
-    float centerY = m_height / 2.0f;
+float TerrainGenerator::getDisplayScale() const {
+    if (m_previewGeneration > m_renderedGeneration && m_previewTexture.getSize().x > 0) {
+        return static_cast<float>(m_width) / static_cast<float>(m_previewTexture.getSize().x);
+    }
+    return 1.0f;
+}
 
-    for (int i = 0; i < m_pointCount; i++) {
-        float angle = (2 * M_PI * i) / m_pointCount;
-        float noiseX = std::cos(angle) * m_noiseFrequency;
-        float noiseY = std::sin(angle) * m_noiseFrequency;
-        float variation = noise2D(noiseX, noiseY) * m_noiseAmplitude * m_baseRadius * 0.5f;
-        
-        float radius = m_baseRadius + variation;
-        float x = centerX + (radius * std::cos(angle) * m_horizontalStretch);
-        float y = centerY + radius * std::sin(angle);
-        blob.setPoint(i, sf::Vector2f(x, y));
+unsigned int TerrainGenerator::nextStage() const {
+    unsigned int full = static_cast<unsigned int>(m_stageStats.size() - 1);
+    float idleSeconds = m_progressive.idleSeconds;
+    auto now = std::chrono::steady_clock::now();
+    // A lone change, a click rather than a drag, goes straight to full quality
+    if (std::chrono::duration<float>(m_lastChange - m_previousChange).count() >= idleSeconds) {
+        return full;
     }
+    if (std::chrono::duration<float>(now - m_lastChange).count() < idleSeconds) {
+        return 0;
+    }
+    // Input settled: one stage past the newest preview of this generation
+    if (m_previewGeneration != m_generation) {
+        return 0;
+    }
+    return std::min(m_previewStage + 1, full);
+}
 
-    target.draw(blob);
+TerrainParams TerrainGenerator::stageParams(unsigned int stage) const {
+    if (stage + 1 >= m_stageStats.size()) {
+        return getParams();
+    }
+    return previewTerrainParams(getParams(), m_stageStats[stage].scale);
 }
 
-void TerrainGenerator::drawMultiBlob(sf::RenderTexture& target) {
-    // Calculate total width needed for all blobs
-    float totalWidth = (m_blobCount - 1) * m_baseRadius * m_blobSpacing;
-    float startX = (m_width - totalWidth) / 2.0f;
-    
-    // Draw main surface blobs - always draw at least one blob
-    for (int i = 0; i < std::max(1, m_blobCount); i++) {
-        float xPos = startX + (i * m_baseRadius * m_blobSpacing);
-        sf::Vector2f center(xPos, m_height/2.0f);
-        
-        sf::ConvexShape blob;
-        blob.setPointCount(m_pointCount);
-        blob.setFillColor(sf::Color::Black);
-        blob.setOutlineThickness(0);
-        
-        for (int j = 0; j < m_pointCount; j++) {
-            float angle = (2 * M_PI * j) / m_pointCount;
-            float noiseX = (std::cos(angle) + i) * m_noiseFrequency;
-            float noiseY = std::sin(angle) * m_noiseFrequency;
-            float variation = noise2D(noiseX, noiseY) * m_noiseAmplitude * m_baseRadius * 0.5f;
-            
-            float radius = m_baseRadius + variation;
-            float x = center.x + (radius * std::cos(angle) * m_horizontalStretch);
-            float y = center.y + radius * std::sin(angle);
-            blob.setPoint(j, sf::Vector2f(x, y));
+void TerrainGenerator::adoptResult(GenerationResult& result) {
+    // Results from before a switch to the GPU backend and back are stale
+    if (result.generation <= m_renderedGeneration) {
+        return;
+    }
+    PROFILE_ZONE("TerrainGenerator::adoptResult");
+    auto start = std::chrono::steady_clock::now();
+    if (result.mask.width == m_width && result.mask.height == m_height) {
+        // Swapped rather than copied, the worker gets the old buffers back to reuse
+        m_dirtyRects.clear();
+        m_editCount = 0;
+        std::swap(m_outlines, result.outlines);
+        std::swap(m_mask, result.mask);
+
+        m_counters = RenderCounters{};
+        m_counters.generation = result.generation;
+        m_counters.polygons = m_outlines.polygonCount();
+        m_counters.outlinePoints = m_outlines.pointCount();
+        m_counters.tessellatedCaves = result.tessellatedCaves;
+
+        m_maskGeneration = result.generation;
+        m_renderedGeneration = result.generation;
+        m_renderedKey = result.key;
+        uploadMask();
+    } else {
+        showPreview(result);
+    }
+
+    // Stages are matched by index; the settings may have changed since the request
+    if (result.stage < m_stageStats.size()) {
+        StageStats& stats = m_stageStats[result.stage];
+        stats.generation = result.generation;
+        stats.buildMilliseconds = result.milliseconds;
+        stats.fromCache = result.fromCache;
+        stats.uploadMilliseconds = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+void TerrainGenerator::showPreview(const GenerationResult& result) {
+    const TerrainMask& mask = result.mask;
+    if (m_previewTexture.getSize() != sf::Vector2u{mask.width, mask.height}) {
+        if (!m_previewTexture.resize(sf::Vector2u{mask.width, mask.height})) {
+            return;
         }
-        
-        target.draw(blob);
+        m_previewTexture.setSmooth(true);  // Upscaled on screen
     }
-    
-    // Draw caves as white shapes on top
-    if (m_cavesEnabled && !m_caves.empty()) {
-        for (const Cave& cave : m_caves) {
-            sf::ConvexShape caveBlob;
-            caveBlob.setPointCount(m_cavePointCount);
-            caveBlob.setFillColor(sf::Color::White);  // Simple white fill
-            caveBlob.setOutlineThickness(0);
-            
-            float caveRadius = m_baseRadius * m_caveScale * cave.scaleVariant;
-            
-            for (int j = 0; j < m_cavePointCount; j++) {
-                float angle = (2 * M_PI * j) / m_cavePointCount + cave.rotation;
-                float noiseX = std::cos(angle) * m_caveNoiseFrequency + cave.noiseOffset;
-                float noiseY = std::sin(angle) * m_caveNoiseFrequency + cave.noiseOffset;
-                float variation = noise2D(noiseX, noiseY) * m_caveNoiseAmplitude * caveRadius * 0.5f;
-                
-                float radius = caveRadius + variation;
-                float x = cave.position.x + radius * std::cos(angle);
-                float y = cave.position.y + radius * std::sin(angle);
-                caveBlob.setPoint(j, sf::Vector2f(x, y));
+    // Smaller than the terrain, so it fits the front of the staging buffer
+    MaskColors colors = displayColors();
+    for (unsigned int y = 0; y < mask.height; y++) {
+        recolorMaskRow(mask.row(y), m_pixels.data() + static_cast<size_t>(y) * mask.width * 4, mask.width, colors);
+    }
+    m_previewTexture.update(m_pixels.data());
+    m_previewGeneration = result.generation;
+    m_previewStage = result.stage;
+}
+
+void TerrainGenerator::uploadMask() {
+    PROFILE_ZONE("TerrainGenerator::uploadMask");
+    MaskColors colors = displayColors();
+    for (unsigned int y = 0; y < m_height; y++) {
+        recolorMaskRow(m_mask.row(y), m_pixels.data() + static_cast<size_t>(y) * m_width * 4, m_width, colors);
+    }
+    m_maskTexture.update(m_pixels.data());
+}
+
+void TerrainGenerator::carve(sf::Vector2f center, float radius, float roughness) {
+    applyEdit(center, radius, roughness, TerrainMask::Empty);
+}
+
+void TerrainGenerator::fill(sf::Vector2f center, float radius, float roughness) {
+    applyEdit(center, radius, roughness, TerrainMask::Solid);
+}
+
+void TerrainGenerator::applyEdit(sf::Vector2f center, float radius, float roughness, uint8_t value) {
+    PROFILE_ZONE("TerrainGenerator::applyEdit");
+    if (isDirty()) {
+        generateTerrain();  // Edits apply to what is on screen, pick up pending changes first
+    }
+    getMask();  // GPU backend: read back once, later edits keep the mask current
+    if (m_editCount == 0) {
+        m_editedSolidPixels = static_cast<int64_t>(countCells(m_mask, TerrainMask::Solid));
+    }
+
+    // Enough points for a smooth edge at any size
+    int pointCount = std::max(12, std::min(128, static_cast<int>(radius * 0.75f)));
+    m_editXs.resize(pointCount);
+    m_editYs.resize(pointCount);
+    buildBrushOutline(center.x, center.y, radius, roughness, m_editCount * 1.37f, pointCount,
+                      m_editXs.data(), m_editYs.data());
+
+    MaskEdit edit = paintPolygon(m_editRasterizer, m_mask, m_editXs.data(), m_editYs.data(),
+                                 m_editXs.size(), value);
+    m_editCount++;
+    m_editedSolidPixels += edit.solidDelta;
+    if (edit.rect.empty()) {
+        return;
+    }
+    const DirtyRect& r = edit.rect;
+
+    // Derived structures that are current get patched, the rest rebuild lazily
+    if (m_bitmapGeneration == m_renderedGeneration) {
+        m_bitmap.updateFromMask(m_mask, TerrainMask::Solid, r.x0, r.y0, r.x1, r.y1);
+        if (m_collisionGeneration == m_renderedGeneration) {
+            m_collision.update(m_bitmap, r.x0, r.y0, r.x1, r.y1);
+        }
+    }
+    if (m_spansGeneration == m_renderedGeneration) {
+        m_spans.paintPolygon(m_editRasterizer, m_editXs.data(), m_editYs.data(), m_editXs.size(),
+                             value == TerrainMask::Solid);
+    }
+    m_distanceFieldGeneration = 0;
+    // Contours re-trace only the tiles under the edited rows on the next read
+    if (m_contoursGeneration == m_renderedGeneration) {
+        m_contoursDirty.merge(r);
+    }
+    m_cachedData.generation = 0;
+
+    if (m_backend == RenderBackend::Gpu) {
+        // Same polygon straight into the render texture, nothing to upload
+        if (value == TerrainMask::Empty) {
+            subtractBlob(m_terrainTexture, m_editXs.data(), m_editYs.data(), m_editXs.size());
+        } else {
+            addBlob(m_terrainTexture, m_editXs.data(), m_editYs.data(), m_editXs.size());
+        }
+    }
+
+    // Overlapping rects are merged so a burst of carves in one spot uploads once
+    DirtyRect merged = r;
+    for (size_t i = 0; i < m_dirtyRects.size();) {
+        if (m_dirtyRects[i].overlaps(merged)) {
+            merged.merge(m_dirtyRects[i]);
+            m_dirtyRects[i] = m_dirtyRects.back();
+            m_dirtyRects.pop_back();
+            i = 0;
+        } else {
+            i++;
+        }
+    }
+    m_dirtyRects.push_back(merged);
+}
+
+void TerrainGenerator::flushEdits() {
+    if (m_dirtyRects.empty()) {
+        return;
+    }
+    PROFILE_ZONE("TerrainGenerator::flushEdits");
+    if (m_backend == RenderBackend::Gpu) {
+        m_terrainTexture.display();
+        m_dirtyRects.clear();
+        return;
+    }
+
+    MaskColors colors = displayColors();
+    for (const DirtyRect& r : m_dirtyRects) {
+        size_t width = static_cast<size_t>(r.width());
+        for (int y = r.y0; y < r.y1; y++) {
+            recolorMaskRow(m_mask.row(y) + r.x0, m_pixels.data() + (y - r.y0) * width * 4,
+                           static_cast<unsigned int>(width), colors);
+        }
+        m_maskTexture.update(m_pixels.data(),
+                             sf::Vector2u{static_cast<unsigned int>(r.width()), static_cast<unsigned int>(r.height())},
+                             sf::Vector2u{static_cast<unsigned int>(r.x0), static_cast<unsigned int>(r.y0)});
+    }
+    m_dirtyRects.clear();
+}
+
+const TerrainMask& TerrainGenerator::getMask() const {
+    if (m_maskGeneration == m_renderedGeneration) {
+        return m_mask;
+    }
+
+    // GPU backend: classify the rendered pixels back into mask cells
+    PROFILE_ZONE("TerrainGenerator::readBackMask");
+    sf::Image image = m_terrainTexture.getTexture().copyToImage();
+    for (unsigned int y = 0; y < m_height; y++) {
+        uint8_t* row = m_mask.row(y);
+        for (unsigned int x = 0; x < m_width; x++) {
+            sf::Color pixel = image.getPixel(sf::Vector2u{x, y});
+            if (pixel == sf::Color::Black) {
+                row[x] = TerrainMask::Solid;
+            } else if (pixel == sf::Color::White) {
+                row[x] = TerrainMask::Cave;
+            } else {
+                row[x] = TerrainMask::Empty;
             }
-            
-            target.draw(caveBlob); // Simple draw without blend modes
         }
     }
+    m_maskGeneration = m_renderedGeneration;
+    return m_mask;
 }
 
-void TerrainGenerator::subtractBlob(sf::RenderTexture& target, const sf::Vector2f& center) {
-    sf::ConvexShape blob;
-    blob.setPointCount(m_pointCount);
-    blob.setFillColor(sf::Color::White);
-    blob.setOutlineThickness(0);
+const TerrainBitmap& TerrainGenerator::getBitmap() const {
+    if (m_bitmapGeneration == m_renderedGeneration) {
+        return m_bitmap;
+    }
+    PROFILE_ZONE("TerrainGenerator::getBitmap");
+
+    if (m_maskGeneration == m_renderedGeneration) {
+        m_bitmap = TerrainBitmap::fromMask(m_mask, TerrainMask::Solid);
+    } else {
+        // GPU backend: threshold the read back pixels directly, no per-pixel getPixel
+        sf::Image image = m_terrainTexture.getTexture().copyToImage();
+        m_bitmap = TerrainBitmap::fromRgba(image.getPixelsPtr(), m_width, m_height);
+    }
+    m_bitmapGeneration = m_renderedGeneration;
+    return m_bitmap;
+}
 
-    float caveRadius = m_baseRadius * 0.3f;
-    
-    for (int i = 0; i < m_pointCount; i++) {
-        float angle = (2 * M_PI * i) / m_pointCount;
-        
-        float noiseX = std::cos(angle) * m_noiseFrequency * 2;
-        float noiseY = std::sin(angle) * m_noiseFrequency * 2;
-        float variation = noise2D(noiseX, noiseY) * m_noiseAmplitude * caveRadius * 0.5f;
-        
-        float radius = caveRadius + variation;
-        float x = center.x + radius * std::cos(angle);
-        float y = center.y + radius * std::sin(angle);
-        blob.setPoint(i, sf::Vector2f(x, y));
+const SpanMask& TerrainGenerator::getSpanMask() const {
+    if (m_spansGeneration == m_renderedGeneration) {
+        return m_spans;
     }
-    
-    sf::RenderStates cutoutState;
-    cutoutState.blendMode = sf::BlendMode(
-        sf::BlendMode::Factor::DstColor,  // Replace Zero
-        sf::BlendMode::Factor::OneMinusSrcColor  // Replace One
-    );
-    target.draw(blob, cutoutState);
+    PROFILE_ZONE("TerrainGenerator::getSpanMask");
+
+    if (m_editCount == 0) {
+        // m_outlines always hold the geometry of the rendered generation
+        rasterizeTerrainSpans(m_outlines, m_width, m_height, m_spans);
+    } else {
+        m_spans = SpanMask::fromBitmap(getBitmap());
+    }
+    m_spansGeneration = m_renderedGeneration;
+    return m_spans;
 }
 
-// Modify regenerateCavePositions to only regenerate if caves vector is empty
-void TerrainGenerator::regenerateCavePositions() {
-    if (!m_cavesEnabled || !m_caves.empty()) {
-        return;
+const TerrainCollision& TerrainGenerator::getCollision() const {
+    if (m_collisionGeneration != m_renderedGeneration) {
+        PROFILE_ZONE("TerrainCollision::build");
+        m_collision.build(getBitmap());
+        m_collisionGeneration = m_renderedGeneration;
     }
+    return m_collision;
+}
 
-    std::uniform_real_distribution<float> rotDist(0.0f, 2.0f * static_cast<float>(M_PI));
-    std::uniform_real_distribution<float> scaleDist(0.8f, 1.2f);
-    std::uniform_real_distribution<float> noiseDist(0.0f, 10.0f);
-
-    for (int i = 0; i < m_caveCount; i++) {
-        Cave cave;
-        int minX = static_cast<int>(m_width * 0.2f);
-        int maxX = static_cast<int>(m_width * 0.8f);
-        int minY = static_cast<int>(m_height * 0.3f);
-        int maxY = static_cast<int>(m_height * 0.7f);
-        
-        std::uniform_int_distribution<int> xDist(minX, maxX);
-        std::uniform_int_distribution<int> yDist(minY, maxY);
-        
-        cave.position = sf::Vector2f(xDist(m_rng), yDist(m_rng));
-        cave.rotation = rotDist(m_rng);
-        cave.scaleVariant = scaleDist(m_rng);
-        cave.noiseOffset = noiseDist(m_rng);
-        
-        m_caves.push_back(cave);
+const DistanceField& TerrainGenerator::getDistanceField() const {
+    if (m_distanceFieldGeneration != m_renderedGeneration) {
+        // Unedited terrain is what the cache has under the key
+        std::shared_ptr<const CachedTerrain> cached =
+            m_cache && m_backend == RenderBackend::Cpu && m_editCount == 0 ? m_cache->find(m_renderedKey) : nullptr;
+        if (cached && cached->distanceField) {
+            m_distanceField = *cached->distanceField;
+        } else {
+            PROFILE_ZONE("computeDistanceField");
+            computeDistanceField(getBitmap(), m_distanceField);
+            if (cached) {
+                m_cache->attachDistanceField(m_renderedKey, std::make_shared<DistanceField>(m_distanceField));
+            }
+        }
+        m_distanceFieldGeneration = m_renderedGeneration;
     }
-    notifyUpdate();
+    return m_distanceField;
 }
 
-void TerrainGenerator::regenerateSelectedCavePosition() {
-    if (m_selectedCaveIndex >= 0 && m_selectedCaveIndex < m_caves.size()) {
-        Cave& cave = m_caves[m_selectedCaveIndex];
-        
-        int minX = static_cast<int>(m_width * 0.2f);
-        int maxX = static_cast<int>(m_width * 0.8f);
-        int minY = static_cast<int>(m_height * 0.3f);
-        int maxY = static_cast<int>(m_height * 0.7f);
-        
-        std::uniform_int_distribution<int> xDist(minX, maxX);
-        std::uniform_int_distribution<int> yDist(minY, maxY);
-        
-        cave.position = sf::Vector2f(
-            xDist(m_rng),
-            yDist(m_rng)
-        );
+const TerrainContours& TerrainGenerator::getContours(float tolerance) const {
+    if (m_contoursGeneration != m_renderedGeneration || m_contoursTolerance != tolerance) {
+        PROFILE_ZONE("extractContours");
+        m_contourStats = m_contourExtractor.extract(getBitmap(), tolerance, m_contours);
+        m_contoursGeneration = m_renderedGeneration;
+        m_contoursTolerance = tolerance;
+        m_contoursDirty = DirtyRect{};
+    } else if (!m_contoursDirty.empty()) {
+        PROFILE_ZONE("updateContours");
+        m_contourStats = m_contourExtractor.update(getBitmap(), m_contoursDirty.y0, m_contoursDirty.y1, m_contours);
+        m_contoursDirty = DirtyRect{};
+    }
+    return m_contours;
+}
 
-        notifyUpdate();
+void TerrainGenerator::drawBlob(sf::RenderTexture& target) {
+    // A single blob is the first blob of a one-blob layout, centered on the canvas
+    TerrainParams params = getShapeParams();
+    params.blobCount = 1;
+    std::vector<float> xs(std::max(0, m_pointCount));
+    std::vector<float> ys(xs.size());
+    buildBlobOutline(params, 0, xs.data(), ys.data());
+
+    sf::ConvexShape blob;
+    blob.setPointCount(xs.size());
+    blob.setFillColor(sf::Color::Black);
+    blob.setOutlineThickness(0);
+    for (size_t i = 0; i < xs.size(); i++) {
+        blob.setPoint(i, sf::Vector2f(xs[i], ys[i]));
     }
+
+    target.draw(blob);
 }
 
-float TerrainGenerator::noise2D(float x, float y) {
-    // Implementation of 2D Perlin noise
-    static const unsigned char permutation[256] = {
-        151,160,137,91,90,15,131,13,201,95,96,53,194,233,7,225,
-        140,36,103,30,69,142,8,99,37,240,21,10,23,190,6,148,
-        247,120,234,75,0,26,197,62,94,252,219,203,117,35,11,32,
-        57,177,33,88,237,149,56,87,174,20,125,136,171,168,68,175,
-        74,165,71,134,139,48,27,166,77,146,158,231,83,111,229,122,
-        60,211,133,230,220,105,92,41,55,46,245,40,244,102,143,54,
-        65,25,63,161,1,216,80,73,209,76,132,187,208,89,18,169,
-        200,196,135,130,116,188,159,86,164,100,109,198,173,186,3,64,
-        52,217,226,250,124,123,5,202,38,147,118,126,255,82,85,212,
-        207,206,59,227,47,16,58,17,182,189,28,42,223,183,170,213,
-        119,248,152,2,44,154,163,70,221,153,101,155,167,43,172,9,
-        129,22,39,253,19,98,108,110,79,113,224,232,178,185,112,104,
-        218,246,97,228,251,34,242,193,238,210,144,12,191,179,162,241,
-        81,51,145,235,249,14,239,107,49,192,214,31,181,199,106,157,
-        184,84,204,176,115,121,50,45,127,4,150,254,138,236,205,93,
-        222,114,67,29,24,72,243,141,128,195,78,66,215,61,156,180
-    };
+void TerrainGenerator::drawMultiBlob(sf::RenderTexture& target) {
+    PROFILE_ZONE("TerrainGenerator::drawMultiBlob");
+    // Every blob and cave goes into one persistent triangle list, fanned out
+    // from the polygon's bounding box center like sf::ConvexShape does.
+    // Blobs come first in black, caves after them in white, so a single draw
+    // call paints caves on top.
+    m_vertices.resize(m_outlines.pointCount() * 3);
+
+    size_t vertex = 0;
+    for (size_t i = 0; i < m_outlines.polygonCount(); i++) {
+        uint32_t begin = m_outlines.begin(i);
+        uint32_t count = m_outlines.size(i);
+        if (count < 3) {
+            continue;
+        }
+        const float* xs = m_outlines.xs.data() + begin;
+        const float* ys = m_outlines.ys.data() + begin;
+        sf::Color color = m_outlines.isCave(i) ? sf::Color::White : sf::Color::Black;
+
+        auto [minX, maxX] = std::minmax_element(xs, xs + count);
+        auto [minY, maxY] = std::minmax_element(ys, ys + count);
+        sf::Vector2f center((*minX + *maxX) / 2.0f, (*minY + *maxY) / 2.0f);
+
+        for (uint32_t j = 0; j < count; j++) {
+            uint32_t next = j + 1 == count ? 0 : j + 1;
+            m_vertices[vertex++] = sf::Vertex{center, color};
+            m_vertices[vertex++] = sf::Vertex{sf::Vector2f(xs[j], ys[j]), color};
+            m_vertices[vertex++] = sf::Vertex{sf::Vector2f(xs[next], ys[next]), color};
+        }
+    }
+    m_vertices.resize(vertex);
 
-    int X = static_cast<int>(floor(x)) & 255;
-    int Y = static_cast<int>(floor(y)) & 255;
-    x -= floor(x);
-    y -= floor(y);
+    target.draw(m_vertices);
+    m_counters.vertices = vertex;
+    m_counters.drawCalls = 1;
+}
 
-    float u = fade(x);
-    float v = fade(y);
+void TerrainGenerator::subtractBlob(sf::RenderTexture& target, const float* xs, const float* ys, size_t count) {
+    sf::ConvexShape blob;
+    blob.setPointCount(count);
+    blob.setOutlineThickness(0);
+    for (size_t i = 0; i < count; i++) {
+        blob.setPoint(i, sf::Vector2f(xs[i], ys[i]));
+    }
 
-    int A = permutation[X] + Y;
-    int B = permutation[X + 1] + Y;
+    // Replace instead of blending, so the cut leaves fully transparent pixels
+    blob.setFillColor(sf::Color::Transparent);
+    target.draw(blob, sf::RenderStates(sf::BlendNone));
+}
 
-    return lerp(v, 
-        lerp(u, grad(permutation[A], x, y), 
-                grad(permutation[B], x - 1, y)),
-        lerp(u, grad(permutation[A + 1], x, y - 1),
-                grad(permutation[B + 1], x - 1, y - 1)));
+void TerrainGenerator::addBlob(sf::RenderTexture& target, const float* xs, const float* ys, size_t count) {
+    sf::ConvexShape blob;
+    blob.setPointCount(count);
+    blob.setOutlineThickness(0);
+    for (size_t i = 0; i < count; i++) {
+        blob.setPoint(i, sf::Vector2f(xs[i], ys[i]));
+    }
+
+    blob.setFillColor(sf::Color::Black);
+    target.draw(blob, sf::RenderStates(sf::BlendNone));
+}
+
+// Modify regenerateCavePositions to only regenerate if caves vector is empty
+void TerrainGenerator::regenerateCavePositions() {
+    if (!m_cavesEnabled || !m_caves.empty()) {
+        return;
+    }
+
+    TerrainParams params = getShapeParams();
+    placeCaves(params, m_seed);
+    m_caves.assign(params.caves);
+    notifyUpdate();
 }
 
-float TerrainGenerator::fade(float t) {
-    // Fade function as defined by Ken Perlin
-    return t * t * t * (t * (t * 6 - 15) + 10);
+void TerrainGenerator::relayoutSpacedCaves(bool blobShapeChanged) {
+    if (m_cavePlacement != CavePlacement::PoissonDisc || (blobShapeChanged && !m_cavesInsideBlobs)) {
+        return;
+    }
+    // Cave i of the new layout replaces cave i of the old one under the same
+    // handle, so a selection survives as long as the layout still has it
+    TerrainParams params = getShapeParams();
+    placeCaves(params, m_seed);
+    m_caves.assign(params.caves);
 }
 
-float TerrainGenerator::lerp(float t, float a, float b) {
-    return a + t * (b - a);
+int TerrainGenerator::findCaveAt(sf::Vector2f position) const {
+    TerrainParams params = getShapeParams();
+    if (m_caveHashGeneration != m_generation) {
+        buildCaveHash(params, m_caves, m_caveHash);
+        m_caveHashGeneration = m_generation;
+    }
+    return hitTestCave(params, m_caves, m_caveHash, position.x, position.y);
 }
 
-float TerrainGenerator::grad(int hash, float x, float y) {
-    // Convert low 4 bits of hash code into 12 gradient directions
-    int h = hash & 15;
-    float u = h < 8 ? x : y;
-    float v = h < 4 ? y : h == 12 || h == 14 ? x : 0;
-    return ((h & 1) == 0 ? u : -u) + ((h & 2) == 0 ? v : -v);
+void TerrainGenerator::regenerateSelectedCavePosition() {
+    int index = m_caves.index(m_selectedCave);
+    if (index >= 0) {
+        CaveDesc cave = m_caves.get(static_cast<size_t>(index));
+        randomizeCavePosition(cave, m_rng, m_width, m_height);
+        m_caves.set(static_cast<size_t>(index), cave);
+
+        notifyUpdate();
+    }
 }
 
-TerrainGenerator::TerrainStats TerrainGenerator::calculateStats() const {
+TerrainGenerator::TerrainStats TerrainGenerator::calculateStats(StatsMode mode) const {
     TerrainStats stats;
-    
-    // Get the final rendered image
-    sf::Image image = m_terrainTexture.getTexture().copyToImage();
-    
-    // Count visible black pixels (terrain)
-    for (unsigned int y = 0; y < m_height; y++) {
-        for (unsigned int x = 0; x < m_width; x++) {
-            // In SFML 3.0, getPixel takes a Vector2u
-            if (image.getPixel(sf::Vector2u{x, y}) == sf::Color(0, 0, 0)) {
-                stats.visibleTerrainPixels++;
-            }
+    stats.generation = m_renderedGeneration;
+    stats.mode = mode;
+
+    if (m_editCount > 0) {
+        // Outlines no longer describe the edited terrain, the running count does
+        stats.visibleTerrainPixels = static_cast<uint32_t>(m_editedSolidPixels);
+        stats.terrainCoverage = 100.0f * m_editedSolidPixels / (static_cast<float>(m_width) * m_height);
+        stats.exact = true;
+        stats.fromRaster = true;
+        stats.edits = m_editCount;
+        return stats;
+    }
+
+    // Stats describe the rendered terrain, so they only go stale when it is re-rendered
+    TerrainStats& cached = m_cachedStats[static_cast<int>(mode)];
+    if (cached.generation == m_renderedGeneration) {
+        return cached;
+    }
+    PROFILE_ZONE("TerrainGenerator::calculateStats");
+
+    // m_outlines always hold the geometry of the rendered generation
+    CoverageResult coverage;
+    if (mode == StatsMode::Estimate) {
+        coverage = estimateCoverage(m_outlines, m_width, m_height);
+        stats.milliseconds = coverage.milliseconds;
+        stats.estimateFallback = coverage.unresolved;
+    }
+    // The estimate gives up on heavy overlap and degenerate geometry
+    if (mode == StatsMode::Exact || stats.estimateFallback) {
+        // Walking spans gets expensive with heavy overlap (thousands of caves);
+        // once that costs more than a pass over a mask we already hold, count the mask
+        uint64_t pixelCount = static_cast<uint64_t>(m_width) * m_height;
+        bool maskReady = m_maskGeneration == m_renderedGeneration;
+        if (maskReady && exactCoverageCost(m_outlines, m_height) * 8 > pixelCount) {
+            auto start = std::chrono::steady_clock::now();
+            coverage.solidPixels = countCells(m_mask, TerrainMask::Solid);
+            coverage.exact = true;
+            coverage.milliseconds = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count();
+            stats.fromRaster = true;
+        } else {
+            coverage = exactCoverage(m_outlines, m_width, m_height);
+        }
+        if (stats.estimateFallback) {
+            stats.fallbackMilliseconds = coverage.milliseconds;
+        } else {
+            stats.milliseconds = coverage.milliseconds;
         }
     }
+
+    stats.visibleTerrainPixels = static_cast<uint32_t>(coverage.solidPixels);
+    stats.exact = coverage.exact;
     
     // Calculate percentage of screen covered by visible terrain
     float totalPixels = static_cast<float>(m_width * m_height);
     stats.terrainCoverage = (stats.visibleTerrainPixels / totalPixels) * 100.0f;
     
+    cached = stats;
     return stats;
 }
 
 bool TerrainGenerator::saveToFile(const std::string& filename, const ExportSettings& settings) const {
-    sf::Image image = m_terrainTexture.getTexture().copyToImage();
-    
+    PROFILE_ZONE("TerrainGenerator::saveToFile");
+    const TerrainMask& mask = getMask();
+    MaskColors colors = exportColors(settings);
+
+    // One recolor pass over the mask instead of a setPixel per pixel
+    std::vector<uint8_t> pixels(static_cast<size_t>(m_width) * m_height * 4);
     for (unsigned int y = 0; y < m_height; y++) {
-        for (unsigned int x = 0; x < m_width; x++) {
-            sf::Color pixel = image.getPixel(sf::Vector2u{x, y});
-            
-            if (pixel == sf::Color::Black) {
-                // Terrain pixels stay black
-                continue;
-            }
-            
-            if (pixel == sf::Color::White) {
-                // Cave pixels
-                if (settings.transparentCaves) {
-                    image.setPixel(sf::Vector2u{x, y}, sf::Color(0, 0, 0, 0));  // Transparent
-                } else {
-                    image.setPixel(sf::Vector2u{x, y}, sf::Color::White);  // Solid white
-                }
-            } else {
-                // Background pixels
-                if (settings.transparentBackground) {
-                    image.setPixel(sf::Vector2u{x, y}, sf::Color(0, 0, 0, 0));  // Transparent
-                } else {
-                    image.setPixel(sf::Vector2u{x, y}, sf::Color::White);  // Solid white
-                }
-            }
-        }
+        recolorMaskRow(mask.row(y), pixels.data() + static_cast<size_t>(y) * m_width * 4, m_width, colors);
     }
+    sf::Image image(sf::Vector2u{m_width, m_height}, pixels.data());
     
     return image.saveToFile(filename);
 }
 
+bool TerrainGenerator::saveDistanceField(const std::string& filename, DistanceFieldFormat format, float range) const {
+    return writeDistanceField(filename, getDistanceField(), format, range);
+}
+
+bool TerrainGenerator::saveContours(const std::string& filename, float tolerance) const {
+    return writeContours(filename, getContours(tolerance));
+}
+
+bool TerrainGenerator::saveTerrainFile(const std::string& filename, bool withDistanceField,
+                                       bool withContours, float contourTolerance) const {
+    PROFILE_ZONE("TerrainGenerator::saveTerrainFile");
+    TerrainParams params = getParams();
+    TerrainBitmap caves = TerrainBitmap::fromMask(getMask(), TerrainMask::Cave);
+
+    TerrainFileData data;
+    data.params = &params;
+    data.seed = params.seed;
+    data.solid = &getBitmap();
+    data.caves = &caves;
+    data.distanceField = withDistanceField ? &getDistanceField() : nullptr;
+    data.contours = withContours ? &getContours(contourTolerance) : nullptr;
+    return writeTerrainFile(filename, data);
+}
+
+ExportQueue::JobId TerrainGenerator::saveToFileAsync(ExportQueue& queue, const std::string& filename,
+                                                     const ExportSettings& settings) const {
+    PROFILE_ZONE("TerrainGenerator::saveToFileAsync");
+    // The queue gets its own copy, later edits do not affect the export
+    return queue.enqueue(filename, getMask(), exportColors(settings));
+}
+
+ExportQueue::JobId TerrainGenerator::saveLargeToFileAsync(ExportQueue& queue, const std::string& filename, float scale,
+                                                          const ExportSettings& settings) const {
+    TerrainParams params = scaleTerrainParams(getParams(), scale);
+    TerrainOutlines outlines;
+    buildTerrainOutlines(params, outlines);
+    return queue.enqueueBanded(filename, std::move(outlines), params.width, params.height, exportColors(settings));
+}
+
 std::vector<uint8_t> TerrainGenerator::getTerrainData() const {
-    sf::Image image = m_terrainTexture.getTexture().copyToImage();
-    std::vector<uint8_t> data;
-    
-    // Convert to 1-bit bitmap (1 for terrain, 0 for air)
-    data.resize(m_width * m_height);
-    
-    for (unsigned int y = 0; y < m_height; y++) {
-        for (unsigned int x = 0; x < m_width; x++) {
-            sf::Color pixel = image.getPixel(sf::Vector2u{x, y});
-            // Black pixels (terrain) become 1, everything else 0
-            data[y * m_width + x] = (pixel == sf::Color(0, 0, 0)) ? 1 : 0;
-        }
+    return getVersionedTerrainData().pixels;
+}
+
+const TerrainGenerator::TerrainData& TerrainGenerator::getVersionedTerrainData() const {
+    if (m_cachedData.generation == m_renderedGeneration && !m_cachedData.pixels.empty()) {
+        return m_cachedData;
     }
+    PROFILE_ZONE("TerrainGenerator::getTerrainData");
+
+    TerrainData result;
+    result.generation = m_renderedGeneration;
+    result.width = m_width;
+    result.height = m_height;
+    // 1 for terrain, 0 for air and caves
+    result.pixels = getBitmap().toBytes();
     
-    return data;
+    m_cachedData = std::move(result);
+    return m_cachedData;
 }
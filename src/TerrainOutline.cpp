@@ -0,0 +1,321 @@
+#define _USE_MATH_DEFINES
+#include "TerrainOutline.hpp"
+#include "Noise.hpp"
+#include "NoisePolicies.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace {
+
+// Per-thread staging for batched noise evaluation
+struct NoiseScratch {
+    std::vector<float> xs;
+    std::vector<float> ys;
+    std::vector<float> values;
+    std::vector<float> cos;
+    std::vector<float> sin;
+
+    void resize(size_t count) {
+        xs.resize(count);
+        ys.resize(count);
+        values.resize(count);
+        cos.resize(count);
+        sin.resize(count);
+    }
+};
+
+thread_local NoiseScratch t_scratch;
+
+using NoiseSampler = void (*)(const float* xs, const float* ys, float* out, size_t count);
+
+// One instantiation per noise configuration; the policy is a type, so the
+// whole octave stack inlines into this loop
+template <typename Noise>
+void sampleNoise(const float* xs, const float* ys, float* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = Noise::sample(xs[i], ys[i]);
+    }
+}
+
+template <template <typename, int> class Fractal, typename Basis, int... Octave>
+constexpr std::array<NoiseSampler, MaxNoiseOctaves> octaveSamplers(std::integer_sequence<int, Octave...>) {
+    return {{&sampleNoise<Fractal<Basis, Octave + 1>>...}};
+}
+
+template <template <typename, int> class Fractal, typename Basis>
+constexpr std::array<NoiseSampler, MaxNoiseOctaves> octaveSamplers() {
+    return octaveSamplers<Fractal, Basis>(std::make_integer_sequence<int, MaxNoiseOctaves>{});
+}
+
+// Picks the instantiation once per outline rather than once per point
+NoiseSampler noiseSampler(const TerrainParams& params) {
+    static constexpr std::array<std::array<NoiseSampler, MaxNoiseOctaves>, 6> samplers{{
+        octaveSamplers<FbmNoise, PerlinNoise<>>(),
+        octaveSamplers<FbmNoise, SimplexNoise<>>(),
+        octaveSamplers<FbmNoise, ValueNoise<>>(),
+        octaveSamplers<RidgedNoise, PerlinNoise<>>(),
+        octaveSamplers<RidgedNoise, SimplexNoise<>>(),
+        octaveSamplers<RidgedNoise, ValueNoise<>>(),
+    }};
+    size_t basis = static_cast<size_t>(params.noiseBasis);
+    size_t fractal = static_cast<size_t>(params.noiseFractal);
+    if (basis > 2 || fractal > 1) {
+        basis = 0;
+        fractal = 0;
+    }
+    int octaves = std::clamp(params.noiseOctaves, 1, MaxNoiseOctaves);
+    return samplers[fractal * 3 + basis][octaves - 1];
+}
+
+void sampleOutlineNoise(const TerrainParams& params, NoiseScratch& scratch, size_t count) {
+    // A single octave of fBm Perlin is plain Perlin, which has SIMD kernels
+    if (params.noiseBasis == NoiseBasis::Perlin && params.noiseFractal == NoiseFractal::Fbm &&
+        params.noiseOctaves <= 1) {
+        perlinNoise2DBatch(scratch.xs.data(), scratch.ys.data(), scratch.values.data(), count);
+        return;
+    }
+    noiseSampler(params)(scratch.xs.data(), scratch.ys.data(), scratch.values.data(), count);
+}
+
+// Where in the noise field seed `seed` samples its blobs. Seed 0 stays at
+// the origin, so seedless terrains keep their shapes; any other seed lands
+// somewhere in the first 256 x 256 units, far enough apart in two axes that
+// neighbouring seeds don't share outlines.
+Point2f seedNoiseShift(uint32_t seed) {
+    if (seed == 0) {
+        return Point2f{0.0f, 0.0f};
+    }
+    uint64_t value = seed * 0x9E3779B97F4A7C15ull;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    value ^= value >> 31;
+    // 16 bits of fraction per axis
+    float x = static_cast<float>(value >> 40) / 65536.0f;
+    float y = static_cast<float>((value >> 16) & 0xFFFFFF) / 65536.0f;
+    return Point2f{x, y};
+}
+
+void buildShiftedBlobOutline(const TerrainParams& params, float centerX, float centerY, float noiseOffset,
+                             Point2f shift, float* xs, float* ys) {
+    const AngleTable& table = angleTable(params.pointCount);
+    size_t count = table.angles.size();
+
+    NoiseScratch& scratch = t_scratch;
+    scratch.resize(count);
+    for (size_t j = 0; j < count; j++) {
+        scratch.xs[j] = (table.cos[j] + noiseOffset) * params.noiseFrequency + shift.x;
+        scratch.ys[j] = table.sin[j] * params.noiseFrequency + shift.y;
+    }
+    sampleOutlineNoise(params, scratch, count);
+
+    for (size_t j = 0; j < count; j++) {
+        float variation = scratch.values[j] * params.noiseAmplitude * params.baseRadius * 0.5f;
+        float radius = params.baseRadius + variation;
+        xs[j] = centerX + (radius * table.cos[j] * params.horizontalStretch);
+        ys[j] = centerY + radius * table.sin[j];
+    }
+}
+
+} // namespace
+
+const AngleTable& angleTable(int pointCount) {
+    static std::mutex mutex;
+    static std::map<int, std::unique_ptr<AngleTable>> tables;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<AngleTable>& table = tables[pointCount];
+    if (!table) {
+        table = std::make_unique<AngleTable>();
+        int count = std::max(0, pointCount);
+        table->angles.resize(count);
+        table->cos.resize(count);
+        table->sin.resize(count);
+        for (int j = 0; j < count; j++) {
+            table->angles[j] = (2 * M_PI * j) / pointCount;
+            float angle = static_cast<float>(table->angles[j]);
+            table->cos[j] = std::cos(angle);
+            table->sin[j] = std::sin(angle);
+        }
+    }
+    return *table;
+}
+
+Point2f blobCenter(const TerrainParams& params, int index) {
+    // Calculate total width needed for all blobs
+    float totalWidth = (params.blobCount - 1) * params.baseRadius * params.blobSpacing;
+    float startX = (params.width - totalWidth) / 2.0f;
+    return Point2f{startX + (index * params.baseRadius * params.blobSpacing), params.height / 2.0f};
+}
+
+void buildBlobOutline(const TerrainParams& params, int index, float* xs, float* ys) {
+    Point2f center = blobCenter(params, index);
+    Point2f shift = seedNoiseShift(params.seed);
+    buildShiftedBlobOutline(params, center.x, center.y, static_cast<float>(index), shift, xs, ys);
+}
+
+void buildBlobOutlineAt(const TerrainParams& params, float centerX, float centerY, float noiseOffset,
+                        float* xs, float* ys) {
+    buildShiftedBlobOutline(params, centerX, centerY, noiseOffset, Point2f{0.0f, 0.0f}, xs, ys);
+}
+
+void buildCaveOutline(const TerrainParams& params, const CaveDesc& cave, float* xs, float* ys) {
+    float caveRadius = params.baseRadius * params.caveScale * cave.scaleVariant;
+    const AngleTable& table = angleTable(params.cavePointCount);
+    size_t count = table.angles.size();
+
+    // The cave rotation is added in double precision before rounding, so the
+    // rotated angles still need their own cos/sin to match the original math
+    NoiseScratch& scratch = t_scratch;
+    scratch.resize(count);
+    for (size_t j = 0; j < count; j++) {
+        float angle = table.angles[j] + cave.rotation;
+        scratch.cos[j] = std::cos(angle);
+        scratch.sin[j] = std::sin(angle);
+        scratch.xs[j] = scratch.cos[j] * params.caveNoiseFrequency + cave.noiseOffset;
+        scratch.ys[j] = scratch.sin[j] * params.caveNoiseFrequency + cave.noiseOffset;
+    }
+    sampleOutlineNoise(params, scratch, count);
+
+    for (size_t j = 0; j < count; j++) {
+        float variation = scratch.values[j] * params.caveNoiseAmplitude * caveRadius * 0.5f;
+        float radius = caveRadius + variation;
+        xs[j] = cave.x + radius * scratch.cos[j];
+        ys[j] = cave.y + radius * scratch.sin[j];
+    }
+}
+
+CaveOutlineCache::Shape CaveOutlineCache::shapeOf(const TerrainParams& params) {
+    Shape shape;
+    shape.baseRadius = params.baseRadius;
+    shape.caveScale = params.caveScale;
+    shape.caveNoiseFrequency = params.caveNoiseFrequency;
+    shape.caveNoiseAmplitude = params.caveNoiseAmplitude;
+    shape.cavePointCount = params.cavePointCount;
+    shape.noiseBasis = params.noiseBasis;
+    shape.noiseFractal = params.noiseFractal;
+    shape.noiseOctaves = params.noiseOctaves;
+    return shape;
+}
+
+bool CaveOutlineCache::sameShape(const Shape& a, const Shape& b) {
+    return a.baseRadius == b.baseRadius && a.caveScale == b.caveScale &&
+           a.caveNoiseFrequency == b.caveNoiseFrequency && a.caveNoiseAmplitude == b.caveNoiseAmplitude &&
+           a.cavePointCount == b.cavePointCount && a.noiseBasis == b.noiseBasis &&
+           a.noiseFractal == b.noiseFractal && a.noiseOctaves == b.noiseOctaves;
+}
+
+template <typename CaveAt>
+void CaveOutlineCache::update(const TerrainParams& params, size_t count, CaveAt caveAt) {
+    Shape shape = shapeOf(params);
+    if (!sameShape(shape, m_shape)) {
+        m_shape = shape;
+        m_sources.clear();
+    }
+    m_sources.truncate(count);
+    size_t kept = m_sources.size();
+    m_pointsPerCave = static_cast<size_t>(std::max(0, params.cavePointCount));
+    m_sources.reserve(count);
+    m_xs.resize(count * m_pointsPerCave);
+    m_ys.resize(m_xs.size());
+
+    m_rebuilt = 0;
+    for (size_t i = 0; i < count; i++) {
+        CaveDesc cave = caveAt(i);
+        if (i < kept) {
+            // Bitwise, a cave is only reused when buildCaveOutline() would see the same input
+            CaveDesc built = m_sources.get(i);
+            if (std::memcmp(&built, &cave, sizeof(CaveDesc)) == 0) {
+                continue;
+            }
+            m_sources.set(i, cave);
+        } else {
+            m_sources.add(cave);
+        }
+        buildCaveOutline(params, cave, m_xs.data() + i * m_pointsPerCave, m_ys.data() + i * m_pointsPerCave);
+        m_rebuilt++;
+    }
+}
+
+void CaveOutlineCache::update(const TerrainParams& params) {
+    size_t count = params.cavesEnabled ? params.caves.size() : 0;
+    update(params, count, [&params](size_t i) { return params.caves[i]; });
+}
+
+void CaveOutlineCache::update(const TerrainParams& params, const CaveStore& caves) {
+    size_t count = params.cavesEnabled ? caves.size() : 0;
+    update(params, count, [&caves](size_t i) { return caves.get(i); });
+}
+
+void CaveOutlineCache::clear() {
+    m_shape = Shape{};
+    m_sources.clear();
+    m_xs.clear();
+    m_ys.clear();
+    m_rebuilt = 0;
+}
+
+namespace {
+
+// Sizes `out` for the blobs and `caveCount` caves, sets every offset and
+// builds the blob outlines; the cave outlines are left to the caller
+void layoutOutlines(const TerrainParams& params, size_t caveCount, TerrainOutlines& out) {
+    // Always at least one surface blob
+    int blobCount = std::max(1, params.blobCount);
+    size_t blobPoints = std::max(0, params.pointCount);
+    size_t cavePoints = std::max(0, params.cavePointCount);
+
+    out.blobCount = static_cast<uint32_t>(blobCount);
+    out.offsets.resize(blobCount + caveCount + 1);
+    out.xs.resize(blobCount * blobPoints + caveCount * cavePoints);
+    out.ys.resize(out.xs.size());
+
+    uint32_t offset = 0;
+    size_t polygon = 0;
+    for (int i = 0; i < blobCount; i++) {
+        out.offsets[polygon++] = offset;
+        buildBlobOutline(params, i, out.xs.data() + offset, out.ys.data() + offset);
+        offset += static_cast<uint32_t>(blobPoints);
+    }
+    for (size_t i = 0; i < caveCount; i++) {
+        out.offsets[polygon++] = offset;
+        offset += static_cast<uint32_t>(cavePoints);
+    }
+    out.offsets[polygon] = offset;
+}
+
+// Caves follow the blobs in the same layout the cache uses, so they go over in one copy
+void copyCaveOutlines(const CaveOutlineCache& cache, TerrainOutlines& out) {
+    uint32_t offset = out.offsets[out.blobCount];
+    std::copy(cache.xs().begin(), cache.xs().end(), out.xs.begin() + offset);
+    std::copy(cache.ys().begin(), cache.ys().end(), out.ys.begin() + offset);
+}
+
+} // namespace
+
+void buildTerrainOutlines(const TerrainParams& params, TerrainOutlines& out, CaveOutlineCache* caves) {
+    size_t caveCount = params.cavesEnabled ? params.caves.size() : 0;
+    layoutOutlines(params, caveCount, out);
+    if (caves) {
+        caves->update(params);
+        copyCaveOutlines(*caves, out);
+        return;
+    }
+    for (size_t i = 0; i < caveCount; i++) {
+        uint32_t offset = out.begin(out.blobCount + i);
+        buildCaveOutline(params, params.caves[i], out.xs.data() + offset, out.ys.data() + offset);
+    }
+}
+
+void buildTerrainOutlines(const TerrainParams& params, const CaveStore& caves, TerrainOutlines& out,
+                          CaveOutlineCache& cache) {
+    layoutOutlines(params, params.cavesEnabled ? caves.size() : 0, out);
+    cache.update(params, caves);
+    copyCaveOutlines(cache, out);
+}
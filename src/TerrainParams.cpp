@@ -0,0 +1,372 @@
+#define _USE_MATH_DEFINES
+#include "TerrainParams.hpp"
+#include "CavePlacement.hpp"
+#include "CaveStore.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+std::string trim(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) {
+        return {};
+    }
+    size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(begin, end - begin + 1);
+}
+
+template <typename T>
+bool parseValue(const std::string& text, T& value) {
+    std::istringstream stream(text);
+    T parsed{};
+    stream >> parsed;
+    if (!stream || !stream.eof()) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+bool parseValue(const std::string& text, CavePlacement& value) {
+    if (text == "uniform") {
+        value = CavePlacement::Uniform;
+    } else if (text == "poisson") {
+        value = CavePlacement::PoissonDisc;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool parseValue(const std::string& text, NoiseBasis& value) {
+    if (text == "perlin") {
+        value = NoiseBasis::Perlin;
+    } else if (text == "simplex") {
+        value = NoiseBasis::Simplex;
+    } else if (text == "value") {
+        value = NoiseBasis::Value;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool parseValue(const std::string& text, NoiseFractal& value) {
+    if (text == "fbm") {
+        value = NoiseFractal::Fbm;
+    } else if (text == "ridged") {
+        value = NoiseFractal::Ridged;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* noiseBasisKey(NoiseBasis basis) {
+    switch (basis) {
+        case NoiseBasis::Perlin: return "perlin";
+        case NoiseBasis::Simplex: return "simplex";
+        case NoiseBasis::Value: return "value";
+    }
+    return "perlin";
+}
+
+bool parseValue(const std::string& text, bool& value) {
+    if (text == "true" || text == "1") {
+        value = true;
+    } else if (text == "false" || text == "0") {
+        value = false;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Bump whenever outlines or rasterization change what a set of parameters produces
+constexpr uint32_t GenerationVersion = 3;
+
+// FNV-1a over the canonical encoding, finished with a splitmix64 step so
+// nearby inputs spread over all 64 bits
+class ParamsHasher {
+public:
+    void add(uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            m_hash = (m_hash ^ ((value >> (i * 8)) & 0xFF)) * 0x100000001B3ull;
+        }
+    }
+    void add(int value) { add(static_cast<uint32_t>(value)); }
+    void add(bool value) { add(value ? 1u : 0u); }
+    void add(float value) {
+        if (value == 0.0f) {
+            value = 0.0f;  // Folds -0 into +0
+        }
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        add(bits);
+    }
+    uint64_t finish() const {
+        uint64_t value = m_hash + 0x9E3779B97F4A7C15ull;
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+        return value ^ (value >> 31);
+    }
+
+private:
+    uint64_t m_hash{0xCBF29CE484222325ull};
+};
+
+// Everything but the cave list, in hashing order
+void addShape(ParamsHasher& hasher, const TerrainParams& params) {
+    hasher.add(GenerationVersion);
+    hasher.add(params.width);
+    hasher.add(params.height);
+    hasher.add(params.pointCount);
+    hasher.add(params.baseRadius);
+    hasher.add(params.horizontalStretch);
+    hasher.add(params.noiseFrequency);
+    hasher.add(params.noiseAmplitude);
+    hasher.add(static_cast<uint32_t>(params.noiseBasis));
+    hasher.add(static_cast<uint32_t>(params.noiseFractal));
+    hasher.add(params.noiseOctaves);
+    hasher.add(params.blobCount);
+    hasher.add(params.blobSpacing);
+    hasher.add(params.cavesEnabled);
+    hasher.add(params.caveScale);
+    hasher.add(params.caveNoiseFrequency);
+    hasher.add(params.caveNoiseAmplitude);
+    hasher.add(params.caveCount);
+    hasher.add(params.cavePointCount);
+    hasher.add(params.seed);
+}
+
+} // namespace
+
+TerrainParams defaultTerrainParams(unsigned int width, unsigned int height) {
+    TerrainParams params;
+    params.width = width;
+    params.height = height;
+    params.baseRadius = std::min(width, height) / 3;
+    return params;
+}
+
+TerrainParams scaleTerrainParams(const TerrainParams& params, float factor) {
+    TerrainParams scaled = params;
+    scaled.width = static_cast<unsigned int>(std::lround(params.width * static_cast<double>(factor)));
+    scaled.height = static_cast<unsigned int>(std::lround(params.height * static_cast<double>(factor)));
+    scaled.baseRadius = static_cast<int>(std::lround(params.baseRadius * static_cast<double>(factor)));
+    for (CaveDesc& cave : scaled.caves) {
+        cave.x *= factor;
+        cave.y *= factor;
+    }
+    return scaled;
+}
+
+TerrainParams previewTerrainParams(const TerrainParams& params, float factor) {
+    TerrainParams preview = scaleTerrainParams(params, factor);
+    // Never below 16 points, fewer turn blobs into visible polygons
+    auto reduce = [factor](int points) {
+        return std::max(std::min(points, 16), static_cast<int>(std::lround(points * static_cast<double>(factor))));
+    };
+    preview.pointCount = reduce(params.pointCount);
+    preview.cavePointCount = reduce(params.cavePointCount);
+    preview.width = std::max(preview.width, 1u);
+    preview.height = std::max(preview.height, 1u);
+    return preview;
+}
+
+CaveDesc randomCave(std::mt19937& rng, unsigned int width, unsigned int height) {
+    std::uniform_real_distribution<float> rotDist(0.0f, 2.0f * static_cast<float>(M_PI));
+    std::uniform_real_distribution<float> scaleDist(0.8f, 1.2f);
+    std::uniform_real_distribution<float> noiseDist(0.0f, 10.0f);
+
+    CaveDesc cave;
+    randomizeCavePosition(cave, rng, width, height);
+    cave.rotation = rotDist(rng);
+    cave.scaleVariant = scaleDist(rng);
+    cave.noiseOffset = noiseDist(rng);
+    return cave;
+}
+
+void randomizeCavePosition(CaveDesc& cave, std::mt19937& rng, unsigned int width, unsigned int height) {
+    int minX = static_cast<int>(width * 0.2f);
+    int maxX = static_cast<int>(width * 0.8f);
+    int minY = static_cast<int>(height * 0.3f);
+    int maxY = static_cast<int>(height * 0.7f);
+
+    std::uniform_int_distribution<int> xDist(minX, maxX);
+    std::uniform_int_distribution<int> yDist(minY, maxY);
+
+    cave.x = static_cast<float>(xDist(rng));
+    cave.y = static_cast<float>(yDist(rng));
+}
+
+CaveDesc seededCave(uint32_t seed, int index, unsigned int width, unsigned int height) {
+    // One stream per cave, so adding or removing caves leaves the others alone
+    CaveRandom random((static_cast<uint64_t>(seed) << 32) | static_cast<uint32_t>(index));
+    CaveDesc cave;
+    cave.x = static_cast<float>(random.range(static_cast<int>(width * 0.2f), static_cast<int>(width * 0.8f)));
+    cave.y = static_cast<float>(random.range(static_cast<int>(height * 0.3f), static_cast<int>(height * 0.7f)));
+    cave.rotation = random.range(0.0f, 2.0f * static_cast<float>(M_PI));
+    cave.scaleVariant = random.range(0.8f, 1.2f);
+    cave.noiseOffset = random.range(0.0f, 10.0f);
+    return cave;
+}
+
+void placeCaves(TerrainParams& params, uint32_t seed) {
+    params.seed = seed;
+    params.caves.clear();
+    if (!params.cavesEnabled) {
+        return;
+    }
+    if (params.cavePlacement == CavePlacement::PoissonDisc) {
+        placeCavesPoissonDisc(params, seed);
+        return;
+    }
+    params.caves.reserve(std::max(0, params.caveCount));
+    for (int i = 0; i < params.caveCount; i++) {
+        params.caves.push_back(seededCave(seed, i, params.width, params.height));
+    }
+}
+
+uint64_t terrainParamsHash(const TerrainParams& params) {
+    ParamsHasher hasher;
+    addShape(hasher, params);
+    // Disabled caves are not drawn, whatever the list holds
+    size_t caveCount = params.cavesEnabled ? params.caves.size() : 0;
+    hasher.add(static_cast<uint32_t>(caveCount));
+    for (size_t i = 0; i < caveCount; i++) {
+        const CaveDesc& cave = params.caves[i];
+        hasher.add(cave.x);
+        hasher.add(cave.y);
+        hasher.add(cave.rotation);
+        hasher.add(cave.scaleVariant);
+        hasher.add(cave.noiseOffset);
+    }
+    return hasher.finish();
+}
+
+uint64_t terrainParamsHash(const TerrainParams& params, const CaveStore& caves) {
+    ParamsHasher hasher;
+    addShape(hasher, params);
+    size_t caveCount = params.cavesEnabled ? caves.size() : 0;
+    hasher.add(static_cast<uint32_t>(caveCount));
+    const float* xs = caves.xs().data();
+    const float* ys = caves.ys().data();
+    const float* rotations = caves.rotations().data();
+    const float* scaleVariants = caves.scaleVariants().data();
+    const float* noiseOffsets = caves.noiseOffsets().data();
+    for (size_t i = 0; i < caveCount; i++) {
+        hasher.add(xs[i]);
+        hasher.add(ys[i]);
+        hasher.add(rotations[i]);
+        hasher.add(scaleVariants[i]);
+        hasher.add(noiseOffsets[i]);
+    }
+    return hasher.finish();
+}
+
+bool loadTerrainParams(const std::string& filename, TerrainParams& params, std::string& error) {
+    std::ifstream file(filename);
+    if (!file) {
+        error = "cannot open " + filename;
+        return false;
+    }
+
+    TerrainParams loaded = params;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) {
+            continue;
+        }
+
+        size_t equals = line.find('=');
+        if (equals == std::string::npos) {
+            error = filename + ":" + std::to_string(lineNumber) + ": expected key = value";
+            return false;
+        }
+        std::string key = trim(line.substr(0, equals));
+        std::string value = trim(line.substr(equals + 1));
+
+        bool known = true;
+        bool parsed = false;
+        if (key == "width") parsed = parseValue(value, loaded.width);
+        else if (key == "height") parsed = parseValue(value, loaded.height);
+        else if (key == "pointCount") parsed = parseValue(value, loaded.pointCount);
+        else if (key == "baseRadius") parsed = parseValue(value, loaded.baseRadius);
+        else if (key == "horizontalStretch") parsed = parseValue(value, loaded.horizontalStretch);
+        else if (key == "noiseFrequency") parsed = parseValue(value, loaded.noiseFrequency);
+        else if (key == "noiseAmplitude") parsed = parseValue(value, loaded.noiseAmplitude);
+        else if (key == "noiseBasis") parsed = parseValue(value, loaded.noiseBasis);
+        else if (key == "noiseFractal") parsed = parseValue(value, loaded.noiseFractal);
+        else if (key == "noiseOctaves") parsed = parseValue(value, loaded.noiseOctaves);
+        else if (key == "blobCount") parsed = parseValue(value, loaded.blobCount);
+        else if (key == "blobSpacing") parsed = parseValue(value, loaded.blobSpacing);
+        else if (key == "cavesEnabled") parsed = parseValue(value, loaded.cavesEnabled);
+        else if (key == "caveScale") parsed = parseValue(value, loaded.caveScale);
+        else if (key == "caveNoiseFrequency") parsed = parseValue(value, loaded.caveNoiseFrequency);
+        else if (key == "caveNoiseAmplitude") parsed = parseValue(value, loaded.caveNoiseAmplitude);
+        else if (key == "caveCount") parsed = parseValue(value, loaded.caveCount);
+        else if (key == "cavePointCount") parsed = parseValue(value, loaded.cavePointCount);
+        else if (key == "seed") parsed = parseValue(value, loaded.seed);
+        else if (key == "cavePlacement") parsed = parseValue(value, loaded.cavePlacement);
+        else if (key == "caveSpacing") parsed = parseValue(value, loaded.caveSpacing);
+        else if (key == "cavesInsideBlobs") parsed = parseValue(value, loaded.cavesInsideBlobs);
+        else known = false;
+
+        if (!known) {
+            error = filename + ":" + std::to_string(lineNumber) + ": unknown key '" + key + "'";
+            return false;
+        }
+        if (!parsed) {
+            error = filename + ":" + std::to_string(lineNumber) + ": bad value for '" + key + "'";
+            return false;
+        }
+    }
+
+    if (loaded.width == 0 || loaded.height == 0) {
+        error = filename + ": width and height must be set";
+        return false;
+    }
+    params = loaded;
+    return true;
+}
+
+bool saveTerrainParams(const std::string& filename, const TerrainParams& params) {
+    std::ofstream file(filename);
+    if (!file) {
+        return false;
+    }
+
+    file.precision(9);  // Enough digits for floats to round-trip exactly
+    file << "# Terrain generation parameters\n";
+    file << "width = " << params.width << "\n";
+    file << "height = " << params.height << "\n";
+    file << "pointCount = " << params.pointCount << "\n";
+    file << "baseRadius = " << params.baseRadius << "\n";
+    file << "horizontalStretch = " << params.horizontalStretch << "\n";
+    file << "noiseFrequency = " << params.noiseFrequency << "\n";
+    file << "noiseAmplitude = " << params.noiseAmplitude << "\n";
+    file << "noiseBasis = " << noiseBasisKey(params.noiseBasis) << "\n";
+    file << "noiseFractal = " << (params.noiseFractal == NoiseFractal::Ridged ? "ridged" : "fbm") << "\n";
+    file << "noiseOctaves = " << params.noiseOctaves << "\n";
+    file << "blobCount = " << params.blobCount << "\n";
+    file << "blobSpacing = " << params.blobSpacing << "\n";
+    file << "cavesEnabled = " << (params.cavesEnabled ? "true" : "false") << "\n";
+    file << "caveScale = " << params.caveScale << "\n";
+    file << "caveNoiseFrequency = " << params.caveNoiseFrequency << "\n";
+    file << "caveNoiseAmplitude = " << params.caveNoiseAmplitude << "\n";
+    file << "caveCount = " << params.caveCount << "\n";
+    file << "cavePointCount = " << params.cavePointCount << "\n";
+    file << "seed = " << params.seed << "\n";
+    file << "cavePlacement = " << (params.cavePlacement == CavePlacement::PoissonDisc ? "poisson" : "uniform") << "\n";
+    file << "caveSpacing = " << params.caveSpacing << "\n";
+    file << "cavesInsideBlobs = " << (params.cavesInsideBlobs ? "true" : "false") << "\n";
+    return static_cast<bool>(file);
+}
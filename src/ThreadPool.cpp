@@ -0,0 +1,157 @@
+#include "ThreadPool.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+
+namespace {
+
+thread_local const ThreadPool* t_pool = nullptr;
+thread_local int t_workerIndex = -1;
+
+} // namespace
+
+ThreadPool::ThreadPool(unsigned int threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    m_queues.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; i++) {
+        m_queues.push_back(std::make_unique<WorkQueue>());
+    }
+    m_workers.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; i++) {
+        m_workers.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stopping = true;
+    }
+    m_sleepCv.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+int ThreadPool::currentWorkerIndex() const {
+    return t_pool == this ? t_workerIndex : -1;
+}
+
+void ThreadPool::submit(Task task) {
+    int self = currentWorkerIndex();
+    size_t target = self >= 0 ? static_cast<size_t>(self) : m_nextQueue++ % m_queues.size();
+
+    m_unfinished++;
+    {
+        std::lock_guard<std::mutex> lock(m_queues[target]->mutex);
+        m_queues[target]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_queued++;
+    }
+    m_sleepCv.notify_one();
+}
+
+bool ThreadPool::tryRunOne(int self) {
+    Task task;
+    size_t count = m_queues.size();
+
+    // Own queue first (newest work, still hot in cache), then steal the oldest elsewhere
+    if (self >= 0) {
+        WorkQueue& own = *m_queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+        }
+    }
+    if (!task) {
+        size_t start = self >= 0 ? static_cast<size_t>(self) + 1 : m_nextQueue.load();
+        for (size_t i = 0; i < count && !task; i++) {
+            WorkQueue& victim = *m_queues[(start + i) % count];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+            }
+        }
+    }
+    if (!task) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_queued--;
+    }
+    task();
+    finishTask();
+    return true;
+}
+
+void ThreadPool::finishTask() {
+    if (--m_unfinished == 0) {
+        std::lock_guard<std::mutex> lock(m_doneMutex);
+        m_doneCv.notify_all();
+    }
+}
+
+void ThreadPool::workerLoop(unsigned int index) {
+    t_pool = this;
+    t_workerIndex = static_cast<int>(index);
+    Profiler::instance().setThreadName("pool worker");
+
+    while (true) {
+        if (tryRunOne(static_cast<int>(index))) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_sleepCv.wait(lock, [this] { return m_stopping || m_queued > 0; });
+        if (m_stopping && m_queued == 0) {
+            return;
+        }
+    }
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(m_doneMutex);
+    m_doneCv.wait(lock, [this] { return m_unfinished.load() == 0; });
+}
+
+void ThreadPool::parallelFor(size_t begin, size_t end, size_t grain,
+                             const std::function<void(size_t, size_t)>& fn) {
+    if (begin >= end) {
+        return;
+    }
+    grain = std::max<size_t>(1, grain);
+
+    std::atomic<size_t> remaining{end - begin};
+
+    // Split off the upper half as a new task until the range fits the grain,
+    // then run what is left. Thieves take the big halves from the front.
+    std::function<void(size_t, size_t)> run = [&](size_t b, size_t e) {
+        while (e - b > grain) {
+            size_t mid = b + (e - b) / 2;
+            submit([&run, mid, e] { run(mid, e); });
+            e = mid;
+        }
+        fn(b, e);
+        remaining -= e - b;
+    };
+    run(begin, end);
+
+    int self = currentWorkerIndex();
+    while (remaining.load() > 0) {
+        if (!tryRunOne(self)) {
+            std::this_thread::yield();
+        }
+    }
+}
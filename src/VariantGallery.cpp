@@ -0,0 +1,126 @@
+#include "VariantGallery.hpp"
+#include "MaskRasterizer.hpp"
+#include "Profiler.hpp"
+#include "TerrainOutline.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Works for const and non-const parameters alike
+template <typename Params>
+auto sweptField(Params& params, GallerySweep sweep) -> decltype(&params.noiseFrequency) {
+    switch (sweep) {
+    case GallerySweep::NoiseFrequency: return &params.noiseFrequency;
+    case GallerySweep::NoiseAmplitude: return &params.noiseAmplitude;
+    case GallerySweep::BlobSpacing: return &params.blobSpacing;
+    case GallerySweep::HorizontalStretch: return &params.horizontalStretch;
+    case GallerySweep::CaveScale: return &params.caveScale;
+    case GallerySweep::CaveNoiseFrequency: return &params.caveNoiseFrequency;
+    case GallerySweep::CaveNoiseAmplitude: return &params.caveNoiseAmplitude;
+    case GallerySweep::Seed: break;
+    }
+    return nullptr;
+}
+
+} // namespace
+
+VariantGallery::VariantGallery(unsigned int threads)
+    : m_pool(threads) {
+}
+
+VariantGallery::~VariantGallery() {
+    // Queued tasks see the new sweep number and return without rendering
+    m_sweep++;
+}
+
+void VariantGallery::generate(const TerrainParams& base, const GallerySettings& settings) {
+    PROFILE_ZONE("VariantGallery::generate");
+    uint64_t sweep;
+    {
+        // Tasks of the old sweep check the number under the lock before they publish
+        std::lock_guard<std::mutex> lock(m_mutex);
+        sweep = ++m_sweep;
+        m_ready.clear();
+        m_finished = 0;
+        m_doneTime = 0;
+    }
+    m_settings = settings;
+    m_startTime = Profiler::now();
+
+    m_variants.assign(settings.count, base);
+    for (unsigned int i = 0; i < settings.count; i++) {
+        TerrainParams& params = m_variants[i];
+        if (float* field = sweptField(params, settings.sweep)) {
+            float t = settings.count > 1 ? static_cast<float>(i) / (settings.count - 1) : 0.0f;
+            *field = settings.from + (settings.to - settings.from) * t;
+        } else {
+            placeCaves(params, base.seed + i);
+        }
+    }
+
+    float factor = base.width > 0
+        ? std::min(1.0f, static_cast<float>(settings.thumbnailWidth) / base.width) : 1.0f;
+    // Tasks get copies of everything they read, generate() may run again meanwhile
+    for (size_t i = 0; i < m_variants.size(); i++) {
+        TerrainParams preview = previewTerrainParams(m_variants[i], factor);
+        m_thumbnailWidth = preview.width;
+        m_thumbnailHeight = preview.height;
+        m_pool.submit([this, sweep, i, preview = std::move(preview), colors = settings.colors,
+                       count = m_variants.size()]() {
+            renderThumbnail(sweep, i, count, preview, colors);
+        });
+    }
+}
+
+float VariantGallery::sweepValue(size_t index) const {
+    if (m_settings.sweep == GallerySweep::Seed) {
+        return static_cast<float>(m_variants[index].seed);
+    }
+    return *sweptField(m_variants[index], m_settings.sweep);
+}
+
+void VariantGallery::takeFinished(std::vector<GalleryThumbnail>& out) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (GalleryThumbnail& thumbnail : m_ready) {
+        out.push_back(std::move(thumbnail));
+    }
+    m_ready.clear();
+}
+
+double VariantGallery::fillMilliseconds() const {
+    uint64_t done = m_doneTime.load();
+    return done ? (done - m_startTime) / 1e6 : 0.0;
+}
+
+void VariantGallery::renderThumbnail(uint64_t sweep, size_t index, size_t count, const TerrainParams& params,
+                                     const MaskColors& colors) {
+    if (m_sweep.load() != sweep) {
+        return;
+    }
+    PROFILE_ZONE("VariantGallery::renderThumbnail");
+    TerrainOutlines outlines;
+    TerrainMask mask;
+    buildTerrainOutlines(params, outlines);
+    rasterizeTerrain(outlines, params.width, params.height, mask);
+
+    GalleryThumbnail thumbnail;
+    thumbnail.index = index;
+    thumbnail.width = mask.width;
+    thumbnail.height = mask.height;
+    thumbnail.pixels.resize(mask.cells.size() * 4);
+    for (unsigned int y = 0; y < mask.height; y++) {
+        recolorMaskRow(mask.row(y), thumbnail.pixels.data() + static_cast<size_t>(y) * mask.width * 4,
+                       mask.width, colors);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // A newer sweep may have started while this one rendered
+    if (m_sweep.load() != sweep) {
+        return;
+    }
+    m_ready.push_back(std::move(thumbnail));
+    if (++m_finished == count) {
+        m_doneTime = Profiler::now();
+    }
+}
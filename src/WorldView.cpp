@@ -0,0 +1,73 @@
+#include "../include/WorldView.hpp"
+#include "MaskExport.hpp"
+#include <cmath>
+
+WorldView::WorldView(const WorldSettings& settings, size_t maxChunks)
+    : m_world(settings, maxChunks) {
+}
+
+void WorldView::setCamera(double x, double y) {
+    m_cameraX = x;
+    m_cameraY = y;
+}
+
+void WorldView::draw(sf::RenderTarget& target) {
+    m_frame++;
+    sf::Vector2u size = target.getSize();
+    double right = m_cameraX + size.x;
+    double bottom = m_cameraY + size.y;
+    m_world.prefetch(m_cameraX, m_cameraY, right, bottom, 1);
+
+    uint64_t version = m_world.settingsVersion();
+    ChunkCoord first = m_world.chunkAt(m_cameraX, m_cameraY);
+    ChunkCoord last = m_world.chunkAt(right, bottom);
+    // Same colors as the single terrain view: black terrain, white caves, clear air
+    MaskColors colors;
+    colors.empty = PngWriter::PaletteEntry{0, 0, 0, 0};
+
+    m_visibleChunks = 0;
+    m_missingChunks = 0;
+    for (int32_t cy = first.y; cy <= last.y; cy++) {
+        for (int32_t cx = first.x; cx <= last.x; cx++) {
+            m_visibleChunks++;
+            auto chunk = m_world.tryGetChunk(ChunkCoord{cx, cy});
+            if (!chunk) {
+                m_missingChunks++;
+                continue;
+            }
+
+            const TerrainMask& mask = chunk->mask;
+            uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(cx)) << 32) | static_cast<uint32_t>(cy);
+            ChunkTexture& entry = m_textures[key];
+            if (entry.settingsVersion != chunk->settingsVersion || entry.texture.getSize().x != mask.width) {
+                if (!entry.texture.resize(sf::Vector2u{mask.width, mask.height})) {
+                    continue;
+                }
+                m_pixels.resize(mask.cells.size() * 4);
+                for (unsigned int y = 0; y < mask.height; y++) {
+                    recolorMaskRow(mask.row(y), m_pixels.data() + static_cast<size_t>(y) * mask.width * 4,
+                                   mask.width, colors);
+                }
+                entry.texture.update(m_pixels.data());
+                entry.settingsVersion = chunk->settingsVersion;
+            }
+            entry.lastFrame = m_frame;
+
+            // Offsets from the camera in double, the absolute world position may be huge
+            sf::Sprite sprite(entry.texture);
+            sprite.setPosition(sf::Vector2f(
+                static_cast<float>(static_cast<double>(cx) * mask.width - m_cameraX),
+                static_cast<float>(static_cast<double>(cy) * mask.height - m_cameraY)));
+            target.draw(sprite);
+        }
+    }
+
+    // Textures of chunks that went off screen or are outdated
+    for (auto it = m_textures.begin(); it != m_textures.end();) {
+        if (it->second.lastFrame != m_frame || it->second.settingsVersion != version) {
+            it = m_textures.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
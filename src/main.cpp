@@ -1,8 +1,15 @@
 #include <SFML/Graphics.hpp>
 #include <imgui-SFML.h>
 #include <imgui.h>
+#include <algorithm>
+#include <cstdio>
 #include <iostream>
+#include <random>
+#include <string>
+#include "GalleryView.hpp"
+#include "Profiler.hpp"
 #include "TerrainGenerator.hpp"
+#include "WorldView.hpp"
 
 int main() {
     std::cout << "Starting application...\n";
@@ -19,19 +26,62 @@ int main() {
 
     // Create terrain generator with window size
     TerrainGenerator terrainGen(window.getSize().x, window.getSize().y);
+    // Parameters seen before in this run are served from here. Keeping them on
+    // disk across runs is opt-in from the Terrain Cache panel.
+    auto terrainCache = std::make_shared<TerrainCache>();
+    terrainGen.setCache(terrainCache);
+    char cacheDirectory[512];
+    std::snprintf(cacheDirectory, sizeof(cacheDirectory), "%s",
+                  TerrainCache::userDirectory("cave-generation").c_str());
+    int cacheDiskBudgetMb = 1024;
+    bool cacheOnDisk = false;
+    // PNG exports run here so the UI keeps drawing while they encode
+    ExportQueue exportQueue;
+
+    // Tiled world mode, built from the same shape parameters as the single terrain
+    WorldSettings worldSettings;
+    worldSettings.shape = terrainGen.getShapeParams();
+    WorldView worldView(worldSettings);
+    uint64_t worldShapeGeneration = terrainGen.getGeneration();
+    bool tiledWorld = false;
+
+    // Grid of low-resolution variants; clicking one makes it the terrain
+    GalleryView galleryView;
+    GallerySettings gallerySettings;
+    bool showGallery = false;
+
+    Profiler& profiler = Profiler::instance();
+    profiler.setThreadName("main");
+    // Frame time minus the time display() waits for the frame limit
+    std::vector<float> workTimes(Profiler::FrameHistory, 0.0f);
+    size_t workHead = 0;
+    uint64_t frameStart = Profiler::now();
+    uint64_t displayTime = 0;
     
     sf::Clock deltaClock;
     while (window.isOpen()) {
+        profiler.frameMark();
+        uint64_t frameEnd = Profiler::now();
+        workTimes[workHead] = static_cast<float>((frameEnd - frameStart - displayTime) / 1e6);
+        workHead = (workHead + 1) % workTimes.size();
+        frameStart = frameEnd;
+
         // Handle all events in queue
-        while (const std::optional event = window.pollEvent()) {
-            ImGui::SFML::ProcessEvent(window, *event);
+        {
+            PROFILE_ZONE("Events");
+            while (const std::optional event = window.pollEvent()) {
+                ImGui::SFML::ProcessEvent(window, *event);
 
-            if (event->is<sf::Event::Closed>()) {
-                window.close();
+                if (event->is<sf::Event::Closed>()) {
+                    window.close();
+                }
             }
         }
 
-        ImGui::SFML::Update(window, deltaClock.restart());
+        {
+            PROFILE_ZONE("ImGui::SFML::Update");
+            ImGui::SFML::Update(window, deltaClock.restart());
+        }
 
         // ImGui controls window
         ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_FirstUseEver);
@@ -40,6 +90,15 @@ int main() {
         
         // Basic shape controls
         if (ImGui::CollapsingHeader("Basic Shape")) {
+            int seed = static_cast<int>(terrainGen.getSeed());
+            if (ImGui::InputInt("Seed", &seed)) {
+                terrainGen.setSeed(static_cast<uint32_t>(seed));
+            }
+            ImGui::SameLine();
+            if (ImGui::SmallButton("Random")) {
+                terrainGen.setSeed(std::random_device{}());
+            }
+
             int pointCount = terrainGen.getPointCount();
             if (ImGui::SliderInt("Point Count", &pointCount, 3, 100)) {
                 terrainGen.setPointCount(pointCount);
@@ -67,6 +126,23 @@ int main() {
             if (ImGui::SliderFloat("Noise Amplitude", &amp, 0.0f, 2.0f)) {
                 terrainGen.setNoiseAmplitude(amp);
             }
+
+            const char* bases[] = {"Perlin", "Simplex", "Value"};
+            int basis = static_cast<int>(terrainGen.getNoiseBasis());
+            if (ImGui::Combo("Noise Type", &basis, bases, IM_ARRAYSIZE(bases))) {
+                terrainGen.setNoiseBasis(static_cast<NoiseBasis>(basis));
+            }
+
+            const char* fractals[] = {"fBm", "Ridged"};
+            int fractal = static_cast<int>(terrainGen.getNoiseFractal());
+            if (ImGui::Combo("Fractal", &fractal, fractals, IM_ARRAYSIZE(fractals))) {
+                terrainGen.setNoiseFractal(static_cast<NoiseFractal>(fractal));
+            }
+
+            int octaves = terrainGen.getNoiseOctaves();
+            if (ImGui::SliderInt("Octaves", &octaves, 1, MaxNoiseOctaves)) {
+                terrainGen.setNoiseOctaves(octaves);
+            }
         }
 
         // Blob controls
@@ -91,10 +167,30 @@ int main() {
 
             if (cavesEnabled) {
                 // Global cave parameters
+                const char* placements[] = {"Uniform", "Poisson Disc"};
+                int placement = static_cast<int>(terrainGen.getCavePlacement());
+                if (ImGui::Combo("Placement", &placement, placements, IM_ARRAYSIZE(placements))) {
+                    terrainGen.setCavePlacement(static_cast<CavePlacement>(placement));
+                }
+                if (terrainGen.getCavePlacement() == CavePlacement::PoissonDisc) {
+                    float spacing = terrainGen.getCaveSpacing();
+                    if (ImGui::SliderFloat("Cave Spacing", &spacing, 0.5f, 3.0f)) {
+                        terrainGen.setCaveSpacing(spacing);
+                    }
+                    bool insideBlobs = terrainGen.getCavesInsideBlobs();
+                    if (ImGui::Checkbox("Inside Blobs", &insideBlobs)) {
+                        terrainGen.setCavesInsideBlobs(insideBlobs);
+                    }
+                }
+
                 int caveCount = terrainGen.getCaveCount();
-                if (ImGui::SliderInt("Cave Count", &caveCount, 0, 10)) {
+                if (ImGui::SliderInt("Cave Count", &caveCount, 0, 10000, "%d", ImGuiSliderFlags_Logarithmic)) {
                     terrainGen.setCaveCount(caveCount);
                 }
+                if (terrainGen.getCavePlacement() == CavePlacement::PoissonDisc &&
+                    terrainGen.getPlacedCaveCount() < static_cast<size_t>(caveCount)) {
+                    ImGui::TextDisabled("Room for %zu caves at this spacing", terrainGen.getPlacedCaveCount());
+                }
 
                 int cavePointCount = terrainGen.getCavePointCount();
                 if (ImGui::SliderInt("Cave Point Count", &cavePointCount, 3, 100)) {
@@ -118,8 +214,10 @@ int main() {
 
                 // Individual cave editing
                 if (ImGui::TreeNode("Edit Individual Cave")) {
+                    ImGui::TextDisabled("Right-click a cave to select it");
                     int selectedCave = terrainGen.getSelectedCaveIndex();
-                    if (ImGui::SliderInt("Selected Cave", &selectedCave, -1, caveCount - 1)) {
+                    int lastCave = static_cast<int>(terrainGen.getPlacedCaveCount()) - 1;
+                    if (ImGui::SliderInt("Selected Cave", &selectedCave, -1, lastCave)) {
                         terrainGen.setSelectedCaveIndex(selectedCave);
                     }
 
@@ -141,17 +239,249 @@ int main() {
                         if (ImGui::Button("Regenerate Position")) {
                             terrainGen.regenerateSelectedCavePosition();
                         }
+                        ImGui::SameLine();
+                        if (ImGui::Button("Delete Cave")) {
+                            terrainGen.removeSelectedCave();
+                        }
                     }
                     ImGui::TreePop();
                 }
             }
         }
 
+        // Runtime carving and filling with the mouse
+        static int editMode = 0;
+        static float brushRadius = 24.0f;
+        static float brushRoughness = 0.5f;
+        if (ImGui::CollapsingHeader("Destruction")) {
+            ImGui::RadioButton("Carve", &editMode, 0);
+            ImGui::SameLine();
+            ImGui::RadioButton("Fill", &editMode, 1);
+            ImGui::SliderFloat("Brush Radius", &brushRadius, 2.0f, 150.0f);
+            ImGui::SliderFloat("Brush Roughness", &brushRoughness, 0.0f, 1.5f);
+            ImGui::Text("Edits since last regeneration: %u", terrainGen.getEditCount());
+            ImGui::TextDisabled("Hold the left mouse button on the terrain to edit");
+        }
+
+        if (ImGui::CollapsingHeader("Tiled World")) {
+            ImGui::Checkbox("Show Tiled World", &tiledWorld);
+
+            int seed = static_cast<int>(worldSettings.seed);
+            bool changed = ImGui::InputInt("World Seed", &seed);
+            changed |= ImGui::SliderFloat("Blob Chance", &worldSettings.blobChance, 0.05f, 1.0f);
+            changed |= ImGui::SliderInt("Caves per Blob", &worldSettings.cavesPerBlob, 0, MaxWorldCavesPerBlob);
+            if (changed) {
+                worldSettings.seed = static_cast<uint32_t>(seed);
+                worldView.world().setSettings(worldSettings);
+            }
+
+            ImGui::Text("Camera: %.0f, %.0f", worldView.getCameraX(), worldView.getCameraY());
+            ImGui::SameLine();
+            if (ImGui::SmallButton("Reset Camera")) {
+                worldView.setCamera(0.0, 0.0);
+            }
+            const ChunkedWorld& world = worldView.world();
+            ImGui::Text("Chunks: %zu cached of %zu, %zu pending", world.cachedCount(), world.maxChunks(), world.pendingCount());
+            ImGui::Text("Chunk memory: %.1f MB, %zu textures", world.memoryBytes() / (1024.0 * 1024.0), worldView.getTextureCount());
+            ImGui::TextDisabled("Drag with the left mouse button to pan");
+        }
+
+        if (ImGui::CollapsingHeader("Rendering")) {
+            const char* backends[] = {"CPU scanline", "GPU render texture"};
+            int backend = static_cast<int>(terrainGen.getRenderBackend());
+            if (ImGui::Combo("Rasterizer", &backend, backends, IM_ARRAYSIZE(backends))) {
+                terrainGen.setRenderBackend(static_cast<TerrainGenerator::RenderBackend>(backend));
+            }
+
+            const auto& counters = terrainGen.getRenderCounters();
+            ImGui::Text("Polygons: %zu (%zu outline points)", counters.polygons, counters.outlinePoints);
+            ImGui::Text("Caves tessellated: %zu", counters.tessellatedCaves);
+            ImGui::Text("Vertices: %zu in %zu draw call(s)", counters.vertices, counters.drawCalls);
+
+            auto background = terrainGen.getBackgroundStats();
+            bool backgroundEnabled = background.enabled;
+            if (ImGui::Checkbox("Background Generation", &backgroundEnabled)) {
+                terrainGen.setBackgroundGeneration(backgroundEnabled);
+            }
+            if (background.enabled) {
+                ImGui::Text("Last build %.2f ms%s", background.milliseconds, background.busy ? ", building..." : "");
+                ImGui::Text("Requests: %llu, %llu skipped for newer ones",
+                    static_cast<unsigned long long>(background.requests),
+                    static_cast<unsigned long long>(background.skipped));
+            }
+
+            // Low resolution previews while dragging, refined once input settles
+            auto progressive = terrainGen.getProgressiveSettings();
+            bool progressiveChanged = ImGui::Checkbox("Progressive Preview", &progressive.enabled);
+            if (progressive.enabled) {
+                progressiveChanged |= ImGui::SliderFloat("Preview Scale", &progressive.previewScale, 0.0625f, 0.5f, "%.3f");
+                progressiveChanged |= ImGui::SliderFloat("Refine After (s)", &progressive.idleSeconds, 0.0f, 1.0f, "%.2f");
+            }
+            if (progressiveChanged) {
+                terrainGen.setProgressiveSettings(progressive);
+            }
+            if (ImGui::BeginTable("Stages", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+                ImGui::TableSetupColumn("Stage scale");
+                ImGui::TableSetupColumn("build ms");
+                ImGui::TableSetupColumn("upload ms");
+                ImGui::TableHeadersRow();
+                for (const auto& stage : terrainGen.getStageStats()) {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.3f", stage.scale);
+                    ImGui::TableNextColumn();
+                    if (stage.generation > 0) {
+                        ImGui::Text(stage.fromCache ? "%.2f (cached)" : "%.2f", stage.buildMilliseconds);
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%.2f", stage.uploadMilliseconds);
+                    } else {
+                        ImGui::TextDisabled("-");
+                        ImGui::TableNextColumn();
+                        ImGui::TextDisabled("-");
+                    }
+                }
+                ImGui::EndTable();
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Terrain Cache")) {
+            TerrainCache::Stats cacheStats = terrainCache->stats();
+            ImGui::Text("Hits: %llu memory, %llu disk", static_cast<unsigned long long>(cacheStats.memoryHits),
+                        static_cast<unsigned long long>(cacheStats.diskHits));
+            ImGui::Text("Misses: %llu, evictions: %llu", static_cast<unsigned long long>(cacheStats.misses),
+                        static_cast<unsigned long long>(cacheStats.evictions));
+            ImGui::Text("Memory: %zu terrains, %.1f MB", cacheStats.memoryEntries,
+                        cacheStats.memoryBytes / (1024.0 * 1024.0));
+            if (cacheOnDisk) {
+                ImGui::Text("Disk: %llu files, %.1f MB in %s", static_cast<unsigned long long>(cacheStats.diskFiles),
+                            cacheStats.diskBytes / (1024.0 * 1024.0), terrainCache->directory().c_str());
+            } else {
+                ImGui::TextDisabled("Disk: off, memory only");
+            }
+            ImGui::TextDisabled("Current key %s", TerrainCache::keyString(terrainGen.getRenderedKey()).c_str());
+            if (ImGui::Button("Clear Memory")) {
+                terrainCache->clear(false);
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Clear Disk")) {
+                terrainCache->clear(true);
+            }
+
+            // Changing any of these starts a fresh cache; files already on disk are found again
+            bool rebuildCache = ImGui::Checkbox("Keep on Disk", &cacheOnDisk);
+            ImGui::InputText("Directory", cacheDirectory, IM_ARRAYSIZE(cacheDirectory));
+            if (ImGui::IsItemDeactivatedAfterEdit()) {
+                rebuildCache = cacheOnDisk;
+            }
+            ImGui::SliderInt("Disk Budget (MB)", &cacheDiskBudgetMb, 64, 8192);
+            if (ImGui::IsItemDeactivatedAfterEdit()) {
+                rebuildCache = cacheOnDisk;
+            }
+            if (cacheOnDisk && cacheDirectory[0] == '\0') {
+                cacheOnDisk = false;  // No per-user directory found and none typed in
+            }
+            if (rebuildCache) {
+                terrainCache = std::make_shared<TerrainCache>(
+                    cacheOnDisk ? std::string(cacheDirectory) : std::string(), 256u << 20,
+                    static_cast<uint64_t>(cacheDiskBudgetMb) << 20);
+                terrainGen.setCache(terrainCache);
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Gallery")) {
+            // In GallerySweep order, with the range of the matching slider
+            const char* sweeps[] = {"Seed", "Noise Frequency", "Noise Amplitude", "Blob Spacing",
+                                    "Horizontal Stretch", "Cave Scale", "Cave Noise Frequency",
+                                    "Cave Noise Amplitude"};
+            const float sweepMin[] = {0.0f, 0.1f, 0.0f, 0.5f, 0.1f, 0.1f, 0.1f, 0.0f};
+            const float sweepMax[] = {0.0f, 5.0f, 2.0f, 3.0f, 3.0f, 1.0f, 5.0f, 2.0f};
+            int sweep = static_cast<int>(gallerySettings.sweep);
+            if (ImGui::Combo("Sweep", &sweep, sweeps, IM_ARRAYSIZE(sweeps))) {
+                gallerySettings.sweep = static_cast<GallerySweep>(sweep);
+                gallerySettings.from = sweepMin[sweep];
+                gallerySettings.to = sweepMax[sweep];
+            }
+            if (gallerySettings.sweep == GallerySweep::Seed) {
+                ImGui::TextDisabled("Seeds %u and up", terrainGen.getSeed());
+            } else {
+                ImGui::DragFloatRange2("Range", &gallerySettings.from, &gallerySettings.to, 0.01f,
+                                       sweepMin[sweep], sweepMax[sweep]);
+            }
+            int count = static_cast<int>(gallerySettings.count);
+            if (ImGui::SliderInt("Variants", &count, 8, 128)) {
+                gallerySettings.count = static_cast<unsigned int>(count);
+            }
+            int thumbnailWidth = static_cast<int>(gallerySettings.thumbnailWidth);
+            if (ImGui::SliderInt("Thumbnail Width", &thumbnailWidth, 64, 320)) {
+                gallerySettings.thumbnailWidth = static_cast<unsigned int>(thumbnailWidth);
+            }
+            if (ImGui::Button("Generate Gallery")) {
+                galleryView.generate(terrainGen.getParams(), gallerySettings);
+                showGallery = true;
+            }
+
+            const VariantGallery& gallery = galleryView.gallery();
+            if (gallery.size() > 0) {
+                if (gallery.isComplete()) {
+                    ImGui::Text("%zu variants in %.1f ms", gallery.size(), gallery.fillMilliseconds());
+                } else {
+                    ImGui::Text("%zu / %zu variants", gallery.finishedCount(), gallery.size());
+                }
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Physics Contours")) {
+            static float tolerance = 1.0f;
+            ImGui::SliderFloat("Simplify Tolerance", &tolerance, 0.0f, 10.0f);
+
+            // Re-extracted when the terrain or the tolerance changed, edits
+            // re-trace only their tiles
+            const auto& contours = terrainGen.getContours(tolerance);
+            const auto& contourStats = terrainGen.getContourStats();
+            ImGui::Text("Loops: %zu (%zu holes)", contours.loopCount(), contours.holeCount());
+            ImGui::Text("Vertices: %zu (%zu before simplification)", contours.pointCount(), contourStats.rawPoints);
+            ImGui::Text("Extracted in %.2f ms, traced %zu of %zu tiles", contourStats.milliseconds,
+                        contourStats.tracedTiles, contourStats.tiles);
+            if (ImGui::Button("Export Contours")) {
+                if (terrainGen.saveContours("terrain.contours", tolerance)) {
+                    ImGui::OpenPopup("Contours Saved");
+                }
+            }
+            if (ImGui::BeginPopupModal("Contours Saved", nullptr, ImGuiWindowFlags_AlwaysAutoResize)) {
+                ImGui::Text("Contours written to terrain.contours");
+                if (ImGui::Button("OK")) {
+                    ImGui::CloseCurrentPopup();
+                }
+                ImGui::EndPopup();
+            }
+        }
+
         if (ImGui::CollapsingHeader("Terrain Statistics")) {
-            auto stats = terrainGen.calculateStats();
+            static int statsMode = 0;
+            const char* statsModes[] = {"Exact", "Fast estimate"};
+            ImGui::Combo("Mode", &statsMode, statsModes, IM_ARRAYSIZE(statsModes));
+
+            auto stats = terrainGen.calculateStats(static_cast<TerrainGenerator::StatsMode>(statsMode));
             ImGui::Text("Visible Terrain Pixels: %u", stats.visibleTerrainPixels);
             ImGui::Text("Terrain Coverage: %.1f%%", stats.terrainCoverage);
             ImGui::ProgressBar(stats.terrainCoverage / 100.0f);
+            if (stats.estimateFallback) {
+                ImGui::Text("Estimate gave up after %.3f ms (too much overlap)", stats.milliseconds);
+                ImGui::Text("Counted exactly in %.3f ms (%s)", stats.fallbackMilliseconds,
+                    stats.fromRaster ? "mask count" : "outline spans");
+            } else {
+                ImGui::Text("Computed in %.3f ms (%s)", stats.milliseconds,
+                    stats.edits > 0 ? "running count" : stats.fromRaster ? "mask count" : stats.exact ? "outline spans" : "outline geometry");
+            }
+            if (stats.edits > 0) {
+                ImGui::TextDisabled("Includes %u edit(s), updated incrementally", stats.edits);
+            }
+            const SpanMask& spans = terrainGen.getSpanMask();
+            ImGui::Text("Spans: %zu, %.1f KB (bitmap %.1f KB)", spans.spanCount(), spans.memoryBytes() / 1024.0,
+                        terrainGen.getBitmap().memoryBytes() / 1024.0);
+            ImGui::TextDisabled("Generation %llu (current %llu)",
+                static_cast<unsigned long long>(stats.generation),
+                static_cast<unsigned long long>(terrainGen.getGeneration()));
         }
 
         // Export controls
@@ -183,7 +513,97 @@ int main() {
             }
             
             if (ImGui::Button("Save Terrain")) {
-                if (terrainGen.saveToFile(filename, exportSettings)) {
+                terrainGen.saveToFileAsync(exportQueue, filename, exportSettings);
+            }
+            
+            ImGui::SameLine();
+            if (ImGui::Button("Save Parameters")) {
+                // Same key = value format terrain-batch reads
+                if (saveTerrainParams("terrain.params", terrainGen.getParams())) {
+                    ImGui::OpenPopup("Save Success");
+                } else {
+                    ImGui::OpenPopup("Save Failed");
+                }
+            }
+            
+            // Print and minimap sizes, generated band by band without a full-size image
+            static float exportScale = 8.0f;
+            ImGui::SliderFloat("Large Export Scale", &exportScale, 1.0f, 32.0f, "%.1fx");
+            ImGui::SameLine();
+            ImGui::TextDisabled("(?)");
+            if (ImGui::IsItemHovered()) {
+                ImGui::BeginTooltip();
+                ImGui::Text("Regenerates the terrain at %.0f x %.0f with a fixed memory budget.\n"
+                           "Runtime edits are not included.",
+                           terrainGen.getShapeParams().width * exportScale, terrainGen.getShapeParams().height * exportScale);
+                ImGui::EndTooltip();
+            }
+            if (ImGui::Button("Save Large Terrain")) {
+                terrainGen.saveLargeToFileAsync(exportQueue, filename, exportScale, exportSettings);
+            }
+            
+            // Background exports
+            auto jobs = exportQueue.jobs();
+            for (const auto& job : jobs) {
+                ImGui::PushID(static_cast<int>(job.id));
+                switch (job.state) {
+                case ExportQueue::JobState::Queued:
+                case ExportQueue::JobState::Running:
+                    ImGui::ProgressBar(job.progress, ImVec2(150, 0));
+                    ImGui::SameLine();
+                    if (ImGui::SmallButton("Cancel")) {
+                        exportQueue.cancel(job.id);
+                    }
+                    ImGui::SameLine();
+                    ImGui::Text("%s%s", job.filename.c_str(),
+                        job.state == ExportQueue::JobState::Queued ? " (queued)" : "");
+                    break;
+                case ExportQueue::JobState::Done:
+                    ImGui::Text("Saved %s in %.0f ms", job.filename.c_str(), job.milliseconds);
+                    break;
+                case ExportQueue::JobState::Failed:
+                    ImGui::Text("Failed %s: %s", job.filename.c_str(), job.error.c_str());
+                    break;
+                case ExportQueue::JobState::Cancelled:
+                    ImGui::TextDisabled("Cancelled %s", job.filename.c_str());
+                    break;
+                }
+                ImGui::PopID();
+            }
+            if (!jobs.empty() && jobs.size() > exportQueue.activeCount()) {
+                if (ImGui::SmallButton("Clear Finished")) {
+                    exportQueue.clearFinished();
+                }
+            }
+            
+            // Signed distance field export
+            static char sdfFilename[128] = "terrain_sdf.png";
+            static int sdfFormat = static_cast<int>(DistanceFieldFormat::Gray16);
+            static float sdfRange = 32.0f;
+            const char* sdfFormats[] = {"Float32 (raw)", "8-bit PNG", "16-bit PNG"};
+            ImGui::Separator();
+            ImGui::InputText("SDF Filename", sdfFilename, IM_ARRAYSIZE(sdfFilename));
+            ImGui::Combo("SDF Format", &sdfFormat, sdfFormats, IM_ARRAYSIZE(sdfFormats));
+            ImGui::SliderFloat("SDF Range (px)", &sdfRange, 1.0f, 256.0f);
+            if (ImGui::Button("Save Distance Field")) {
+                if (terrainGen.saveDistanceField(sdfFilename, static_cast<DistanceFieldFormat>(sdfFormat), sdfRange)) {
+                    ImGui::OpenPopup("Save Success");
+                } else {
+                    ImGui::OpenPopup("Save Failed");
+                }
+            }
+            
+            // Native format, memory-mapped by the game instead of decoding a PNG
+            static char terrainFilename[128] = "terrain.terrain";
+            static bool terrainWithSdf = true;
+            static bool terrainWithContours = true;
+            ImGui::Separator();
+            ImGui::InputText("Terrain File", terrainFilename, IM_ARRAYSIZE(terrainFilename));
+            ImGui::Checkbox("Distance Field", &terrainWithSdf);
+            ImGui::SameLine();
+            ImGui::Checkbox("Contours", &terrainWithContours);
+            if (ImGui::Button("Save .terrain")) {
+                if (terrainGen.saveTerrainFile(terrainFilename, terrainWithSdf, terrainWithContours)) {
                     ImGui::OpenPopup("Save Success");
                 } else {
                     ImGui::OpenPopup("Save Failed");
@@ -210,21 +630,211 @@ int main() {
 
         ImGui::End();
 
+        if (showGallery) {
+            PROFILE_ZONE("Gallery");
+            galleryView.update();
+            ImGui::SetNextWindowPos(ImVec2(320, 10), ImGuiCond_FirstUseEver);
+            ImGui::SetNextWindowSize(ImVec2(640, 420), ImGuiCond_FirstUseEver);
+            ImGui::Begin("Gallery", &showGallery);
+            const VariantGallery& gallery = galleryView.gallery();
+            // Cells shrink or grow to fit the window width, keeping the canvas aspect
+            sf::Vector2u cell = galleryView.cellSize();
+            float spacing = ImGui::GetStyle().ItemSpacing.x + ImGui::GetStyle().FramePadding.x * 2.0f;
+            float width = (ImGui::GetContentRegionAvail().x - spacing * galleryView.columns()) / galleryView.columns();
+            width = std::max(width, 16.0f);
+            sf::Vector2f size(width, cell.x > 0 ? width * cell.y / cell.x : width);
+            for (size_t i = 0; i < gallery.size(); i++) {
+                if (i % galleryView.columns() != 0) {
+                    ImGui::SameLine();
+                }
+                char id[32];
+                std::snprintf(id, sizeof(id), "##variant%zu", i);
+                if (!galleryView.isReady(i)) {
+                    ImGui::Button(id, ImVec2(size.x + ImGui::GetStyle().FramePadding.x * 2.0f,
+                                             size.y + ImGui::GetStyle().FramePadding.y * 2.0f));
+                    continue;
+                }
+                if (ImGui::ImageButton(id, galleryView.sprite(i), size)) {
+                    terrainGen.setParams(gallery.variant(i));
+                }
+                if (ImGui::IsItemHovered()) {
+                    if (gallery.settings().sweep == GallerySweep::Seed) {
+                        ImGui::SetTooltip("Seed %u", gallery.variant(i).seed);
+                    } else {
+                        ImGui::SetTooltip("%.3f", gallery.sweepValue(i));
+                    }
+                }
+            }
+            ImGui::End();
+        }
+
+        ImGui::SetNextWindowPos(ImVec2(960, 10), ImGuiCond_FirstUseEver);
+        ImGui::SetNextWindowSize(ImVec2(310, 460), ImGuiCond_FirstUseEver);
+        ImGui::Begin("Performance");
+        {
+            bool recording = Profiler::enabled();
+            if (ImGui::Checkbox("Record Zones", &recording)) {
+                Profiler::setEnabled(recording);
+            }
+
+            std::vector<float> frames = profiler.frameTimes();
+            float average = 0.0f;
+            float worst = 0.0f;
+            for (float ms : frames) {
+                average += ms;
+                worst = std::max(worst, ms);
+            }
+            average = frames.empty() ? 0.0f : average / frames.size();
+            char overlay[64];
+            std::snprintf(overlay, sizeof(overlay), "%.2f ms avg, %.2f max", average, worst);
+            ImGui::Text("Frame time (%.0f FPS)", average > 0.0f ? 1000.0f / average : 0.0f);
+            ImGui::PlotLines("##Frame", frames.data(), static_cast<int>(frames.size()), 0, overlay,
+                             0.0f, std::max(33.3f, worst), ImVec2(0, 70));
+
+            // Same scale as the frame graph, so the gap between the two is idle time
+            float worstWork = *std::max_element(workTimes.begin(), workTimes.end());
+            std::snprintf(overlay, sizeof(overlay), "%.2f ms max", worstWork);
+            ImGui::Text("CPU work (without the frame limit wait)");
+            ImGui::PlotLines("##Work", workTimes.data(), static_cast<int>(workTimes.size()), static_cast<int>(workHead),
+                             overlay, 0.0f, std::max(33.3f, worst), ImVec2(0, 70));
+
+            static float summarySeconds = 1.0f;
+            ImGui::SliderFloat("Window (s)", &summarySeconds, 0.25f, 10.0f);
+            Profiler::Summary summary = profiler.summarize(summarySeconds);
+            if (summary.zones.empty()) {
+                ImGui::TextDisabled(recording ? "No zones recorded yet" : "Zones are not being recorded");
+            } else if (ImGui::BeginTable("Zones", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+                ImGui::TableSetupColumn("Zone");
+                ImGui::TableSetupColumn("ms/frame");
+                ImGui::TableSetupColumn("max ms");
+                ImGui::TableSetupColumn("calls");
+                ImGui::TableHeadersRow();
+                for (const auto& zone : summary.zones) {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%s", zone.name.c_str());
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.3f", zone.totalMs / std::max(1u, summary.frames));
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.3f", zone.maxMs);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%u", zone.calls);
+                }
+                ImGui::EndTable();
+            }
+
+            static char traceFilename[128] = "terrain_trace.json";
+            static int traceSeconds = 5;
+            static std::string traceMessage;
+            ImGui::Separator();
+            ImGui::InputText("Trace File", traceFilename, IM_ARRAYSIZE(traceFilename));
+            ImGui::SliderInt("Trace Seconds", &traceSeconds, 1, 30);
+            if (ImGui::Button("Dump Chrome Trace")) {
+                std::string error;
+                if (profiler.writeChromeTrace(traceFilename, traceSeconds, &error)) {
+                    traceMessage = std::string("Wrote ") + traceFilename;
+                } else {
+                    traceMessage = "Trace failed: " + error;
+                }
+            }
+            if (!traceMessage.empty()) {
+                ImGui::TextWrapped("%s", traceMessage.c_str());
+            }
+            ImGui::TextDisabled("Open in chrome://tracing or ui.perfetto.dev");
+        }
+        ImGui::End();
+
+        // Shape sliders apply to the tiled world as well. Cached chunks are
+        // dropped only when a field they are built from changed.
+        if (terrainGen.getGeneration() != worldShapeGeneration) {
+            worldShapeGeneration = terrainGen.getGeneration();
+            TerrainParams shape = terrainGen.getShapeParams();
+            if (!sameWorldShape(shape, worldSettings.shape)) {
+                worldSettings.shape = shape;
+                worldView.world().setSettings(worldSettings);
+            }
+        }
+
+        if (!tiledWorld && !ImGui::GetIO().WantCaptureMouse && ImGui::IsMouseDown(ImGuiMouseButton_Left)) {
+            PROFILE_ZONE("Terrain edit");
+            // Same placement as the sprite below
+            const sf::Texture& terrain = terrainGen.generateTerrain();
+            float scale = terrainGen.getDisplayScale();
+            ImVec2 mouse = ImGui::GetIO().MousePos;
+            sf::Vector2f center(
+                mouse.x - (window.getSize().x - terrain.getSize().x * scale) / 2.0f,
+                mouse.y - (window.getSize().y - terrain.getSize().y * scale) / 2.0f);
+            if (editMode == 0) {
+                terrainGen.carve(center, brushRadius, brushRoughness);
+            } else {
+                terrainGen.fill(center, brushRadius, brushRoughness);
+            }
+        }
+
+        if (!tiledWorld && !ImGui::GetIO().WantCaptureMouse && ImGui::IsMouseClicked(ImGuiMouseButton_Right)) {
+            // Same placement as the sprite below
+            const sf::Texture& terrain = terrainGen.generateTerrain();
+            float scale = terrainGen.getDisplayScale();
+            ImVec2 mouse = ImGui::GetIO().MousePos;
+            sf::Vector2f position(
+                mouse.x - (window.getSize().x - terrain.getSize().x * scale) / 2.0f,
+                mouse.y - (window.getSize().y - terrain.getSize().y * scale) / 2.0f);
+            terrainGen.setSelectedCaveIndex(terrainGen.findCaveAt(position));
+        }
+
+        if (tiledWorld && !ImGui::GetIO().WantCaptureMouse && ImGui::IsMouseDragging(ImGuiMouseButton_Left)) {
+            ImVec2 delta = ImGui::GetMouseDragDelta(ImGuiMouseButton_Left);
+            worldView.pan(-delta.x, -delta.y);
+            ImGui::ResetMouseDragDelta(ImGuiMouseButton_Left);
+        }
+
         // Render
         window.clear(sf::Color::White);
         
-        // Draw terrain - center it in window
-        sf::RenderTexture& terrain = terrainGen.generateTerrain();
-        sf::Sprite terrainSprite(terrain.getTexture());
-        // Center the sprite using Vector2f
-        terrainSprite.setPosition(sf::Vector2f(
-            (window.getSize().x - terrain.getSize().x) / 2.0f,
-            (window.getSize().y - terrain.getSize().y) / 2.0f
-        ));
-        window.draw(terrainSprite);
+        if (tiledWorld) {
+            PROFILE_ZONE("WorldView::draw");
+            worldView.draw(window);
+        } else {
+            PROFILE_ZONE("Draw terrain");
+            // Draw terrain - center it in window. Only re-renders after a parameter change.
+            const sf::Texture& terrain = terrainGen.generateTerrain();
+            // Previews are smaller than the terrain and get scaled up to its size
+            float scale = terrainGen.getDisplayScale();
+            sf::Sprite terrainSprite(terrain);
+            terrainSprite.setScale(sf::Vector2f(scale, scale));
+            // Center the sprite using Vector2f
+            terrainSprite.setPosition(sf::Vector2f(
+                (window.getSize().x - terrain.getSize().x * scale) / 2.0f,
+                (window.getSize().y - terrain.getSize().y * scale) / 2.0f
+            ));
+            window.draw(terrainSprite);
+
+            // Ring around the selected cave, at its nominal radius
+            if (terrainGen.getCavesEnabled() && terrainGen.getSelectedCaveIndex() >= 0) {
+                auto cave = terrainGen.getSelectedCaveProperties();
+                float radius = terrainGen.getBaseRadius() * terrainGen.getCaveScale() * cave.scaleVariant;
+                sf::CircleShape ring(radius);
+                ring.setOrigin(sf::Vector2f(radius, radius));
+                ring.setPosition(terrainSprite.getPosition() + cave.position);
+                ring.setFillColor(sf::Color::Transparent);
+                ring.setOutlineColor(sf::Color::Red);
+                ring.setOutlineThickness(2.0f);
+                window.draw(ring);
+            }
+        }
         
-        ImGui::SFML::Render(window);
-        window.display();
+        {
+            PROFILE_ZONE("ImGui::SFML::Render");
+            ImGui::SFML::Render(window);
+        }
+
+        // display() also sleeps for the frame limit
+        uint64_t displayStart = Profiler::now();
+        {
+            PROFILE_ZONE("window.display");
+            window.display();
+        }
+        displayTime = Profiler::now() - displayStart;
     }
 
     ImGui::SFML::Shutdown();
@@ -0,0 +1,238 @@
+// Headless batch generator: renders one terrain per seed across all cores
+// and writes each as an indexed PNG and/or a raw mask file. Terrains are
+// rasterized band by band straight into the files, so any size fits in the
+// memory budget. With a cache directory, reruns copy earlier outputs instead.
+#include "BandedExport.hpp"
+#include "TerrainCache.hpp"
+#include "TerrainParams.hpp"
+#include "ThreadPool.hpp"
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+
+namespace {
+
+struct BatchOptions {
+    std::string paramsFile;
+    uint32_t firstSeed{0};
+    uint32_t lastSeed{0};
+    std::string outputDir{"terrains"};
+    bool writePngFiles{true};
+    bool writeMaskFiles{false};
+    unsigned int threads{0};
+    size_t memoryMegabytes{256};  // Band buffers of all workers together
+    std::string cacheDir;
+    uint64_t cacheMegabytes{4096};
+};
+
+// Everything one worker needs to produce a terrain; reused for every seed it
+// handles, so memory stays at one band per worker however long the batch is
+struct WorkerScratch {
+    TerrainParams params;
+    TerrainOutlines outlines;
+};
+
+void printUsage() {
+    std::cout << "Usage: terrain-batch <params-file> <first-seed> <last-seed> [options]\n"
+              << "  --out <dir>        Output directory (default: terrains)\n"
+              << "  --format <fmt>     png, mask or both (default: png)\n"
+              << "  --threads <n>      Worker threads, up to 1024 (default: all cores)\n"
+              << "  --memory <MB>      Band buffer budget across all threads (default: 256)\n"
+              << "  --cache <dir>      Reuse outputs of earlier runs with the same parameters\n"
+              << "  --cache-size <MB>  Disk budget of the cache (default: 4096)\n";
+}
+
+// Whole decimal number in [0, max]; signs, trailing text and overflow are rejected
+bool parseUnsigned(const std::string& text, uint64_t max, uint64_t& value) {
+    if (text.empty() || text[0] < '0' || text[0] > '9') {
+        return false;
+    }
+    errno = 0;
+    char* end = nullptr;
+    unsigned long long parsed = std::strtoull(text.c_str(), &end, 10);
+    if (end == text.c_str() || *end != '\0' || errno == ERANGE || parsed > max) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+bool parseArguments(int argc, char** argv, BatchOptions& options) {
+    if (argc < 4) {
+        return false;
+    }
+    options.paramsFile = argv[1];
+    uint64_t firstSeed = 0;
+    uint64_t lastSeed = 0;
+    if (!parseUnsigned(argv[2], UINT32_MAX, firstSeed) || !parseUnsigned(argv[3], UINT32_MAX, lastSeed) ||
+        lastSeed < firstSeed) {
+        return false;
+    }
+    options.firstSeed = static_cast<uint32_t>(firstSeed);
+    options.lastSeed = static_cast<uint32_t>(lastSeed);
+
+    for (int i = 4; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        uint64_t number = 0;
+        if (arg == "--out") {
+            options.outputDir = value;
+        } else if (arg == "--format") {
+            options.writePngFiles = value == "png" || value == "both";
+            options.writeMaskFiles = value == "mask" || value == "both";
+            if (!options.writePngFiles && !options.writeMaskFiles) {
+                return false;
+            }
+        } else if (arg == "--threads") {
+            if (!parseUnsigned(value, 1024, number)) {
+                return false;
+            }
+            options.threads = static_cast<unsigned int>(number);
+        } else if (arg == "--cache") {
+            options.cacheDir = value;
+        } else if (arg == "--cache-size") {
+            // Shifted to bytes later, so it has to fit after that
+            if (!parseUnsigned(value, UINT64_MAX >> 20, number)) {
+                return false;
+            }
+            options.cacheMegabytes = number;
+        } else if (arg == "--memory") {
+            if (!parseUnsigned(value, SIZE_MAX >> 20, number) || number == 0) {
+                return false;
+            }
+            options.memoryMegabytes = static_cast<size_t>(number);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Copies a cached output into place; an output that is not wanted counts as copied
+bool copyFromCache(TerrainCache& cache, uint64_t key, const std::string& extension, const std::string& target,
+                   std::atomic<uint64_t>& bytesWritten) {
+    if (target.empty()) {
+        return true;
+    }
+    std::string source;
+    if (!cache.findFile(key, extension, source)) {
+        return false;
+    }
+    std::error_code ec;
+    if (!std::filesystem::copy_file(source, target, std::filesystem::copy_options::overwrite_existing, ec)) {
+        return false;
+    }
+    bytesWritten += std::filesystem::file_size(target, ec);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BatchOptions options;
+    if (!parseArguments(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+
+    TerrainParams baseParams;
+    std::string error;
+    if (!loadTerrainParams(options.paramsFile, baseParams, error)) {
+        std::cerr << "terrain-batch: " << error << "\n";
+        return 1;
+    }
+    if (baseParams.baseRadius == 0) {
+        baseParams.baseRadius = std::min(baseParams.width, baseParams.height) / 3;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(options.outputDir, ec);
+    if (ec) {
+        std::cerr << "terrain-batch: cannot create " << options.outputDir << ": " << ec.message() << "\n";
+        return 1;
+    }
+
+    MaskColors colors;
+    colors.empty = {255, 255, 255, 0};  // Transparent background
+
+    std::unique_ptr<TerrainCache> cache;
+    if (!options.cacheDir.empty()) {
+        cache = std::make_unique<TerrainCache>(options.cacheDir, 0, options.cacheMegabytes << 20);
+    }
+
+    ThreadPool pool(options.threads);
+    size_t workerBudget = options.memoryMegabytes * (1u << 20) / pool.size();
+    std::atomic<uint64_t> bytesWritten{0};
+    std::atomic<size_t> failures{0};
+    std::atomic<size_t> cached{0};
+    size_t seedCount = static_cast<size_t>(options.lastSeed - options.firstSeed) + 1;
+
+    auto start = std::chrono::steady_clock::now();
+    pool.parallelFor(0, seedCount, 1, [&](size_t begin, size_t end) {
+        thread_local WorkerScratch scratch;
+        for (size_t i = begin; i < end; i++) {
+            uint32_t seed = options.firstSeed + static_cast<uint32_t>(i);
+            scratch.params = baseParams;
+            placeCaves(scratch.params, seed);
+
+            std::string stem = options.outputDir + "/terrain_" + std::to_string(seed);
+            BandedExportOptions output;
+            output.pngFile = options.writePngFiles ? stem + ".png" : std::string();
+            output.maskFile = options.writeMaskFiles ? stem + ".mask" : std::string();
+            output.colors = colors;
+            output.memoryBudget = workerBudget;
+
+            // PNGs depend on the colors as well, masks only on the parameters
+            uint64_t maskKey = terrainParamsHash(scratch.params);
+            uint64_t pngKey = TerrainCache::deriveKey(maskKey, &colors, sizeof(colors));
+            if (cache && copyFromCache(*cache, pngKey, ".png", output.pngFile, bytesWritten) &&
+                copyFromCache(*cache, maskKey, ".mask", output.maskFile, bytesWritten)) {
+                cached++;
+                continue;
+            }
+
+            buildTerrainOutlines(scratch.params, scratch.outlines);
+            BandedExportStats stats;
+            std::string exportError;
+            if (exportTerrainBanded(scratch.outlines, scratch.params.width, scratch.params.height, output,
+                                    &stats, nullptr, nullptr, &exportError)) {
+                bytesWritten += stats.bytesWritten;
+                if (cache && !output.pngFile.empty()) {
+                    cache->storeFile(pngKey, ".png", output.pngFile);
+                }
+                if (cache && !output.maskFile.empty()) {
+                    cache->storeFile(maskKey, ".mask", output.maskFile);
+                }
+            } else {
+                std::cerr << "terrain-batch: seed " << seed << ": " << exportError << "\n";
+                failures++;
+            }
+        }
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double megabytes = bytesWritten.load() / (1024.0 * 1024.0);
+    std::cout << "Generated " << seedCount << " terrains (" << baseParams.width << "x" << baseParams.height
+              << ") on " << pool.size() << " threads in " << seconds << " s\n"
+              << "  " << seedCount / seconds << " terrains/s, "
+              << megabytes / seconds << " MB/s written (" << megabytes << " MB total)\n";
+    if (cache) {
+        TerrainCache::Stats stats = cache->stats();
+        std::cout << "  " << cached.load() << " from cache (" << stats.diskHits << " hits, " << stats.misses
+                  << " misses, " << stats.diskBytes / (1024 * 1024) << " MB cached)\n";
+    }
+    if (failures > 0) {
+        std::cerr << "terrain-batch: " << failures.load() << " terrains failed to write\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,430 @@
+// Headless benchmarks for the generation pipeline. Every case runs the
+// terrain_core code behind a TerrainGenerator entry point, so the suite
+// needs neither a display nor a GPU. Results go to JSON for diffing runs.
+#include "CavePlacement.hpp"
+#include "MaskExport.hpp"
+#include "MaskRasterizer.hpp"
+#include "Noise.hpp"
+#include "NoisePolicies.hpp"
+#include "SpanMask.hpp"
+#include "TerrainBitmap.hpp"
+#include "TerrainCoverage.hpp"
+#include "TerrainOutline.hpp"
+#include "TerrainParams.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct BenchOptions {
+    std::string outputFile{"terrain_bench.json"};
+    std::string filter;
+    double minMilliseconds{300.0};
+    bool quick{false};
+};
+
+struct BenchResult {
+    std::string name;
+    std::vector<std::pair<std::string, std::string>> params;
+    size_t iterations{0};
+    double medianNs{0.0};
+    double minNs{0.0};
+    double meanNs{0.0};
+    double items{0.0};          // Work items per iteration, for the throughput column
+    std::string itemUnit;
+};
+
+struct Resolution {
+    const char* name;
+    unsigned int width;
+    unsigned int height;
+};
+
+// Keeps results alive so the optimizer cannot drop the measured work
+volatile uint64_t g_sink = 0;
+
+void printUsage() {
+    std::cout << "Usage: terrain_bench [options]\n"
+              << "  --out <file>       JSON output (default: terrain_bench.json)\n"
+              << "  --filter <text>    Only run cases whose name contains text\n"
+              << "  --min-time <ms>    Minimum measuring time per case (default: 300)\n"
+              << "  --quick            Small sizes only, for CI smoke runs\n";
+}
+
+// Finite decimal number >= 0; signs, NaN, infinity, overflow and trailing text are rejected
+bool parseNonNegative(const std::string& text, double& value) {
+    if (text.empty() || ((text[0] < '0' || text[0] > '9') && text[0] != '.')) {
+        return false;
+    }
+    errno = 0;
+    char* end = nullptr;
+    double parsed = std::strtod(text.c_str(), &end);
+    if (end == text.c_str() || *end != '\0' || errno == ERANGE || !std::isfinite(parsed)) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+bool parseArguments(int argc, char** argv, BenchOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--quick") {
+            options.quick = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--out") {
+            options.outputFile = value;
+        } else if (arg == "--filter") {
+            options.filter = value;
+        } else if (arg == "--min-time") {
+            if (!parseNonNegative(value, options.minMilliseconds)) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+class BenchRunner {
+public:
+    explicit BenchRunner(const BenchOptions& options) : m_options(options) {}
+
+    bool enabled(const std::string& name) const {
+        return m_options.filter.empty() || name.find(m_options.filter) != std::string::npos;
+    }
+
+    // Runs fn once to warm up, then until both the minimum time and three iterations are reached
+    template <typename Fn>
+    void run(const std::string& name, std::vector<std::pair<std::string, std::string>> params,
+             double items, const std::string& itemUnit, Fn&& fn) {
+        if (!enabled(name)) {
+            return;
+        }
+        using Clock = std::chrono::steady_clock;
+        fn();
+
+        std::vector<double> samples;
+        double total = 0.0;
+        while ((total < m_options.minMilliseconds * 1e6 || samples.size() < 3) && samples.size() < 100000) {
+            auto start = Clock::now();
+            fn();
+            double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            samples.push_back(ns);
+            total += ns;
+        }
+        std::sort(samples.begin(), samples.end());
+
+        BenchResult result;
+        result.name = name;
+        result.params = std::move(params);
+        result.iterations = samples.size();
+        result.medianNs = samples[samples.size() / 2];
+        result.minNs = samples.front();
+        result.meanNs = total / samples.size();
+        result.items = items;
+        result.itemUnit = itemUnit;
+        print(result);
+        m_results.push_back(std::move(result));
+    }
+
+    bool writeJson(const std::string& filename) const {
+        std::ofstream file(filename, std::ios::trunc);
+        if (!file) {
+            return false;
+        }
+        file << "{\n  \"version\": 1,\n";
+        file << "  \"noise_kernel\": \"" << noiseKernelName(activeNoiseKernel()) << "\",\n";
+        file << "  \"hardware_threads\": " << std::max(1u, std::thread::hardware_concurrency()) << ",\n";
+        file << "  \"results\": [\n";
+        for (size_t i = 0; i < m_results.size(); i++) {
+            const BenchResult& r = m_results[i];
+            file << "    {\"name\": \"" << r.name << "\", \"params\": {";
+            for (size_t p = 0; p < r.params.size(); p++) {
+                file << (p ? ", " : "") << "\"" << r.params[p].first << "\": \"" << r.params[p].second << "\"";
+            }
+            char numbers[256];
+            std::snprintf(numbers, sizeof(numbers),
+                "}, \"iterations\": %zu, \"median_ns\": %.1f, \"min_ns\": %.1f, \"mean_ns\": %.1f, "
+                "\"items_per_iteration\": %.0f, \"item_unit\": \"%s\", \"items_per_second\": %.1f}",
+                r.iterations, r.medianNs, r.minNs, r.meanNs, r.items, r.itemUnit.c_str(),
+                r.medianNs > 0.0 ? r.items * 1e9 / r.medianNs : 0.0);
+            file << numbers << (i + 1 < m_results.size() ? ",\n" : "\n");
+        }
+        file << "  ]\n}\n";
+        return static_cast<bool>(file);
+    }
+
+private:
+    static void print(const BenchResult& r) {
+        std::string label = r.name;
+        for (const auto& param : r.params) {
+            label += " " + param.first + "=" + param.second;
+        }
+        std::printf("%-64s %12.3f ms %14.0f %s/s  (%zu iterations)\n", label.c_str(), r.medianNs / 1e6,
+                    r.medianNs > 0.0 ? r.items * 1e9 / r.medianNs : 0.0, r.itemUnit.c_str(), r.iterations);
+        std::fflush(stdout);
+    }
+
+    const BenchOptions& m_options;
+    std::vector<BenchResult> m_results;
+};
+
+TerrainParams benchParams(const Resolution& resolution, int pointCount, int caveCount) {
+    TerrainParams params = defaultTerrainParams(resolution.width, resolution.height);
+    params.blobCount = 3;
+    params.blobSpacing = 0.8f;
+    params.pointCount = pointCount;
+    params.cavePointCount = pointCount;
+    params.caveCount = caveCount;
+    placeCaves(params, 1234);
+    return params;
+}
+
+using BenchParams = std::vector<std::pair<std::string, std::string>>;
+
+BenchParams describe(const Resolution& resolution, int pointCount, int caveCount) {
+    return {{"resolution", resolution.name}, {"points", std::to_string(pointCount)}, {"caves", std::to_string(caveCount)}};
+}
+
+BenchParams withParam(BenchParams params, const std::string& key, const std::string& value) {
+    params.emplace_back(key, value);
+    return params;
+}
+
+// Inlined loop over one NoisePolicies.hpp type, as the outline code runs it
+template <typename Noise>
+void benchNoisePolicy(BenchRunner& runner, const BenchParams& params, const std::vector<float>& xs,
+                      const std::vector<float>& ys, std::vector<float>& values) {
+    size_t count = xs.size();
+    runner.run("noisePolicy", params, static_cast<double>(count), "samples", [&] {
+        for (size_t i = 0; i < count; i++) {
+            values[i] = Noise::sample(xs[i], ys[i]);
+        }
+        g_sink = g_sink + static_cast<uint64_t>(values[count / 2] * 1000.0f);
+    });
+}
+
+void benchNoise(BenchRunner& runner, bool quick) {
+    const size_t count = quick ? 1 << 14 : 1 << 20;
+    std::vector<float> xs(count), ys(count), values(count);
+    for (size_t i = 0; i < count; i++) {
+        xs[i] = static_cast<float>(i % 1024) * 0.173f;
+        ys[i] = static_cast<float>(i / 1024) * 0.131f;
+    }
+
+    // The scalar entry point the original per-point outline code used
+    runner.run("noise2D", {{"kernel", "perlinNoise2D"}, {"count", std::to_string(count)}},
+        static_cast<double>(count), "samples", [&] {
+            float sum = 0.0f;
+            for (size_t i = 0; i < count; i++) {
+                sum += perlinNoise2D(xs[i], ys[i]);
+            }
+            g_sink = g_sink + static_cast<uint64_t>(sum);
+        });
+
+    NoiseKernel previous = activeNoiseKernel();
+    for (NoiseKernel kernel : {NoiseKernel::Scalar, NoiseKernel::Sse41, NoiseKernel::Avx2}) {
+        if (kernel > supportedNoiseKernel()) {
+            continue;  // Not supported by this CPU or build
+        }
+        setNoiseKernel(kernel);
+        runner.run("noise2D", {{"kernel", noiseKernelName(kernel)}, {"count", std::to_string(count)}},
+            static_cast<double>(count), "samples", [&] {
+                perlinNoise2DBatch(xs.data(), ys.data(), values.data(), count);
+                g_sink = g_sink + static_cast<uint64_t>(values[count / 2] * 1000.0f);
+            });
+    }
+    setNoiseKernel(previous);
+
+    auto policy = [count](const char* basis, const char* fractal, int octaves) {
+        return BenchParams{{"basis", basis}, {"fractal", fractal}, {"octaves", std::to_string(octaves)},
+                           {"count", std::to_string(count)}};
+    };
+    benchNoisePolicy<PerlinNoise<>>(runner, policy("perlin", "fbm", 1), xs, ys, values);
+    benchNoisePolicy<SimplexNoise<>>(runner, policy("simplex", "fbm", 1), xs, ys, values);
+    benchNoisePolicy<ValueNoise<>>(runner, policy("value", "fbm", 1), xs, ys, values);
+    benchNoisePolicy<FbmNoise<PerlinNoise<>, 4>>(runner, policy("perlin", "fbm", 4), xs, ys, values);
+    benchNoisePolicy<FbmNoise<SimplexNoise<>, 4>>(runner, policy("simplex", "fbm", 4), xs, ys, values);
+    benchNoisePolicy<RidgedNoise<SimplexNoise<>, 4>>(runner, policy("simplex", "ridged", 4), xs, ys, values);
+}
+
+void benchOutlines(BenchRunner& runner, bool quick) {
+    // Outline generation is what drawMultiBlob spends its CPU time on
+    const Resolution resolution{"1080p", 1920, 1080};
+    std::vector<int> pointCounts = quick ? std::vector<int>{20, 100} : std::vector<int>{20, 100, 1000};
+    std::vector<int> caveCounts = quick ? std::vector<int>{0, 100} : std::vector<int>{0, 10, 100, 1000, 10000};
+    for (int points : pointCounts) {
+        for (int caves : caveCounts) {
+            TerrainParams params = benchParams(resolution, points, caves);
+            TerrainOutlines outlines;
+            runner.run("outlines", describe(resolution, points, caves),
+                static_cast<double>(params.blobCount + caves), "polygons", [&] {
+                    buildTerrainOutlines(params, outlines);
+                    g_sink = g_sink + outlines.pointCount();
+                });
+        }
+    }
+
+    // Editing one cave among many: the cache re-tessellates that cave and copies the rest
+    int caves = quick ? 10000 : 50000;
+    TerrainParams params = benchParams(resolution, 20, caves);
+    TerrainOutlines outlines;
+    CaveOutlineCache caveOutlines;
+    buildTerrainOutlines(params, outlines, &caveOutlines);
+    size_t edited = 0;
+    runner.run("outlinesEditOne", withParam(describe(resolution, 20, caves), "cache", "on"),
+        static_cast<double>(params.blobCount + caves), "polygons", [&] {
+            params.caves[edited++ % params.caves.size()].rotation += 0.1f;
+            buildTerrainOutlines(params, outlines, &caveOutlines);
+            g_sink = g_sink + caveOutlines.rebuiltCount();
+        });
+}
+
+void benchPlacement(BenchRunner& runner, bool quick) {
+    // Small caves on a large canvas, so even 100k fit at the default spacing
+    const Resolution resolution{"16k", 16384, 16384};
+    std::vector<int> caveCounts = quick ? std::vector<int>{1000} : std::vector<int>{1000, 10000, 100000};
+    for (CavePlacement placement : {CavePlacement::Uniform, CavePlacement::PoissonDisc}) {
+        const char* name = placement == CavePlacement::Uniform ? "uniform" : "poisson";
+        for (int caves : caveCounts) {
+            TerrainParams params = benchParams(resolution, 20, 0);
+            params.caveScale = 0.0015f;
+            params.caveCount = caves;
+            params.cavePlacement = placement;
+            runner.run("placeCaves", withParam(describe(resolution, 20, caves), "placement", name),
+                static_cast<double>(caves), "caves", [&] {
+                    placeCaves(params, 1234);
+                    g_sink = g_sink + params.caves.size();
+                });
+
+            placeCaves(params, 1234);  // The case above may be filtered out
+            CaveSpatialHash hash;
+            buildCaveHash(params, hash);
+            runner.run("hitTestCave", withParam(describe(resolution, 20, caves), "placement", name),
+                static_cast<double>(params.caves.size()), "queries", [&] {
+                    int hits = 0;
+                    for (const CaveDesc& cave : params.caves) {
+                        hits += hitTestCave(params, hash, cave.x, cave.y) >= 0;
+                    }
+                    g_sink = g_sink + hits;
+                });
+        }
+    }
+}
+
+void benchPipeline(BenchRunner& runner, const std::vector<Resolution>& resolutions, bool quick) {
+    std::vector<int> caveCounts = quick ? std::vector<int>{0, 100} : std::vector<int>{0, 100, 1000, 10000};
+    const int points = 20;
+    for (const Resolution& resolution : resolutions) {
+        double pixels = static_cast<double>(resolution.width) * resolution.height;
+        for (int caves : caveCounts) {
+            TerrainParams params = benchParams(resolution, points, caves);
+            TerrainOutlines outlines;
+            TerrainMask mask;
+            // The cases below read the outlines even when --filter skips generateTerrain
+            buildTerrainOutlines(params, outlines);
+
+            // generateTerrain() on the CPU backend: outlines, then the scanline fill
+            runner.run("generateTerrain", describe(resolution, points, caves), pixels, "pixels", [&] {
+                buildTerrainOutlines(params, outlines);
+                rasterizeTerrain(outlines, params.width, params.height, mask);
+                g_sink = g_sink + mask.cells[mask.cells.size() / 2];
+            });
+
+            // The two coverage passes behind calculateStats(). An unresolved
+            // estimate costs calculateStats() an exactCoverage() on top.
+            runner.run("exactCoverage", describe(resolution, points, caves), pixels, "pixels", [&] {
+                g_sink = g_sink + exactCoverage(outlines, params.width, params.height).solidPixels;
+            });
+            bool unresolved = estimateCoverage(outlines, params.width, params.height).unresolved;
+            runner.run("estimateCoverage",
+                withParam(describe(resolution, points, caves), "unresolved", unresolved ? "true" : "false"),
+                pixels, "pixels", [&] {
+                    g_sink = g_sink + estimateCoverage(outlines, params.width, params.height).solidPixels;
+                });
+
+            // Span-encoded mask straight from the outlines, then an O(spans) count
+            SpanMask spans;
+            runner.run("rasterizeTerrainSpans", describe(resolution, points, caves), pixels, "pixels", [&] {
+                rasterizeTerrainSpans(outlines, params.width, params.height, spans);
+                g_sink = g_sink + spans.spanCount();
+            });
+            runner.run("spanCount", describe(resolution, points, caves), pixels, "pixels", [&] {
+                g_sink = g_sink + spans.count();
+            });
+        }
+
+        TerrainParams params = benchParams(resolution, points, 100);
+        TerrainOutlines outlines;
+        TerrainMask mask;
+        buildTerrainOutlines(params, outlines);
+        rasterizeTerrain(outlines, params.width, params.height, mask);
+
+        // getTerrainData(): bit-pack the mask, then expand to the byte view
+        runner.run("getTerrainData", describe(resolution, points, 100), pixels, "pixels", [&] {
+            TerrainBitmap bitmap = TerrainBitmap::fromMask(mask, TerrainMask::Solid);
+            std::vector<uint8_t> bytes = bitmap.toBytes();
+            g_sink = g_sink + bytes[bytes.size() / 2];
+        });
+
+        // The export job behind saveToFileAsync(): recolor and encode a PNG into
+        // the temp directory. The synchronous saveToFile() goes through sf::Image
+        // and is not covered here.
+        std::string filename = (std::filesystem::temp_directory_path() / "terrain_bench.png").string();
+        MaskColors colors;
+        colors.empty = PngWriter::PaletteEntry{0, 0, 0, 0};
+        runner.run("writeMaskPng", describe(resolution, points, 100), pixels, "pixels", [&] {
+            g_sink = g_sink + writeMaskPng(filename, mask, colors);
+        });
+        std::error_code ec;
+        std::filesystem::remove(filename, ec);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!parseArguments(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+
+    std::vector<Resolution> resolutions = {
+        {"720p", 1280, 720}, {"1080p", 1920, 1080}, {"4K", 3840, 2160}, {"8K", 7680, 4320}};
+    if (options.quick) {
+        resolutions.resize(2);
+        options.minMilliseconds = std::min(options.minMilliseconds, 50.0);
+    }
+
+    BenchRunner runner(options);
+    benchNoise(runner, options.quick);
+    benchOutlines(runner, options.quick);
+    benchPlacement(runner, options.quick);
+    benchPipeline(runner, resolutions, options.quick);
+
+    if (!runner.writeJson(options.outputFile)) {
+        std::cerr << "terrain_bench: cannot write " << options.outputFile << "\n";
+        return 1;
+    }
+    std::cout << "Results written to " << options.outputFile << "\n";
+    return 0;
+}
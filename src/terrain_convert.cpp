@@ -0,0 +1,184 @@
+// Converts PNG terrain exports (the app's Save Terrain, terrain-batch) into
+// native .terrain files the game can memory-map instead of decoding.
+#include <SFML/Graphics.hpp>
+#include "DistanceField.hpp"
+#include "TerrainContours.hpp"
+#include "TerrainFile.hpp"
+#include "TerrainParams.hpp"
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace {
+
+struct ConvertOptions {
+    std::string input;
+    std::string output;
+    std::string paramsFile;
+    uint32_t seed{0};
+    bool distanceField{false};
+    bool contours{false};
+    float contourTolerance{1.0f};
+};
+
+void printUsage() {
+    std::cout << "Usage: terrain-convert <input.png> <output.terrain> [options]\n"
+              << "  --params <file>    Generation parameters to store (from Save Parameters)\n"
+              << "  --seed <n>         Seed to store\n"
+              << "  --sdf              Add a distance field section\n"
+              << "  --contours <tol>   Add physics contours simplified to <tol> pixels\n";
+}
+
+// Whole decimal number in [0, max]; signs, trailing text and overflow are rejected
+bool parseUnsigned(const std::string& text, uint64_t max, uint64_t& value) {
+    if (text.empty() || text[0] < '0' || text[0] > '9') {
+        return false;
+    }
+    errno = 0;
+    char* end = nullptr;
+    unsigned long long parsed = std::strtoull(text.c_str(), &end, 10);
+    if (end == text.c_str() || *end != '\0' || errno == ERANGE || parsed > max) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+// Finite decimal number >= 0; signs, NaN, infinity, overflow and trailing text are rejected
+bool parseNonNegative(const std::string& text, float& value) {
+    if (text.empty() || ((text[0] < '0' || text[0] > '9') && text[0] != '.')) {
+        return false;
+    }
+    errno = 0;
+    char* end = nullptr;
+    float parsed = std::strtof(text.c_str(), &end);
+    if (end == text.c_str() || *end != '\0' || errno == ERANGE || !std::isfinite(parsed)) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+bool parseArguments(int argc, char** argv, ConvertOptions& options) {
+    if (argc < 3) {
+        return false;
+    }
+    options.input = argv[1];
+    options.output = argv[2];
+
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--sdf") {
+            options.distanceField = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--params") {
+            options.paramsFile = value;
+        } else if (arg == "--seed") {
+            uint64_t seed = 0;
+            if (!parseUnsigned(value, UINT32_MAX, seed)) {
+                return false;
+            }
+            options.seed = static_cast<uint32_t>(seed);
+        } else if (arg == "--contours") {
+            if (!parseNonNegative(value, options.contourTolerance)) {
+                return false;
+            }
+            options.contours = true;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Exports use black for terrain and white or transparency for caves and air
+uint8_t classifyPixel(const uint8_t* rgba) {
+    if (rgba[3] < 128) {
+        return TerrainMask::Empty;
+    }
+    int luminance = (rgba[0] * 77 + rgba[1] * 150 + rgba[2] * 29) >> 8;
+    return luminance < 128 ? TerrainMask::Solid : TerrainMask::Cave;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    ConvertOptions options;
+    if (!parseArguments(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+
+    sf::Image image;
+    if (!image.loadFromFile(options.input)) {
+        std::cerr << "terrain-convert: cannot read " << options.input << "\n";
+        return 1;
+    }
+    unsigned int width = image.getSize().x;
+    unsigned int height = image.getSize().y;
+
+    TerrainMask mask;
+    mask.resize(width, height);
+    const uint8_t* pixels = image.getPixelsPtr();
+    for (unsigned int y = 0; y < height; y++) {
+        uint8_t* row = mask.row(y);
+        for (unsigned int x = 0; x < width; x++) {
+            row[x] = classifyPixel(pixels + (static_cast<size_t>(y) * width + x) * 4);
+        }
+    }
+    TerrainBitmap solid = TerrainBitmap::fromMask(mask, TerrainMask::Solid);
+    TerrainBitmap caves = TerrainBitmap::fromMask(mask, TerrainMask::Cave);
+
+    TerrainFileData data;
+    data.seed = options.seed;
+    data.solid = &solid;
+    data.caves = &caves;
+
+    TerrainParams params = defaultTerrainParams(width, height);
+    if (!options.paramsFile.empty()) {
+        std::string error;
+        if (!loadTerrainParams(options.paramsFile, params, error)) {
+            std::cerr << "terrain-convert: " << error << "\n";
+            return 1;
+        }
+        data.params = &params;
+    }
+
+    DistanceField field;
+    if (options.distanceField) {
+        computeDistanceField(solid, field);
+        data.distanceField = &field;
+    }
+    TerrainContours contours;
+    if (options.contours) {
+        extractContours(solid, options.contourTolerance, contours);
+        data.contours = &contours;
+    }
+
+    std::string error;
+    if (!writeTerrainFile(options.output, data, &error)) {
+        std::cerr << "terrain-convert: " << error << "\n";
+        return 1;
+    }
+
+    // Read it back the way the game will
+    TerrainFile file;
+    if (!file.open(options.output, &error) || file.countSolid() != solid.count()) {
+        std::cerr << "terrain-convert: verification failed: " << error << "\n";
+        return 1;
+    }
+    std::cout << options.output << ": " << width << "x" << height << ", "
+              << file.countSolid() << " solid pixels, " << file.fileSize() / 1024 << " KB"
+              << (file.distanceField() ? ", distance field" : "")
+              << (file.hasContours() ? ", " + std::to_string(file.contours().loopCount) + " contour loops" : "")
+              << "\n";
+    return 0;
+}